@@ -30,6 +30,9 @@
   same page).
 */
 
+/*Most branches a superblock follows, see codegen_trace_can_follow()*/
+#define CODEBLOCK_TRACE_MAX 4
+
 typedef struct codeblock_t {
     uint32_t pc;
     uint32_t _cs;
@@ -58,6 +61,20 @@ typedef struct codeblock_t {
     /*First mem_block_t used by this block. Any subsequent mem_block_ts
       will be in the list starting at head_mem_block->next.*/
     struct mem_block_t *head_mem_block;
+
+    /*Bumped whenever the block is invalidated or deleted, so a background
+      compile can tell the block it was handed has gone since*/
+    uint16_t gen;
+
+    /*Superblock profile. Executions of the compiled block, how many of them
+      left through the taken side of the last branch it stopped at, and that
+      branch. trace_pc[] are the branches the block follows when compiled.*/
+    uint16_t trace_exec;
+    uint16_t trace_taken;
+    uint32_t trace_branch_pc;
+    uint32_t trace_dest; /*0 if there is nothing to profile*/
+    uint32_t trace_pc[CODEBLOCK_TRACE_MAX];
+    uint8_t  trace_len;
 } codeblock_t;
 
 extern codeblock_t *codeblock;
@@ -82,6 +99,8 @@ extern uint8_t *block_write_data;
 #define CODEBLOCK_IN_DIRTY_LIST 0x40
 /*Code block is not inlining immediate parameters, parameters must be fetched from memory*/
 #define CODEBLOCK_NO_IMMEDIATES 0x80
+/*Code block is being compiled by the background compiler, and has no code yet*/
+#define CODEBLOCK_COMPILING 0x100
 
 #define BLOCK_PC_INVALID        0xffffffff
 
@@ -266,6 +285,77 @@ codeblock_tree_delete(codeblock_t *block)
     }
 }
 
+/*Background compilation (DYNAREC_ASYNC_COMPILE).
+
+  The IR for a block is still built on the CPU thread while the block is
+  interpreted, as that needs the live CPU state. Register allocation and code
+  emission are then handed to a worker thread, and the CPU thread carries on.
+  One block is compiled at a time; the IR and register allocator state are
+  shared, so no new block can be recompiled until the worker is done and
+  blocks due for recompilation are interpreted meanwhile.
+
+  The worker compiles into a private copy of the codeblock_t, which owns the
+  code memory until the CPU thread installs it. A block deleted or
+  invalidated in the meantime has a new generation, and its code is freed
+  instead of installed.*/
+typedef struct codegen_compile_stats_t {
+    uint64_t submitted;     /*blocks handed to the worker*/
+    uint64_t installed;     /*blocks whose code was installed*/
+    uint64_t cancelled;     /*blocks invalidated while compiling*/
+    uint64_t sync;          /*blocks compiled on the CPU thread, as code memory was low*/
+    uint64_t deferred;      /*recompilations interpreted as the worker was busy*/
+    uint64_t compile_ticks; /*plat_timer_read() ticks the worker spent compiling*/
+    uint64_t latency_ticks; /*ticks from submission to installation*/
+    uint64_t max_latency_ticks;
+} codegen_compile_stats_t;
+
+extern int                     codegen_compile_async;
+extern int                     codegen_compile_pending; /*queue depth, 0 or 1; CPU thread only*/
+extern codegen_compile_stats_t codegen_compile_stats;
+
+extern void codegen_compile_poll(void);
+
+/*Superblocks (DYNAREC_TRACE, on unless set to 0).
+
+  A block is compiled while it is interpreted, along the path the interpreter
+  takes, and ends at the first branch that is taken. Branches not taken are
+  compiled as side exits and compilation carries on past them. The
+  dispatcher counts how often each compiled block runs and how often it
+  leaves through the taken side of the branch it ended at. Once a block has
+  run CODEBLOCK_TRACE_HOT times with that branch taken at least three
+  times in four, the branch is added to the block's trace_pc[] and the block
+  is recompiled. Next time, if the branch is taken during compilation, the
+  not-taken side becomes the side exit and compilation carries on at the
+  target. Each recompilation can extend the trace by one more branch.
+
+  Guest registers then stay in host registers across what used to be several
+  blocks, as side exits only write them back. Only forward branches within
+  CODEBLOCK_TRACE_SPAN of the block start are followed, so a trace covers
+  the same one or two pages a straight block would. Backward branches into
+  the block are still left to the loop unroller.*/
+#define CODEBLOCK_TRACE_HOT  256
+#define CODEBLOCK_TRACE_SPAN 1000 /*Same cap as exec386_dynarec_dyn() puts on a block's source*/
+
+extern int      codegen_trace_enabled;
+extern int      codegen_trace_continue; /*Set while compiling a branch that is being followed*/
+extern uint32_t codegen_trace_dest;
+
+extern int  codegen_trace_can_follow(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr);
+extern void codegen_trace_taken(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr, int follow);
+extern void codegen_trace_hot(codeblock_t *block);
+
+/*Called after block's code has returned*/
+static inline void
+codegen_trace_profile(codeblock_t *block)
+{
+    if (!block->trace_dest || cpu_state.abrt)
+        return;
+    if (cs + cpu_state.pc == block->trace_dest)
+        block->trace_taken++;
+    if (++block->trace_exec == CODEBLOCK_TRACE_HOT)
+        codegen_trace_hot(block);
+}
+
 #define PAGE_MASK_MASK  63
 #define PAGE_MASK_SHIFT 6
 
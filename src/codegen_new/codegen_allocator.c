@@ -16,6 +16,7 @@
 #include <86box/mem.h>
 #include <86box/plat.h>
 #include <86box/plat_unused.h>
+#include <86box/thread.h>
 
 #include "codegen.h"
 #include "codegen_allocator.h"
@@ -86,6 +87,24 @@ static uint8_t    *mem_block_alloc = NULL;
 
 int codegen_allocator_usage = 0;
 
+/*Only set with background compilation, where the worker allocates while the
+  CPU thread frees*/
+static mutex_t *allocator_mutex = NULL;
+
+static inline void
+allocator_lock(void)
+{
+    if (allocator_mutex)
+        thread_wait_mutex(allocator_mutex);
+}
+
+static inline void
+allocator_unlock(void)
+{
+    if (allocator_mutex)
+        thread_release_mutex(allocator_mutex);
+}
+
 void
 codegen_allocator_init(void)
 {
@@ -103,13 +122,28 @@ codegen_allocator_init(void)
     mem_block_free_list = 1;
 }
 
+void
+codegen_allocator_enable_locking(void)
+{
+    if (!allocator_mutex)
+        allocator_mutex = thread_create_mutex();
+}
+
 mem_block_t *
 codegen_allocator_allocate(mem_block_t *parent, int code_block)
 {
     mem_block_t *block;
     uint32_t     block_nr;
 
+    /*Extra blocks belong to the same code block as their parent*/
+    if (parent)
+        code_block = parent->code_block;
+
     if (!mem_block_free_list) {
+        /*Evicting blocks is only safe on the CPU thread. The background
+          compiler is only started with enough memory to spare.*/
+        if (codegen_compile_pending)
+            fatal("Out of memory blocks in background compile!\n");
         if (mem_code_block_head == mem_code_block_tail) {
             fatal("Out of memory blocks!\n");
         } else {
@@ -129,6 +163,7 @@ codegen_allocator_allocate(mem_block_t *parent, int code_block)
     }
 
 block_allocate:
+    allocator_lock();
     /*Remove from free list*/
     block_nr            = mem_block_free_list;
     block               = &mem_blocks[block_nr - 1];
@@ -154,6 +189,7 @@ block_allocate:
     }
 
     codegen_allocator_usage++;
+    allocator_unlock();
     return block;
 }
 void
@@ -161,6 +197,7 @@ codegen_allocator_free(mem_block_t *block)
 {
     int block_nr = (((uintptr_t) block - (uintptr_t) mem_blocks) / sizeof(mem_block_t)) + 1;
 
+    allocator_lock();
     block->tail = 0;
     if (valid_code_blocks[block->code_block])
         remove_from_block_list(&mem_code_blocks[block->code_block]);
@@ -179,6 +216,7 @@ codegen_allocator_free(mem_block_t *block)
         else
             break;
     }
+    allocator_unlock();
 }
 
 uint8_t *
@@ -21,6 +21,8 @@
 #define MEM_BLOCK_SIZE 0x3c0
 
 void codegen_allocator_init(void);
+/*Lock the allocator, for when code is compiled on a separate thread*/
+void codegen_allocator_enable_locking(void);
 /*Allocate a mem_block_t, and the associated backing memory.
   If parent is non-NULL, then the new block will be added to the list in
   parent->next*/
@@ -2,10 +2,15 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__APPLE__) && defined(__aarch64__)
+#    include <pthread.h>
+#endif
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
+#include <86box/plat.h>
 #include <86box/plat_unused.h>
+#include <86box/thread.h>
 
 #include "x86.h"
 #include "x86_flags.h"
@@ -57,9 +62,33 @@ static int      last_ssegs;
 uint32_t instr_counts[256 * 256];
 #endif
 
+/*Blocks are compiled on the CPU thread when fewer mem_block_ts than this are
+  free, so the worker never has to evict blocks. Far more than any single
+  block needs.*/
+#define COMPILE_MEM_RESERVE 1024
+
+int                     codegen_compile_async   = 0;
+int                     codegen_compile_pending = 0;
+codegen_compile_stats_t codegen_compile_stats;
+
+int      codegen_trace_enabled  = 1;
+int      codegen_trace_continue = 0;
+uint32_t codegen_trace_dest;
+
+static thread_t   *compile_thread;
+static event_t    *compile_wake;
+static ATOMIC_INT  compile_done;
+static codeblock_t compile_block; /*Worker's copy of the block being compiled*/
+static uint16_t    compile_block_nr;
+static uint16_t    compile_block_gen;
+static uint64_t    compile_submit_time;
+static uint64_t    compile_ticks;
+
 static uint16_t block_free_list;
 static void     delete_block(codeblock_t *block);
 static void     delete_dirty_block(codeblock_t *block);
+static void     codegen_compile_submit(codeblock_t *block);
+static void     codegen_compile_log(void);
 
 /*Temporary list of code blocks that have recently been evicted. This allows for
   some historical state to be kept when a block is the target of self-modifying
@@ -214,12 +243,35 @@ block_free_list_get(void)
     return block;
 }
 
+static void codegen_compile_thread(void *param);
+
 void
 codegen_init(void)
 {
+    const char *async_env = getenv("DYNAREC_ASYNC_COMPILE");
+    const char *opt_env   = getenv("DYNAREC_IR_OPT");
+    const char *stats_env = getenv("DYNAREC_IR_STATS");
+    const char *trace_env = getenv("DYNAREC_TRACE");
+
     codegen_check_regs();
     codegen_allocator_init();
 
+    /*IR passes on unless set to 0; uOP counts logged if set to anything but 0*/
+    codegen_ir_opt   = !(opt_env && !strcmp(opt_env, "0"));
+    codegen_ir_stats = stats_env && *stats_env && strcmp(stats_env, "0");
+
+    /*Superblocks on unless set to 0*/
+    codegen_trace_enabled = !(trace_env && !strcmp(trace_env, "0"));
+
+    /*Off unless set to something other than 0*/
+    codegen_compile_async = async_env && *async_env && strcmp(async_env, "0");
+    if (codegen_compile_async) {
+        codegen_allocator_enable_locking();
+        compile_wake   = thread_create_event();
+        compile_thread = thread_create(codegen_compile_thread, NULL);
+        pclog("Dynarec: compiling blocks on a background thread\n");
+    }
+
     codegen_backend_init();
     block_free_list = 0;
     for (uint32_t c = 0; c < BLOCK_SIZE; c++)
@@ -236,6 +288,14 @@ codegen_reset(void)
 {
     int c;
 
+    if (codegen_compile_async) {
+        /*Let the worker finish, its block is about to go anyway*/
+        while (codegen_compile_pending)
+            codegen_compile_poll();
+        if (codegen_compile_stats.submitted)
+            codegen_compile_log();
+    }
+
     for (c = 1; c < BLOCK_SIZE; c++) {
         codeblock_t *block = &codeblock[c];
 
@@ -377,6 +437,7 @@ invalidate_block(codeblock_t *block)
     if (!block->valid)
         fatal("Invalidating deleted block\n");
 #endif
+    block->gen++;
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
     if (block->head_mem_block)
@@ -397,6 +458,7 @@ delete_block(codeblock_t *block)
         fatal("Deleting deleted block\n");
 #endif
     block->valid = 0;
+    block->gen++;
 
     codeblock_tree_delete(block);
     if (block->flags & CODEBLOCK_IN_DIRTY_LIST)
@@ -420,6 +482,7 @@ delete_dirty_block(codeblock_t *block)
         fatal("Deleting deleted block\n");
 #endif
     block->valid = 0;
+    block->gen++;
 
     codeblock_tree_delete(block);
     block_free_list_add(block);
@@ -533,6 +596,8 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->trace_dest                    = 0;
+    block->trace_len                     = 0;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -574,6 +639,10 @@ codegen_block_start_recompile(codeblock_t *block)
     block->page_mask = block->page_mask2 = 0;
     block->ins                           = 0;
 
+    block->trace_exec = block->trace_taken = 0;
+    block->trace_dest                      = 0;
+    codegen_trace_continue                 = 0;
+
     cpu_block_end = 0;
 
     last_op32   = -1;
@@ -783,7 +852,180 @@ codegen_block_end_recompile(codeblock_t *block)
         block->flags &= ~CODEBLOCK_STATIC_TOP;
 
     codegen_accumulate_flush(ir_data);
-    codegen_ir_compile(ir_data, block);
+    if (!codegen_compile_async)
+        codegen_ir_compile(ir_data, block);
+    else if ((MEM_BLOCK_NR - codegen_allocator_usage) < COMPILE_MEM_RESERVE) {
+        codegen_compile_stats.sync++;
+        codegen_ir_compile(ir_data, block);
+    } else
+        codegen_compile_submit(block);
+}
+
+static void
+codegen_compile_thread(UNUSED(void *param))
+{
+#if defined(__APPLE__) && defined(__aarch64__)
+    if (__builtin_available(macOS 11.0, *)) {
+        pthread_jit_write_protect_np(0);
+    }
+#endif
+
+    while (1) {
+        uint64_t start_time;
+
+        thread_wait_event(compile_wake, -1);
+        thread_reset_event(compile_wake);
+
+        start_time = plat_timer_read();
+        codegen_ir_compile(ir_data, &compile_block);
+        compile_ticks = plat_timer_read() - start_time;
+
+        ATOMIC_STORE(compile_done, 1);
+    }
+}
+
+/*Hand block over to the worker. The worker owns the code memory from here
+  until codegen_compile_poll(), so the block itself can be deleted or reused
+  meanwhile.*/
+static void
+codegen_compile_submit(codeblock_t *block)
+{
+    compile_block     = *block;
+    compile_block_nr  = get_block_nr(block);
+    compile_block_gen = block->gen;
+
+    block->head_mem_block = NULL;
+    block->data           = NULL;
+    block->flags          = (block->flags & ~CODEBLOCK_WAS_RECOMPILED) | CODEBLOCK_COMPILING;
+
+    codegen_compile_pending = 1;
+    codegen_compile_stats.submitted++;
+    compile_submit_time = plat_timer_read();
+    thread_set_event(compile_wake);
+}
+
+/*Install the worker's block if it has finished. Called on the CPU thread
+  between blocks.*/
+void
+codegen_compile_poll(void)
+{
+    codeblock_t *block = &codeblock[compile_block_nr];
+    uint64_t     latency;
+
+    if (!codegen_compile_pending || !ATOMIC_LOAD(compile_done))
+        return;
+    ATOMIC_STORE(compile_done, 0);
+    codegen_compile_pending = 0;
+
+    latency = plat_timer_read() - compile_submit_time;
+    codegen_compile_stats.compile_ticks += compile_ticks;
+    codegen_compile_stats.latency_ticks += latency;
+    if (latency > codegen_compile_stats.max_latency_ticks)
+        codegen_compile_stats.max_latency_ticks = latency;
+
+    /*The block must be the one that was submitted, and must not have been
+      switched to finer dirty tracking, which needs different code*/
+    if (block->gen == compile_block_gen && block->valid &&
+        (block->flags & (CODEBLOCK_COMPILING | CODEBLOCK_IN_DIRTY_LIST)) == CODEBLOCK_COMPILING &&
+        !((block->flags ^ compile_block.flags) & (CODEBLOCK_BYTE_MASK | CODEBLOCK_NO_IMMEDIATES))) {
+#if defined __aarch64__
+        /*The worker cleaned the caches; this thread still needs a context
+          synchronisation before running the new code*/
+        __asm__ volatile("isb" ::: "memory");
+#elif defined _M_ARM64
+        __isb(_ARM64_BARRIER_SY);
+#endif
+        block->head_mem_block = compile_block.head_mem_block;
+        block->data           = compile_block.data;
+        block->flags          = (block->flags & ~CODEBLOCK_COMPILING) | CODEBLOCK_WAS_RECOMPILED;
+        codegen_compile_stats.installed++;
+    } else {
+        codegen_allocator_free(compile_block.head_mem_block);
+        if (block->gen == compile_block_gen)
+            block->flags &= ~CODEBLOCK_COMPILING;
+        codegen_compile_stats.cancelled++;
+    }
+}
+
+static void
+codegen_compile_log(void)
+{
+    const codegen_compile_stats_t *stats    = &codegen_compile_stats;
+    uint64_t                       freq     = timer_freq ? timer_freq : 1;
+    uint64_t                       compiled = stats->installed + stats->cancelled;
+
+    pclog("Dynarec background compile: submitted=%" PRIu64 " installed=%" PRIu64 " cancelled=%" PRIu64
+          " sync=%" PRIu64 " deferred=%" PRIu64 " avg_compile=%" PRIu64 "us avg_latency=%" PRIu64 "us max_latency=%" PRIu64 "us\n",
+          stats->submitted, stats->installed, stats->cancelled, stats->sync, stats->deferred,
+          compiled ? ((stats->compile_ticks / compiled) * 1000000) / freq : 0,
+          compiled ? ((stats->latency_ticks / compiled) * 1000000) / freq : 0,
+          (stats->max_latency_ticks * 1000000) / freq);
+}
+
+/*Forward branches within the span of a straight block only*/
+static int
+codegen_trace_in_span(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr)
+{
+    return !(block->flags & CODEBLOCK_BYTE_MASK) && dest_addr > next_pc && ((cs + dest_addr) - block->pc) < CODEBLOCK_TRACE_SPAN;
+}
+
+/*Whether the block follows a branch that is taken this time through. Only
+  asks; the caller commits to it with codegen_trace_taken() where it emits
+  the branch's exit.*/
+int
+codegen_trace_can_follow(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr)
+{
+    uint32_t branch_pc = cs + cpu_state.oldpc;
+
+    if (!codegen_trace_in_span(block, next_pc, dest_addr))
+        return 0;
+
+    for (int c = 0; c < block->trace_len; c++) {
+        if (block->trace_pc[c] == branch_pc)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*Called once the exit of a branch that is taken this time through has been
+  emitted. If the block follows it, the not-taken side is the side exit and
+  exec386_dynarec_dyn() carries on compiling at dest_addr. Otherwise the
+  branch is recorded as the one the block stops at, for the dispatcher to
+  profile.*/
+void
+codegen_trace_taken(codeblock_t *block, uint32_t next_pc, uint32_t dest_addr, int follow)
+{
+    if (!codegen_trace_in_span(block, next_pc, dest_addr))
+        return;
+
+    if (follow) {
+        codegen_trace_continue = 1;
+        codegen_trace_dest     = cs + dest_addr;
+    } else {
+        block->trace_branch_pc = cs + cpu_state.oldpc;
+        block->trace_dest      = cs + dest_addr;
+    }
+}
+
+/*Block has run CODEBLOCK_TRACE_HOT times since it was compiled. Recompile it
+  to follow the branch it stops at, if that is mostly taken.*/
+void
+codegen_trace_hot(codeblock_t *block)
+{
+    if (block->trace_taken < (CODEBLOCK_TRACE_HOT * 3) / 4) {
+        /*No taken bias yet; start another round*/
+        block->trace_exec = block->trace_taken = 0;
+        return;
+    }
+
+    block->trace_dest = 0;
+    if (block->trace_len == CODEBLOCK_TRACE_MAX || !block->valid ||
+        (block->flags & (CODEBLOCK_WAS_RECOMPILED | CODEBLOCK_IN_DIRTY_LIST)) != CODEBLOCK_WAS_RECOMPILED)
+        return;
+
+    block->trace_pc[block->trace_len++] = block->trace_branch_pc;
+    block->flags &= ~CODEBLOCK_WAS_RECOMPILED;
 }
 
 void
@@ -1,4 +1,6 @@
+#include <inttypes.h>
 #include <stdint.h>
+#include <string.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
@@ -17,6 +19,27 @@ static int codegen_unroll_start;
 static int codegen_unroll_count;
 static int codegen_unroll_first_instruction;
 
+int codegen_ir_opt   = 1;
+int codegen_ir_stats = 0;
+
+/*Passes run by codegen_ir_optimise(), for the stats log*/
+enum {
+    IR_PASS_DEAD,
+    IR_PASS_FLAGS,
+    IR_PASS_COUNT
+};
+
+static const char *ir_pass_names[IR_PASS_COUNT] = { "dead", "flags" };
+
+/*Live uOPs going into the passes, and after each one*/
+static uint64_t ir_stats_uops_in;
+static uint64_t ir_stats_uops[IR_PASS_COUNT];
+static int      ir_stats_blocks;
+
+#define IR_STATS_INTERVAL 1024
+
+static uint8_t ir_jump_target[UOP_NR_MAX];
+
 ir_data_t *
 codegen_ir_init(void)
 {
@@ -62,6 +85,193 @@ duplicate_uop(ir_data_t *ir, uop_t *uop, int offset)
     }
 }
 
+static int
+ir_count_uops(ir_data_t *ir)
+{
+    int count = 0;
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        if ((ir->uops[c].type & UOP_MASK) != UOP_INVALID)
+            count++;
+    }
+
+    return count;
+}
+
+static void
+ir_stats_add(const int *counts)
+{
+    ir_stats_uops_in += counts[0];
+    for (int c = 0; c < IR_PASS_COUNT; c++)
+        ir_stats_uops[c] += counts[c + 1];
+
+    if (++ir_stats_blocks % IR_STATS_INTERVAL)
+        return;
+    pclog("IR passes, %i blocks: %" PRIu64 " uOPs", ir_stats_blocks, ir_stats_uops_in);
+    for (int c = 0; c < IR_PASS_COUNT; c++)
+        pclog(", %s %" PRIu64, ir_pass_names[c], ir_stats_uops[c]);
+    pclog("\n");
+}
+
+/*Drop one pending read of ir_reg, and queue the version for removal if
+  nothing else needs it*/
+static void
+ir_reg_release(ir_data_t *ir, ir_reg_t ir_reg)
+{
+    int            reg  = IREG_GET_REG(ir_reg.reg);
+    reg_version_t *regv = &reg_version[reg][ir_reg.version];
+
+    regv->refcount--;
+    if (regv->refcount || reg <= IREG_EBX || !ir_reg.version || (regv->flags & (REG_FLAGS_REQUIRED | REG_FLAGS_DEAD)))
+        return;
+    /*A partial write of the next version still merges this one in*/
+    if (ir_reg.version < reg_last_version[reg] && !reg_is_native_size(ir->uops[reg_version[reg][ir_reg.version + 1].parent_uop].dest_reg_a))
+        return;
+    add_to_dead_list(regv, reg, ir_reg.version);
+}
+
+static void
+ir_mark_jump_targets(ir_data_t *ir)
+{
+    memset(ir_jump_target, 0, ir->wr_pos);
+    for (int c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_MASK) != UOP_INVALID && (uop->type & UOP_TYPE_JUMP) && uop->jump_dest_uop >= 0 && uop->jump_dest_uop < ir->wr_pos)
+            ir_jump_target[uop->jump_dest_uop] = 1;
+    }
+}
+
+#define IR_FLAG_REGS 4 /*IREG_flags_op to IREG_flags_op2*/
+
+static inline int
+ir_flag_reg(ir_reg_t ir_reg)
+{
+    int reg = IREG_GET_REG(ir_reg.reg);
+
+    return (reg >= IREG_flags_op && reg <= IREG_flags_op2) ? (reg - IREG_flags_op) : -1;
+}
+
+/*uOP sets a lazy flag register to a value another uOP can be compared with*/
+static inline int
+ir_flag_value_uop(const uop_t *uop)
+{
+    return (uop->type == UOP_MOV_IMM || uop->type == UOP_MOV || uop->type == UOP_MOVZX) && reg_is_native_size(uop->dest_reg_a);
+}
+
+static inline int
+ir_flag_same_value(const uop_t *a, const uop_t *b)
+{
+    if (a->type != b->type || a->dest_reg_a.reg != b->dest_reg_a.reg)
+        return 0;
+    if (a->type == UOP_MOV_IMM)
+        return a->imm_data == b->imm_data;
+    return a->src_reg_a.reg == b->src_reg_a.reg && a->src_reg_a.version == b->src_reg_a.version;
+}
+
+/*Redundant lazy flag stores. Every arithmetic op writes flags_op, flags_op1,
+  flags_op2 and flags_res; overwritten versions are already dropped by the
+  dead list, but any memory access or branch in between marks them as
+  required. When an op stores the value the register already holds - the
+  same FLAGS_* constant, or the same version of the same guest register as
+  in CMP EAX,x / Jcc / CMP EAX,y - the store is dropped and its reads are
+  pointed at the earlier version. Only within a straight run of uOPs: jump
+  targets and barriers, which can change the registers behind the IR's back,
+  start afresh.*/
+static void
+ir_pass_flags(ir_data_t *ir)
+{
+    uint8_t remap[IR_FLAG_REGS][256];
+    int     value_uop[IR_FLAG_REGS];
+
+    for (int r = 0; r < IR_FLAG_REGS; r++) {
+        for (int v = 0; v < 256; v++)
+            remap[r][v] = v;
+        value_uop[r] = -1;
+    }
+    ir_mark_jump_targets(ir);
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        uop_t         *uop = &ir->uops[c];
+        reg_version_t *regv;
+        reg_version_t *prev_regv;
+        int            r;
+        int            reg;
+        int            version;
+        int            prev_version;
+
+        if (ir_jump_target[c] || (uop->type & UOP_TYPE_BARRIER)) {
+            for (r = 0; r < IR_FLAG_REGS; r++)
+                value_uop[r] = -1;
+        }
+        if ((uop->type & UOP_MASK) == UOP_INVALID)
+            continue;
+
+        if ((r = ir_flag_reg(uop->src_reg_a)) >= 0)
+            uop->src_reg_a.version = remap[r][uop->src_reg_a.version];
+        if ((r = ir_flag_reg(uop->src_reg_b)) >= 0)
+            uop->src_reg_b.version = remap[r][uop->src_reg_b.version];
+        if ((r = ir_flag_reg(uop->src_reg_c)) >= 0)
+            uop->src_reg_c.version = remap[r][uop->src_reg_c.version];
+
+        if ((r = ir_flag_reg(uop->dest_reg_a)) < 0)
+            continue;
+        if (!ir_flag_value_uop(uop)) {
+            value_uop[r] = -1;
+            continue;
+        }
+        if (value_uop[r] == -1 || !ir_flag_same_value(&ir->uops[value_uop[r]], uop)) {
+            value_uop[r] = c;
+            continue;
+        }
+
+        reg          = IREG_GET_REG(uop->dest_reg_a.reg);
+        version      = uop->dest_reg_a.version;
+        prev_version = ir->uops[value_uop[r]].dest_reg_a.version;
+        regv         = &reg_version[reg][version];
+        prev_regv    = &reg_version[reg][prev_version];
+
+        /*The earlier version must not be on its way out, and a partial
+          write of the next version would merge in this one explicitly*/
+        if ((!prev_regv->refcount && !(prev_regv->flags & REG_FLAGS_REQUIRED)) || (prev_regv->refcount + regv->refcount) > REG_REFCOUNT_MAX ||
+            (version < reg_last_version[reg] && !reg_is_native_size(ir->uops[reg_version[reg][version + 1].parent_uop].dest_reg_a))) {
+            value_uop[r] = c;
+            continue;
+        }
+
+        prev_regv->refcount += regv->refcount;
+        prev_regv->flags |= (regv->flags & REG_FLAGS_REQUIRED);
+        regv->refcount = 0;
+        regv->flags |= REG_FLAGS_DEAD;
+        remap[r][version] = prev_version;
+
+        if (!ir_reg_is_invalid(uop->src_reg_a))
+            ir_reg_release(ir, uop->src_reg_a);
+        uop->type = UOP_INVALID;
+    }
+}
+
+/*Run the IR passes, in place of the dead list processing alone*/
+static void
+codegen_ir_optimise(ir_data_t *ir)
+{
+    int counts[IR_PASS_COUNT + 1] = { 0 };
+
+    if (codegen_ir_stats)
+        counts[0] = ir_count_uops(ir);
+
+    codegen_reg_process_dead_list(ir);
+    if (codegen_ir_stats)
+        counts[1 + IR_PASS_DEAD] = ir_count_uops(ir);
+
+    ir_pass_flags(ir);
+    codegen_reg_process_dead_list(ir);
+    if (codegen_ir_stats) {
+        counts[1 + IR_PASS_FLAGS] = ir_count_uops(ir);
+        ir_stats_add(counts);
+    }
+}
+
 void
 codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 {
@@ -85,7 +295,10 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_reg_mark_as_required();
-    codegen_reg_process_dead_list(ir);
+    if (codegen_ir_opt)
+        codegen_ir_optimise(ir);
+    else
+        codegen_reg_process_dead_list(ir);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
     codegen_backend_prologue(block);
@@ -4,3 +4,8 @@ ir_data_t *codegen_ir_init(void);
 
 void codegen_ir_set_unroll(int count, int start, int first_instruction);
 void codegen_ir_compile(ir_data_t *ir, codeblock_t *block);
+
+/*Run the IR optimisation passes before register allocation, and log uOP
+  counts after each pass*/
+extern int codegen_ir_opt;
+extern int codegen_ir_stats;
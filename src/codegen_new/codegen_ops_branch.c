@@ -111,7 +111,8 @@ static int
 ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (CF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = CF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -121,21 +122,21 @@ ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
             return 0;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
 
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
 
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -144,22 +145,25 @@ ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_CF_SET);
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, do_follow ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    if (taken)
+        codegen_trace_taken(block, next_pc, dest_addr, do_follow);
+    return do_follow ? 1 : 0;
 }
 static int
 ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (!CF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = !CF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -171,21 +175,21 @@ ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             return 0;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
 
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
 
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -194,16 +198,18 @@ ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_CF_SET);
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, do_follow ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    if (taken)
+        codegen_trace_taken(block, next_pc, dest_addr, do_follow);
+    return do_follow ? 1 : 0;
 }
 
 /* Temporarily disable the unrolling of JZ/JNZ due to the code sometimes taking the wrong turn. */
@@ -277,33 +283,34 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((CF_SET() || ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = CF_SET() || ZF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Carry is always zero, so test zero only*/
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
             else
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
             break;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -311,7 +318,7 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (do_follow) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_CF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_ZF_SET);
@@ -324,12 +331,13 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             }
             break;
     }
-    if (do_unroll) {
+    if (do_follow) {
         uop_MOV_IMM(ir, IREG_pc, next_pc);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
+        codegen_trace_taken(block, next_pc, dest_addr, 1);
         return 1;
     } else {
         if (jump_uop2 != -1)
@@ -337,6 +345,8 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
+        if (taken)
+            codegen_trace_taken(block, next_pc, dest_addr, 0);
         return 0;
     }
 }
@@ -345,33 +355,34 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((!CF_SET() && !ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = !CF_SET() && !ZF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Carry is always zero, so test zero only*/
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
             else
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
             break;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -379,7 +390,7 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (do_follow) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_CF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_ZF_SET);
@@ -392,12 +403,13 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
             }
             break;
     }
-    if (do_unroll) {
+    if (do_follow) {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
         uop_MOV_IMM(ir, IREG_pc, next_pc);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
+        codegen_trace_taken(block, next_pc, dest_addr, 1);
         return 1;
     } else {
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
@@ -405,6 +417,8 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
+        if (taken)
+            codegen_trace_taken(block, next_pc, dest_addr, 0);
         return 0;
     }
 }
@@ -413,7 +427,8 @@ static int
 ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (NF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = NF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -424,7 +439,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_SAR8:
         case FLAGS_INC8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
@@ -438,7 +453,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_SAR16:
         case FLAGS_INC16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
@@ -452,7 +467,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_SAR32:
         case FLAGS_INC32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
@@ -461,22 +476,25 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_NF_SET);
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, do_follow ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    if (taken)
+        codegen_trace_taken(block, next_pc, dest_addr, do_follow);
+    return do_follow ? 1 : 0;
 }
 static int
 ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (!NF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = !NF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -487,7 +505,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_SAR8:
         case FLAGS_INC8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
@@ -501,7 +519,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_SAR16:
         case FLAGS_INC16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
@@ -515,7 +533,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_SAR32:
         case FLAGS_INC32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
@@ -524,16 +542,18 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_NF_SET);
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, do_follow ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    if (taken)
+        codegen_trace_taken(block, next_pc, dest_addr, do_follow);
+    return do_follow ? 1 : 0;
 }
 
 static int
@@ -565,24 +585,25 @@ static int
 ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = ((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = (NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0);
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
             /*V flag is always clear. Condition is true if N is set*/
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
             break;
         case FLAGS_ZN16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
             break;
         case FLAGS_ZN32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
@@ -590,21 +611,21 @@ ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
 
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -614,42 +635,45 @@ ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
             uop_CALL_FUNC_RESULT(ir, IREG_temp1, VF_SET_01);
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNZ_DEST(ir, IREG_temp0, IREG_temp1);
             else
                 jump_uop = uop_CMP_JZ_DEST(ir, IREG_temp0, IREG_temp1);
             break;
     }
-    if (do_unroll)
+    if (do_follow)
         uop_MOV_IMM(ir, IREG_pc, next_pc);
     else
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    if (taken)
+        codegen_trace_taken(block, next_pc, dest_addr, do_follow);
+    return do_follow ? 1 : 0;
 }
 static int
 ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = (NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0);
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
             /*V flag is always clear. Condition is true if N is set*/
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
             break;
         case FLAGS_ZN16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
             break;
         case FLAGS_ZN32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
@@ -657,21 +681,21 @@ ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -681,19 +705,21 @@ ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
             uop_CALL_FUNC_RESULT(ir, IREG_temp1, VF_SET_01);
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JZ_DEST(ir, IREG_temp0, IREG_temp1);
             else
                 jump_uop = uop_CMP_JNZ_DEST(ir, IREG_temp0, IREG_temp1);
             break;
     }
-    if (do_unroll)
+    if (do_follow)
         uop_MOV_IMM(ir, IREG_pc, next_pc);
     else
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    if (taken)
+        codegen_trace_taken(block, next_pc, dest_addr, do_follow);
+    return do_follow ? 1 : 0;
 }
 
 static int
@@ -701,26 +727,27 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = (((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) || ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = (NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) || ZF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -728,7 +755,7 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (do_follow) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_ZF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
@@ -743,12 +770,13 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             }
             break;
     }
-    if (do_unroll) {
+    if (do_follow) {
         uop_MOV_IMM(ir, IREG_pc, next_pc);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
+        codegen_trace_taken(block, next_pc, dest_addr, 1);
         return 1;
     } else {
         if (jump_uop2 != -1)
@@ -756,6 +784,8 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
+        if (taken)
+            codegen_trace_taken(block, next_pc, dest_addr, 0);
         return 0;
     }
 }
@@ -764,26 +794,27 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && !ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int taken     = (NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && !ZF_SET();
+    int do_follow = (taken && codegen_can_follow(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (do_follow)
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -791,7 +822,7 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (do_follow) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, jit_ZF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
@@ -806,12 +837,13 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
             }
             break;
     }
-    if (do_unroll) {
+    if (do_follow) {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
         uop_MOV_IMM(ir, IREG_pc, next_pc);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
+        codegen_trace_taken(block, next_pc, dest_addr, 1);
         return 1;
     } else {
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
@@ -819,6 +851,8 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
+        if (taken)
+            codegen_trace_taken(block, next_pc, dest_addr, 0);
         return 0;
     }
 }
@@ -125,3 +125,12 @@ codegen_can_unroll(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t
 
     return codegen_can_unroll_full(block, ir, next_pc, dest_addr);
 }
+
+/*Branch is taken this time through. Either unroll the loop it closes, or keep
+  compiling at its target if the block is a superblock following it. The
+  caller passes the answer to codegen_trace_taken() with the branch's exit.*/
+static inline int
+codegen_can_follow(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t dest_addr)
+{
+    return codegen_can_unroll(block, ir, next_pc, dest_addr) || codegen_trace_can_follow(block, next_pc, dest_addr);
+}
@@ -400,13 +400,18 @@ exec386_dynarec_dyn(void)
     uint32_t phys_addr = get_phys(cs + cpu_state.pc);
     int      hash      = HASH(phys_addr);
 #    ifdef USE_NEW_DYNAREC
-    codeblock_t *block = &codeblock[codeblock_hash[hash]];
+    codeblock_t *block;
 #    else
     codeblock_t *block = codeblock_hash[hash];
 #    endif
     int valid_block = 0;
 
 #    ifdef USE_NEW_DYNAREC
+    /* Pick up the background compiler's block, if it's done */
+    if (codegen_compile_pending)
+        codegen_compile_poll();
+    block = &codeblock[codeblock_hash[hash]];
+
     if (!cpu_state.abrt)
 #    else
     if (block && !cpu_state.abrt)
@@ -529,10 +534,21 @@ exec386_dynarec_dyn(void)
         acycs = 0;
 #    endif
         inrecomp = 0;
+#    ifdef USE_NEW_DYNAREC
+        if (codegen_trace_enabled)
+            codegen_trace_profile(block);
+#    endif
 
 #    ifndef USE_NEW_DYNAREC
         if (!use32)
             cpu_state.pc &= 0xffff;
+#    endif
+#    ifdef USE_NEW_DYNAREC
+    } else if (valid_block && !cpu_state.abrt && codegen_compile_pending) {
+        /* The background compiler is still busy, and owns the IR; interpret
+           the block and recompile it next time round */
+        codegen_compile_stats.deferred++;
+        exec386_dynarec_int();
 #    endif
     } else if (valid_block && !cpu_state.abrt) {
 #    ifdef USE_NEW_DYNAREC
@@ -582,6 +598,15 @@ exec386_dynarec_dyn(void)
 
                 if (x86_was_reset)
                     break;
+#    ifdef USE_NEW_DYNAREC
+                /* Superblock following a taken branch, carry on compiling at
+                   its target */
+                if (codegen_trace_continue) {
+                    codegen_trace_continue = 0;
+                    if (!cpu_state.abrt && (cs + cpu_state.pc) == codegen_trace_dest)
+                        cpu_block_end = 0;
+                }
+#    endif
             }
 
 #    ifndef USE_NEW_DYNAREC
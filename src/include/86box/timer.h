@@ -44,6 +44,9 @@ typedef struct pc_timer_t {
 
     struct pc_timer_t *prev;
     struct pc_timer_t *next;
+
+    uint64_t seq;      /* Enable order, newer timers first on a tie. */
+    int      heap_pos; /* Position in the heap of enabled timers, once there are many. */
 } pc_timer_t;
 
 #ifdef __cplusplus
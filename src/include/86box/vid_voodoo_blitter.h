@@ -18,5 +18,7 @@
 void voodoo_v2_blit_start(voodoo_t *voodoo);
 void voodoo_v2_blit_data(voodoo_t *voodoo, uint32_t data);
 void voodoo_fastfill(voodoo_t *voodoo, voodoo_params_t *params);
+void voodoo_fastfill_band(voodoo_t *voodoo, voodoo_params_t *params, int owner);
+void voodoo_fastfill_rows(voodoo_params_t *params, int y_origin, int *low_y, int *high_y);
 
 #endif /*VIDEO_VOODOO_BLITTER_H*/
@@ -0,0 +1,79 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Voodoo command stream capture, shared with the replay tool.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#ifndef VIDEO_VOODOO_CAPTURE_H
+#define VIDEO_VOODOO_CAPTURE_H
+
+#define VOODOO_CAPTURE_MAGIC   "86BVCAP"
+#define VOODOO_CAPTURE_VERSION 1
+
+/*Records are buffered and written out this many at a time*/
+#define VOODOO_CAPTURE_BUF_RECORDS 8192
+
+/*Record kinds, in the top byte of voodoo_capture_record_t.addr*/
+enum {
+    VOODOO_CAPTURE_WRITEL = 1, /*32-bit write to the card's 16 MB window*/
+    VOODOO_CAPTURE_WRITEW = 2, /*16-bit write to the card's 16 MB window*/
+    VOODOO_CAPTURE_PCI    = 3  /*PCI config space byte write*/
+};
+
+#define VOODOO_CAPTURE_ADDR_MASK 0xffffff
+#define VOODOO_CAPTURE_KIND(a)   ((a) >> 24)
+
+/*The card configuration the stream was recorded with. Everything the guest
+  does to the card after power-on follows as records.*/
+typedef struct voodoo_capture_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t type;
+    uint32_t fb_size;      /*MB*/
+    uint32_t texture_size; /*MB per TMU*/
+    uint32_t bilinear_enabled;
+    uint32_t dithersub_enabled;
+    uint32_t scrfilter;
+    uint32_t render_threads;
+    uint32_t recompiler;
+    uint32_t reserved[3];
+} voodoo_capture_header_t;
+
+typedef struct voodoo_capture_record_t {
+    uint32_t addr; /*kind << 24 | address within the window, or PCI register*/
+    uint32_t val;
+} voodoo_capture_record_t;
+
+typedef struct voodoo_capture_t {
+    FILE                   *fp;
+    uint64_t                records;
+    int                     pos;
+    voodoo_capture_record_t buf[VOODOO_CAPTURE_BUF_RECORDS];
+} voodoo_capture_t;
+
+struct voodoo_t;
+extern voodoo_capture_t *voodoo_capture_open(struct voodoo_t *voodoo, const char *fn);
+extern void              voodoo_capture_close(voodoo_capture_t *capture);
+extern void              voodoo_capture_flush(voodoo_capture_t *capture);
+
+/*Called on the CPU thread, in the order the guest accessed the card*/
+static __inline void
+voodoo_capture_write(voodoo_capture_t *capture, int kind, uint32_t addr, uint32_t val)
+{
+    voodoo_capture_record_t *record = &capture->buf[capture->pos];
+
+    record->addr = (kind << 24) | (addr & VOODOO_CAPTURE_ADDR_MASK);
+    record->val  = val;
+    if (++capture->pos == VOODOO_CAPTURE_BUF_RECORDS)
+        voodoo_capture_flush(capture);
+}
+
+#endif /*VIDEO_VOODOO_CAPTURE_H*/
@@ -57,16 +57,29 @@
 #    include <sys/mman.h>
 #endif
 
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <86box/vid_voodoo_jit_cache.h>
 
-#define BLOCK_NUM  32
+#define BLOCK_NUM  256
 #define BLOCK_MASK (BLOCK_NUM - 1)
 #define BLOCK_SIZE 16384
 
+/* Open-addressed hash index over the slots, kept at <= 25% load so probe
+ * chains stay short whatever BLOCK_NUM is. */
+#define INDEX_NUM       (BLOCK_NUM * 4)
+#define INDEX_MASK      (INDEX_NUM - 1)
+#define INDEX_EMPTY     -1
+#define INDEX_TOMBSTONE -2
+
 #define LOD_MASK (LOD_TMIRROR_S | LOD_TMIRROR_T)
 
+/* Bump whenever voodoo_generate() output changes, so persistent cache files
+ * written by an older code generator are discarded. */
+#define VOODOO_JIT_CACHE_REVISION 2
+
 /* ========================================================================
  * ARM64 Register Assignments (in generated code)
  * ========================================================================
@@ -121,10 +134,13 @@
  *
  * Each slot holds:
  *   code_block  -- pointer into MAP_JIT executable memory (BLOCK_SIZE bytes)
+ *   seq         -- seqlock counter. Odd while the slot is being recompiled;
+ *                  readers that see it change across a probe retry.
+ *   hash        -- hash of the key fields, also the slot's position in the
+ *                  voodoo->jit_index probe sequence
  *   <key fields> -- the hardware register state that uniquely identifies
  *                   the compiled pipeline variant (mirrors voodoo_x86_data_t)
- *   last_used   -- LRU timestamp (monotonic per-partition generation counter).
- *                  On hit, set to ++voodoo->jit_generation[partition].
+ *   last_used   -- LRU timestamp from the shared voodoo->jit_generation clock.
  *                  On reject, set to 0 so the slot is evicted first.
  *   valid       -- 1 if code_block holds valid compiled code
  *   rejected    -- 1 if this variant was rejected (emit overflow, W^X failure)
@@ -132,24 +148,27 @@
  *                  retrying JIT compilation.
  */
 typedef struct voodoo_arm64_data_t {
-    uint8_t *code_block;
-    uint64_t last_used;
-    int      xdir;
-    uint32_t alphaMode;
-    uint32_t fbzMode;
-    uint32_t fogMode;
-    uint32_t fbzColorPath;
-    uint32_t textureMode[2];
-    uint32_t tLOD[2];
-    uint32_t trexInit1;
-    int      is_tiled;
-    int      valid;
-    int      rejected;
+    uint8_t   *code_block;
+    uint64_t   last_used;
+    ATOMIC_INT seq;
+    uint32_t   hash;
+    int        xdir;
+    uint32_t   alphaMode;
+    uint32_t   fbzMode;
+    uint32_t   fogMode;
+    uint32_t   fbzColorPath;
+    uint32_t   textureMode[2];
+    uint32_t   tLOD[2];
+    uint32_t   trexInit1;
+    int        is_tiled;
+    int        valid;
+    int        rejected;
 } voodoo_arm64_data_t;
 
-/* LRU generation counter per partition (4 partitions = odd_even).
- * Per-instance in voodoo_t so SLI cards don't share eviction state.
- * Thread-safe: each partition is touched by exactly one render thread. */
+/* One cache of BLOCK_NUM slots is shared by all render threads, so a render
+ * state is compiled once no matter which thread meets it first.  The LRU
+ * clock and jit_last_block[] MRU hints live in voodoo_t (per instance, so
+ * SLI cards don't share eviction state). */
 
 /* Linux ARM64 without PROT_MPROTECT: pages are born RWX, so mprotect
  * toggles in set_writable/set_executable are redundant syscalls that
@@ -160,8 +179,6 @@ static int arm64_jit_rwx = 1;  /* Linux: born RWX, skip mprotect */
 static int arm64_jit_rwx = 0;
 #endif
 
-/* jit_last_block[4] is in voodoo_t for MRU-hint fast probe. */
-
 /* ========================================================================
  * Emission primitive -- ARM64 instructions are always 4 bytes
  * ======================================================================== */
@@ -176,10 +193,47 @@ arm64_codegen_begin_emit(void);
 
 static ARM64_CODEGEN_TLS int arm64_codegen_emit_overflow = 0;
 
+/* Absolute pointer loads emitted by voodoo_generate(), recorded so a block
+ * written to the persistent cache can be re-targeted when it is loaded into
+ * a later run (ASLR moves the tables between runs). */
+enum {
+    ARM64_RELOC_LOGTABLE = 0,
+    ARM64_RELOC_ALOOKUP,
+    ARM64_RELOC_AMINUSLOOKUP,
+    ARM64_RELOC_NEON_00_FF_W,
+    ARM64_RELOC_I_00_FF_W,
+    ARM64_RELOC_BILINEAR_LOOKUP,
+    ARM64_RELOC_RGB565,
+    ARM64_RELOC_NEON_01_W,
+    ARM64_RELOC_NEON_FF_W,
+    ARM64_RELOC_NEON_FF_B,
+    ARM64_RELOC_DITHER_RB,
+    ARM64_RELOC_DITHER_RB2X2,
+    ARM64_RELOC_MAX
+};
+
+static ARM64_CODEGEN_TLS voodoo_jit_cache_reloc_t arm64_codegen_relocs[VOODOO_JIT_CACHE_MAX_RELOCS];
+static ARM64_CODEGEN_TLS int                      arm64_codegen_reloc_count = 0;
+
 static inline void
 arm64_codegen_begin_emit(void)
 {
     arm64_codegen_emit_overflow = 0;
+    arm64_codegen_reloc_count   = 0;
+}
+
+static inline void
+arm64_codegen_add_reloc(int sym, int start_pos, int end_pos)
+{
+    /* One past the limit marks the block as not persistable */
+    if (arm64_codegen_reloc_count >= VOODOO_JIT_CACHE_MAX_RELOCS) {
+        arm64_codegen_reloc_count = VOODOO_JIT_CACHE_MAX_RELOCS + 1;
+        return;
+    }
+    arm64_codegen_relocs[arm64_codegen_reloc_count].pos = start_pos;
+    arm64_codegen_relocs[arm64_codegen_reloc_count].len = (end_pos - start_pos) >> 2;
+    arm64_codegen_relocs[arm64_codegen_reloc_count].sym = sym;
+    arm64_codegen_reloc_count++;
 }
 
 static inline int
@@ -822,6 +876,9 @@ arm64_codegen_check_branch_offset(const char *kind, int32_t off, int imm_bits)
 #define ARM64_ADD_V4S(d, n, m)  (0x4EA08400 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_SUB_V2S(d, n, m)  (0x2EA08400 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_SUB_V4S(d, n, m)  (0x6EA08400 | Rm(m) | Rn(n) | Rd(d))
+#define ARM64_MUL_V4S(d, n, m)  (0x4EA09C00 | Rm(m) | Rn(n) | Rd(d))
+#define ARM64_SMAX_V4S(d, n, m) (0x4EA06400 | Rm(m) | Rn(n) | Rd(d))
+#define ARM64_SMIN_V4S(d, n, m) (0x4EA06C00 | Rm(m) | Rn(n) | Rd(d))
 
 /* 64-bit */
 #define ARM64_ADD_V2D(d, n, m)  (0x4EE08400 | Rm(m) | Rn(n) | Rd(d))
@@ -836,6 +893,9 @@ arm64_codegen_check_branch_offset(const char *kind, int32_t off, int imm_bits)
 #define ARM64_ADDP_V4S(d, n, m) (0x4EA0BC00 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_ADDP_V8H(d, n, m) (0x4E60BC00 | Rm(m) | Rn(n) | Rd(d))
 
+/* Across lanes: UMAXV Sd, Vn.4S */
+#define ARM64_UMAXV_S_4S(d, n)  (0x6EB0A800 | Rn(n) | Rd(d))
+
 /* ========================================================================
  * Section 22: NEON Saturating Arithmetic
  * ======================================================================== */
@@ -925,6 +985,9 @@ arm64_codegen_check_branch_offset(const char *kind, int32_t off, int imm_bits)
 /* DUP Vd.2S, Wn */
 #define ARM64_DUP_V2S_GPR(d, n) (0x0E040C00 | Rn(n) | Rd(d))
 
+/* DUP Vd.4S, Wn */
+#define ARM64_DUP_V4S_GPR(d, n) (0x4E040C00 | Rn(n) | Rd(d))
+
 /* DUP Vd.4H, Wn */
 #define ARM64_DUP_V4H_GPR(d, n) (0x0E020C00 | Rn(n) | Rd(d))
 
@@ -969,6 +1032,8 @@ arm64_codegen_check_branch_offset(const char *kind, int32_t off, int imm_bits)
 #define ARM64_CMEQ_V2S(d, n, m)    (0x2EA08C00 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_CMGT_V4H(d, n, m)    (0x0E603400 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_CMGT_V2S(d, n, m)    (0x0EA03400 | Rm(m) | Rn(n) | Rd(d))
+#define ARM64_CMEQ_V4S(d, n, m)    (0x6EA08C00 | Rm(m) | Rn(n) | Rd(d))
+#define ARM64_CMGT_V4S(d, n, m)    (0x4EA03400 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_CMHI_V4H(d, n, m)    (0x2E603400 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_CMGE_V4H(d, n, m)    (0x0E603C00 | Rm(m) | Rn(n) | Rd(d))
 #define ARM64_CMEQ_V4H_ZERO(d, n)  (0x0E609800 | Rn(n) | Rd(d))
@@ -1848,6 +1913,518 @@ codegen_texture_fetch(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *pa
     return block_pos;
 }
 
+/* ========================================================================
+ * voodoo_generate_span4() -- four pixels per loop iteration
+ * ========================================================================
+ *
+ * Flat and Gouraud shaded spans with no texture, fog, alpha test or alpha
+ * blend (menus, 2D overlays, HUDs, untextured geometry) spend most of the
+ * per-pixel loop on bookkeeping rather than shading. For those states the
+ * whole pipeline fits in 32-bit NEON lanes, so this variant shades four
+ * adjacent pixels per iteration: every value is kept planar, one register
+ * per channel with lane n holding pixel x + n * xdir.
+ *
+ * The only per-pixel work left is what has no vector form: gathering the
+ * old depth values, the dither table lookups and the 16-bit stores. Those
+ * run per lane behind a live-lane mask. Lanes past x2 or failing the depth
+ * test drop out of the mask instead of branching, and a group where every
+ * lane fails skips the shading altogether.
+ *
+ * The results match voodoo_generate()'s per-pixel loop bit for bit. Like
+ * that loop, only state->pixel_count is meaningful on return; the caller
+ * rebuilds the iterators from the line bases for the next span.
+ *
+ * Register usage (leaf function, d8-d15 saved for v8-v14):
+ *   w2  = x of lane 0            w3  = real_y row offset into dither entry
+ *   w4  = x2 (prologue only)     x5  = fb_mem, x6 = aux_mem
+ *   w7  = pixels left            w8  = color0, w9 = color1
+ *   x10 = dither_rb table        x11 = dither_g table
+ *   w12-w17 = scratch
+ *
+ *   v0  = live-lane mask         v1  = new depth
+ *   v2, v3 = scratch             v4  = iterated alpha
+ *   v5  = alocal (if not v4)     v6  = aother (if not v4)
+ *   v7  = combined alpha         v8-v10 = per-channel scratch
+ *   v12-v14 = combined R, G, B (or packed RGB565 in v12)
+ *   v16-v20 = B, G, R, A, Z iterators
+ *   v21-v25 = B, G, R, A, Z steps for four pixels
+ *   v26 = 0xff  v27 = {0, 1, 2, 3}  v28 = 0xffff  v29 = 0
+ *   v30 = depth bias             v31 = depth source (zaColor)
+ * ======================================================================== */
+
+/* Can voodoo_generate_span4() handle this render state? */
+static inline int
+voodoo_span4_ok(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    if (!voodoo->jit_span4_enabled)
+        return 0;
+    if (params->fbzColorPath & FBZCP_TEXTURE_ENABLED)
+        return 0;
+    if (params->fbzMode & (FBZ_STIPPLE | FBZ_CHROMAKEY | FBZ_ALPHA_MASK | FBZ_W_BUFFER))
+        return 0;
+    if ((params->fogMode & FOG_ENABLE) || (params->alphaMode & ((1 << 0) | (1 << 4))))
+        return 0;
+    if (cc_localselect_override)
+        return 0;
+    if ((_rgb_sel != CC_LOCALSELECT_ITER_RGB && _rgb_sel != CC_LOCALSELECT_COLOR1)
+        || (a_sel != A_SEL_ITER_A && a_sel != A_SEL_COLOR1))
+        return 0;
+    if (cca_localselect > CCA_LOCALSELECT_ITER_Z || cc_mselect > CC_MSELECT_ALOCAL
+        || cca_mselect > CCA_MSELECT_ALOCAL2 || cc_add == 3)
+        return 0;
+
+    return 1;
+}
+
+/*
+ * One colour or alpha channel of the combine unit:
+ *   dst = zero_other ? 0 : other
+ *   dst -= local                      (if sub_local)
+ *   dst = (dst * (msel' + 1)) >> 8    (msel' = msel ^ 0xff unless reverse)
+ *   dst += add                        (if add >= 0)
+ *   dst = CLAMP(dst) ^ (invert ? 0xff : 0)
+ * dst must not alias any of the source registers; v2 is clobbered.
+ */
+static inline int
+codegen_span4_combine(uint8_t *code_block, int block_pos, int dst, int other, int local, int zero_other,
+                      int sub_local, int msel, int reverse, int add, int invert)
+{
+    if (zero_other)
+        addlong(ARM64_MOVI_V4S_ZERO(dst));
+    else
+        addlong(ARM64_MOV_V(dst, other));
+    if (sub_local)
+        addlong(ARM64_SUB_V4S(dst, dst, local));
+
+    /* dst * (msel' + 1) == dst * msel' + dst */
+    if (reverse) {
+        addlong(ARM64_MUL_V4S(2, dst, msel));
+    } else {
+        addlong(ARM64_EOR_V(2, msel, 26));
+        addlong(ARM64_MUL_V4S(2, dst, 2));
+    }
+    addlong(ARM64_ADD_V4S(dst, dst, 2));
+    addlong(ARM64_SSHR_V4S(dst, dst, 8));
+
+    if (add >= 0)
+        addlong(ARM64_ADD_V4S(dst, dst, add));
+    addlong(ARM64_SMAX_V4S(dst, dst, 29));
+    addlong(ARM64_SMIN_V4S(dst, dst, 26));
+    if (invert)
+        addlong(ARM64_EOR_V(dst, dst, 26));
+
+    return block_pos;
+}
+
+/* dst = x + lane * xdir; returns the register holding the lane's x */
+static inline int
+codegen_span4_lane_x(uint8_t *code_block, int *block_pos_p, int dst, int lane, int xdir)
+{
+    int block_pos = *block_pos_p;
+
+    if (!lane)
+        return 2;
+    if (xdir > 0)
+        addlong(ARM64_ADD_IMM(dst, 2, lane));
+    else
+        addlong(ARM64_SUB_IMM(dst, 2, lane));
+    *block_pos_p = block_pos;
+
+    return dst;
+}
+
+static inline int
+voodoo_generate_span4(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int depthop)
+{
+    int block_pos   = 0;
+    int loop_pos    = 0;
+    int skip_pos    = 0;
+    int depth_test  = (params->fbzMode & FBZ_DEPTH_ENABLE) && (depthop != DEPTHOP_ALWAYS);
+    int rgb_write   = params->fbzMode & FBZ_RGB_WMASK;
+    int alpha_write = (params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_ALPHA_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_ALPHA_ENABLE);
+    int depth_write = !alpha_write && (params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE);
+    int tiled       = params->col_tiled || params->aux_tiled;
+    int dither_sh   = dither2x2 ? 2 : 4;
+    int alocal      = 4;
+    int aother      = 4;
+
+    voodoo->jit_span4_blocks++;
+
+    /* ================================================================
+     * Prologue
+     * ================================================================ */
+    addlong(ARM64_SUB_IMM_X(31, 31, 64));
+    addlong(ARM64_STP_D(8, 9, 31, 0));
+    addlong(ARM64_STP_D(10, 11, 31, 16));
+    addlong(ARM64_STP_D(12, 13, 31, 32));
+    addlong(ARM64_STP_D(14, 15, 31, 48));
+
+    /* w7 = pixels in the span; the whole span is counted up front */
+    addlong(ARM64_LDR_W(4, 0, STATE_x2));
+    if (state->xdir > 0)
+        addlong(ARM64_SUB_REG(7, 4, 2));
+    else
+        addlong(ARM64_SUB_REG(7, 2, 4));
+    addlong(ARM64_ADD_IMM(7, 7, 1));
+    addlong(ARM64_LDR_W(12, 0, STATE_pixel_count));
+    addlong(ARM64_ADD_REG(12, 12, 7));
+    addlong(ARM64_STR_W(12, 0, STATE_pixel_count));
+
+    addlong(ARM64_LDP_OFF_X(5, 6, 0, STATE_fb_mem));
+    addlong(ARM64_LDR_W(8, 1, PARAMS_color0));
+    addlong(ARM64_LDR_W(9, 1, PARAMS_color1));
+
+    /* Constants */
+    addlong(ARM64_MOVI_V4S_ZERO(29));
+    addlong(ARM64_MOVZ_W(12, 0xff));
+    addlong(ARM64_DUP_V4S_GPR(26, 12));
+    addlong(ARM64_MOVZ_W(12, 0xffff));
+    addlong(ARM64_DUP_V4S_GPR(28, 12));
+    addlong(ARM64_MOVI_V4S_ZERO(27));
+    for (int lane = 1; lane < 4; lane++) {
+        addlong(ARM64_MOVZ_W(12, lane));
+        addlong(ARM64_INS_S(27, lane, 12));
+    }
+
+    /* Iterators: lane n starts n pixels in, and every iteration steps all
+     * lanes by four pixels. */
+    addlong(ARM64_ADD_IMM_X(16, 0, STATE_ib));
+    addlong(ARM64_LD1_V4S(0, 16)); /* v0 = {ib, ig, ir, ia} */
+    addlong(ARM64_ADD_IMM_X(16, 1, PARAMS_dBdX));
+    addlong(ARM64_LD1_V4S(1, 16)); /* v1 = {dBdX, dGdX, dRdX, dAdX} */
+    for (int c = 0; c < 4; c++) {
+        addlong(ARM64_DUP_V4S_LANE(16 + c, 0, c));
+        addlong(ARM64_DUP_V4S_LANE(21 + c, 1, c));
+    }
+    addlong(ARM64_LDR_W(12, 0, STATE_z));
+    addlong(ARM64_DUP_V4S_GPR(20, 12));
+    addlong(ARM64_LDR_W(12, 1, PARAMS_dZdX));
+    addlong(ARM64_DUP_V4S_GPR(25, 12));
+    for (int c = 0; c < 5; c++) {
+        if (state->xdir < 0)
+            addlong(ARM64_SUB_V4S(21 + c, 29, 21 + c));
+        addlong(ARM64_MUL_V4S(2, 21 + c, 27));
+        addlong(ARM64_ADD_V4S(16 + c, 16 + c, 2));
+        addlong(ARM64_SHL_V4S(21 + c, 21 + c, 2));
+    }
+
+    if (params->fbzMode & FBZ_DEPTH_BIAS) {
+        addlong(ARM64_LDR_W(12, 1, PARAMS_zaColor));
+        addlong(ARM64_SXTH(12, 12));
+        addlong(ARM64_DUP_V4S_GPR(30, 12));
+    }
+    if (depth_test && (params->fbzMode & FBZ_DEPTH_SOURCE)) {
+        addlong(ARM64_LDRH_IMM(12, 1, PARAMS_zaColor));
+        addlong(ARM64_DUP_V4S_GPR(31, 12));
+    }
+
+    if (rgb_write && dither) {
+        int       _dstart        = block_pos;
+        uintptr_t dither_rb_addr = dither2x2 ? (uintptr_t) dither_rb2x2 : (uintptr_t) dither_rb;
+        uintptr_t g_offset       = dither2x2 ? ((uintptr_t) dither_g2x2 - (uintptr_t) dither_rb2x2) :
+                                               ((uintptr_t) dither_g - (uintptr_t) dither_rb);
+        uint16_t  _dh0           = dither_rb_addr & 0xFFFF;
+        uint16_t  _dh1           = (dither_rb_addr >> 16) & 0xFFFF;
+        uint16_t  _dh2           = (dither_rb_addr >> 32) & 0xFFFF;
+        uint16_t  _dh3           = (dither_rb_addr >> 48) & 0xFFFF;
+        int       _df            = (_dh0) ? 0 : (_dh1) ? 1 : (_dh2) ? 2 : 3;
+        uint16_t  _dfv           = (_df == 0) ? _dh0 : (_df == 1) ? _dh1
+                                 : (_df == 2) ? _dh2 : _dh3;
+
+        /* x10 = dither_rb */
+        addlong(ARM64_MOVZ_X_HW(10, _dfv, _df));
+        if (_df < 1 && _dh1)
+            addlong(ARM64_MOVK_X(10, _dh1, 1));
+        if (_df < 2 && _dh2)
+            addlong(ARM64_MOVK_X(10, _dh2, 2));
+        if (_df < 3 && _dh3)
+            addlong(ARM64_MOVK_X(10, _dh3, 3));
+        arm64_codegen_add_reloc(dither2x2 ? ARM64_RELOC_DITHER_RB2X2 : ARM64_RELOC_DITHER_RB, _dstart, block_pos);
+
+        /* x11 = dither_g, at a fixed offset from dither_rb */
+        addlong(ARM64_MOVZ_X(12, g_offset & 0xFFFF));
+        if ((g_offset >> 16) & 0xFFFF)
+            addlong(ARM64_MOVK_X(12, (g_offset >> 16) & 0xFFFF, 1));
+        if ((g_offset >> 32) & 0xFFFF)
+            addlong(ARM64_MOVK_X(12, (g_offset >> 32) & 0xFFFF, 2));
+        if ((g_offset >> 48) & 0xFFFF)
+            addlong(ARM64_MOVK_X(12, (g_offset >> 48) & 0xFFFF, 3));
+        addlong(ARM64_ADD_REG_X(11, 10, 12));
+
+        /* w3 = row within a table entry, constant for the span */
+        if (dither2x2) {
+            addlong(ARM64_AND_MASK(3, 3, 1));
+            addlong(ARM64_LSL_IMM(3, 3, 1));
+        } else {
+            addlong(ARM64_AND_MASK(3, 3, 2));
+            addlong(ARM64_LSL_IMM(3, 3, 2));
+        }
+    }
+
+    /* ================================================================
+     * Group loop
+     * ================================================================ */
+    loop_pos = block_pos;
+
+    /* v0 = live lanes: lane < pixels left */
+    addlong(ARM64_DUP_V4S_GPR(0, 7));
+    addlong(ARM64_CMGT_V4S(0, 0, 27));
+
+    /* v1 = new_depth = CLAMP16(z >> 12), plus depth bias */
+    if (depth_test || depth_write) {
+        addlong(ARM64_SSHR_V4S(1, 20, 12));
+        addlong(ARM64_SMAX_V4S(1, 1, 29));
+        addlong(ARM64_SMIN_V4S(1, 1, 28));
+        if (params->fbzMode & FBZ_DEPTH_BIAS) {
+            addlong(ARM64_ADD_V4S(1, 1, 30));
+            addlong(ARM64_SMAX_V4S(1, 1, 29));
+            addlong(ARM64_SMIN_V4S(1, 1, 28));
+        }
+    }
+
+    if (depth_test) {
+        int comp = (params->fbzMode & FBZ_DEPTH_SOURCE) ? 31 : 1;
+
+        /* v2 = old depth, gathered only for lanes inside the span */
+        for (int lane = 0; lane < 4; lane++) {
+            int lane_skip_pos = 0;
+            int xr;
+
+            if (lane) {
+                addlong(ARM64_CMP_IMM(7, lane));
+                lane_skip_pos = block_pos;
+                addlong(ARM64_BCOND_PLACEHOLDER(COND_LE));
+            }
+            xr = codegen_span4_lane_x(code_block, &block_pos, 12, lane, state->xdir);
+            if (params->aux_tiled) {
+                addlong(ARM64_AND_MASK(13, xr, 6));
+                addlong(ARM64_LSR_IMM(14, xr, 6));
+                addlong(ARM64_ADD_REG_LSL(13, 13, 14, 11));
+                xr = 13;
+            }
+            addlong(ARM64_LDRH_REG_LSL1(14, 6, xr));
+            addlong(ARM64_INS_S(2, lane, 14));
+            if (lane)
+                PATCH_FORWARD_BCOND(lane_skip_pos);
+        }
+
+        /* Depth values are 0..0xffff, so signed lane compares are safe */
+        switch (depthop) {
+            case DEPTHOP_LESSTHAN:
+                addlong(ARM64_CMGT_V4S(3, 2, comp));
+                addlong(ARM64_AND_V(0, 0, 3));
+                break;
+            case DEPTHOP_EQUAL:
+                addlong(ARM64_CMEQ_V4S(3, comp, 2));
+                addlong(ARM64_AND_V(0, 0, 3));
+                break;
+            case DEPTHOP_LESSTHANEQUAL:
+                addlong(ARM64_CMGT_V4S(3, comp, 2));
+                addlong(ARM64_BIC_V(0, 0, 3));
+                break;
+            case DEPTHOP_GREATERTHAN:
+                addlong(ARM64_CMGT_V4S(3, comp, 2));
+                addlong(ARM64_AND_V(0, 0, 3));
+                break;
+            case DEPTHOP_NOTEQUAL:
+                addlong(ARM64_CMEQ_V4S(3, comp, 2));
+                addlong(ARM64_BIC_V(0, 0, 3));
+                break;
+            case DEPTHOP_GREATERTHANEQUAL:
+                addlong(ARM64_CMGT_V4S(3, 2, comp));
+                addlong(ARM64_BIC_V(0, 0, 3));
+                break;
+            default:
+                fatal("Bad depthop\n");
+        }
+
+        /* Every lane failed: skip straight to the next group */
+        addlong(ARM64_UMAXV_S_4S(3, 0));
+        addlong(ARM64_FMOV_W_S(12, 3));
+        skip_pos = block_pos;
+        addlong(ARM64_CBZ_W_PLACEHOLDER(12));
+    }
+
+    /* ================================================================
+     * Colour and alpha combine
+     * ================================================================ */
+    if (rgb_write || alpha_write) {
+        /* v4 = iterated alpha */
+        addlong(ARM64_SSHR_V4S(4, 19, 12));
+        addlong(ARM64_SMAX_V4S(4, 4, 29));
+        addlong(ARM64_SMIN_V4S(4, 4, 26));
+
+        if (cca_localselect == CCA_LOCALSELECT_COLOR0) {
+            addlong(ARM64_UBFX(12, 8, 24, 8));
+            addlong(ARM64_DUP_V4S_GPR(5, 12));
+            alocal = 5;
+        } else if (cca_localselect == CCA_LOCALSELECT_ITER_Z) {
+            addlong(ARM64_SSHR_V4S(5, 20, 20));
+            addlong(ARM64_SMAX_V4S(5, 5, 29));
+            addlong(ARM64_SMIN_V4S(5, 5, 26));
+            alocal = 5;
+        }
+        if (a_sel == A_SEL_COLOR1) {
+            addlong(ARM64_UBFX(12, 9, 24, 8));
+            addlong(ARM64_DUP_V4S_GPR(6, 12));
+            aother = 6;
+        }
+
+        if (alpha_write) {
+            int msel = (cca_mselect == CCA_MSELECT_ZERO) ? 29 : (cca_mselect == CCA_MSELECT_AOTHER) ? aother : alocal;
+
+            block_pos = codegen_span4_combine(code_block, block_pos, 7, aother, alocal, cca_zero_other, cca_sub_clocal,
+                                              msel, cca_reverse_blend, cca_add ? alocal : -1, cca_invert_output);
+        }
+
+        if (rgb_write) {
+            /* R, G, B: colour shift, iterator, result register */
+            static const int chan[3][3] = {
+                { 16, 18, 12 },
+                {  8, 17, 13 },
+                {  0, 16, 14 }
+            };
+
+            for (int c = 0; c < 3; c++) {
+                int clocal = 8;
+                int cother = 8;
+                int msel;
+                int add;
+
+                if (!cc_localselect || _rgb_sel == CC_LOCALSELECT_ITER_RGB) {
+                    addlong(ARM64_SSHR_V4S(8, chan[c][1], 12));
+                    addlong(ARM64_SMAX_V4S(8, 8, 29));
+                    addlong(ARM64_SMIN_V4S(8, 8, 26));
+                }
+                if (cc_localselect) {
+                    addlong(ARM64_UBFX(12, 8, chan[c][0], 8));
+                    addlong(ARM64_DUP_V4S_GPR(9, 12));
+                    clocal = 9;
+                }
+                if (_rgb_sel == CC_LOCALSELECT_COLOR1) {
+                    addlong(ARM64_UBFX(12, 9, chan[c][0], 8));
+                    addlong(ARM64_DUP_V4S_GPR(10, 12));
+                    cother = 10;
+                }
+
+                switch (cc_mselect) {
+                    case CC_MSELECT_CLOCAL:
+                        msel = clocal;
+                        break;
+                    case CC_MSELECT_AOTHER:
+                        msel = aother;
+                        break;
+                    case CC_MSELECT_ALOCAL:
+                        msel = alocal;
+                        break;
+                    default:
+                        msel = 29;
+                        break;
+                }
+                add = (cc_add == CC_ADD_CLOCAL) ? clocal : (cc_add == CC_ADD_ALOCAL) ? alocal : -1;
+
+                block_pos = codegen_span4_combine(code_block, block_pos, chan[c][2], cother, clocal, cc_zero_other, cc_sub_clocal,
+                                                  msel, cc_reverse_blend, add, cc_invert_output);
+            }
+
+            if (!dither) {
+                /* v12 = RGB565 */
+                addlong(ARM64_USHR_V4S(12, 12, 3));
+                addlong(ARM64_SHL_V4S(12, 12, 11));
+                addlong(ARM64_USHR_V4S(13, 13, 2));
+                addlong(ARM64_SHL_V4S(13, 13, 5));
+                addlong(ARM64_ORR_V(12, 12, 13));
+                addlong(ARM64_USHR_V4S(14, 14, 3));
+                addlong(ARM64_ORR_V(12, 12, 14));
+            }
+        }
+    }
+
+    /* ================================================================
+     * Per-lane dither and stores
+     * ================================================================ */
+    for (int lane = 0; lane < 4; lane++) {
+        int lane_skip_pos;
+        int xr;
+        int xt = 0;
+
+        addlong(ARM64_UMOV_W_S(12, 0, lane));
+        lane_skip_pos = block_pos;
+        addlong(ARM64_CBZ_W_PLACEHOLDER(12));
+
+        xr = codegen_span4_lane_x(code_block, &block_pos, 13, lane, state->xdir);
+        if (tiled) {
+            addlong(ARM64_AND_MASK(14, xr, 6));
+            addlong(ARM64_LSR_IMM(15, xr, 6));
+            addlong(ARM64_ADD_REG_LSL(14, 14, 15, 11));
+            xt = 14;
+        }
+
+        if (rgb_write) {
+            if (dither) {
+                /* w15 = dither_xx[0][y][x] offset */
+                addlong(ARM64_AND_MASK(15, xr, dither2x2 ? 1 : 2));
+                addlong(ARM64_ADD_REG(15, 15, 3));
+                /* R */
+                addlong(ARM64_UMOV_W_S(16, 12, lane));
+                addlong(ARM64_ADD_REG_LSL(16, 15, 16, dither_sh));
+                addlong(ARM64_LDRB_REG(16, 10, 16));
+                addlong(ARM64_LSL_IMM(16, 16, 11));
+                /* G */
+                addlong(ARM64_UMOV_W_S(17, 13, lane));
+                addlong(ARM64_ADD_REG_LSL(17, 15, 17, dither_sh));
+                addlong(ARM64_LDRB_REG(17, 11, 17));
+                addlong(ARM64_BFI(16, 17, 5, 6));
+                /* B */
+                addlong(ARM64_UMOV_W_S(17, 14, lane));
+                addlong(ARM64_ADD_REG_LSL(17, 15, 17, dither_sh));
+                addlong(ARM64_LDRB_REG(17, 10, 17));
+                addlong(ARM64_ORR_REG(16, 16, 17));
+            } else {
+                addlong(ARM64_UMOV_W_S(16, 12, lane));
+            }
+            addlong(ARM64_STRH_REG_LSL1(16, 5, params->col_tiled ? xt : xr));
+        }
+
+        if (alpha_write || depth_write) {
+            addlong(ARM64_UMOV_W_S(16, alpha_write ? 7 : 1, lane));
+            addlong(ARM64_STRH_REG_LSL1(16, 6, params->aux_tiled ? xt : xr));
+        }
+
+        PATCH_FORWARD_CBxZ(lane_skip_pos);
+    }
+
+    /* ================================================================
+     * Step to the next group of four
+     * ================================================================ */
+    if (skip_pos)
+        PATCH_FORWARD_CBxZ(skip_pos);
+
+    for (int c = 0; c < 5; c++)
+        addlong(ARM64_ADD_V4S(16 + c, 16 + c, 21 + c));
+    if (state->xdir > 0)
+        addlong(ARM64_ADD_IMM(2, 2, 4));
+    else
+        addlong(ARM64_SUB_IMM(2, 2, 4));
+    addlong(ARM64_SUBS_IMM(7, 7, 4));
+    {
+        int32_t loop_offset = loop_pos - block_pos;
+        addlong(ARM64_BCOND(loop_offset, COND_GT));
+    }
+
+    /* ================================================================
+     * Epilogue
+     * ================================================================ */
+    addlong(ARM64_LDP_D(14, 15, 31, 48));
+    addlong(ARM64_LDP_D(12, 13, 31, 32));
+    addlong(ARM64_LDP_D(10, 11, 31, 16));
+    addlong(ARM64_LDP_D(8, 9, 31, 0));
+    addlong(ARM64_ADD_IMM_X(31, 31, 64));
+    addlong(ARM64_RET);
+
+    return block_pos;
+}
+
 /* ========================================================================
  * voodoo_generate() -- emit ARM64 JIT code for the pixel pipeline
  *
@@ -1925,6 +2502,10 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
         return block_pos;
     }
 
+    /* Simple untextured states take the four-pixels-per-iteration loop */
+    if (voodoo_span4_ok(voodoo, params))
+        return voodoo_generate_span4(code_block, voodoo, params, state, depthop);
+
     /* Re-initialize NEON constants before every emit. These constants are
      * read by the PROLOGUE's LDR Q instructions that load them into pinned
      * callee-saved NEON registers (v8-v11). Because the constants are in
@@ -2014,8 +2595,9 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
  * (which zeros everything else), then MOVK only for remaining non-zero
  * halfwords. On macOS ARM64, hw=3 is always 0 for user pointers, saving
  * 1+ MOVK per load. Typical macOS pointer saves 1-2 instructions. */
-#define EMIT_MOV_IMM64(d, ptr)                                                   \
+#define EMIT_MOV_IMM64(d, ptr, sym)                                              \
     do {                                                                          \
+        int      _start = block_pos;                                             \
         uint64_t _v = (uint64_t) (uintptr_t) (ptr);                              \
         uint16_t _hw0 = (_v) & 0xFFFF;                                           \
         uint16_t _hw1 = ((_v) >> 16) & 0xFFFF;                                   \
@@ -2033,15 +2615,16 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
             addlong(ARM64_MOVK_X((d), _hw2, 2));                                 \
         if (_first < 3 && _hw3)                                                  \
             addlong(ARM64_MOVK_X((d), _hw3, 3));                                 \
+        arm64_codegen_add_reloc((sym), _start, block_pos);                       \
     } while (0)
 
-        EMIT_MOV_IMM64(19, &logtable);
-        EMIT_MOV_IMM64(20, &alookup);
-        EMIT_MOV_IMM64(21, &aminuslookup);
-        EMIT_MOV_IMM64(22, &neon_00_ff_w);
-        EMIT_MOV_IMM64(23, &i_00_ff_w);
-        EMIT_MOV_IMM64(25, &bilinear_lookup);
-        EMIT_MOV_IMM64(26, &rgb565);
+        EMIT_MOV_IMM64(19, &logtable, ARM64_RELOC_LOGTABLE);
+        EMIT_MOV_IMM64(20, &alookup, ARM64_RELOC_ALOOKUP);
+        EMIT_MOV_IMM64(21, &aminuslookup, ARM64_RELOC_AMINUSLOOKUP);
+        EMIT_MOV_IMM64(22, &neon_00_ff_w, ARM64_RELOC_NEON_00_FF_W);
+        EMIT_MOV_IMM64(23, &i_00_ff_w, ARM64_RELOC_I_00_FF_W);
+        EMIT_MOV_IMM64(25, &bilinear_lookup, ARM64_RELOC_BILINEAR_LOOKUP);
+        EMIT_MOV_IMM64(26, &rgb565, ARM64_RELOC_RGB565);
 
 #undef EMIT_MOV_IMM64
     }
@@ -2064,8 +2647,9 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
         uint64_t addr;
 
 /* Same zero-halfword skip as EMIT_MOV_IMM64 for pointer into x16. */
-#define EMIT_LOAD_NEON_CONST(vreg, constaddr)                                        \
+#define EMIT_LOAD_NEON_CONST(vreg, constaddr, sym)                                   \
     do {                                                                             \
+        int _start = block_pos;                                                     \
         addr = (uint64_t) (uintptr_t) (constaddr);                                  \
         uint16_t _h0 = addr & 0xFFFF;                                               \
         uint16_t _h1 = (addr >> 16) & 0xFFFF;                                       \
@@ -2081,12 +2665,13 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
             addlong(ARM64_MOVK_X(16, _h2, 2));                                      \
         if (_f < 3 && _h3)                                                           \
             addlong(ARM64_MOVK_X(16, _h3, 3));                                      \
+        arm64_codegen_add_reloc((sym), _start, block_pos);                          \
         addlong(ARM64_LDR_Q((vreg), 16, 0));                                        \
     } while (0)
 
-        EMIT_LOAD_NEON_CONST(8, &neon_01_w);
-        EMIT_LOAD_NEON_CONST(9, &neon_ff_w);
-        EMIT_LOAD_NEON_CONST(10, &neon_ff_b);
+        EMIT_LOAD_NEON_CONST(8, &neon_01_w, ARM64_RELOC_NEON_01_W);
+        EMIT_LOAD_NEON_CONST(9, &neon_ff_w, ARM64_RELOC_NEON_FF_W);
+        EMIT_LOAD_NEON_CONST(10, &neon_ff_b, ARM64_RELOC_NEON_FF_B);
         /* v11 = fogColor, loaded below when fog is enabled */
 
 #undef EMIT_LOAD_NEON_CONST
@@ -4038,6 +4623,7 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
             /* ---- Dither path ---- */
             /* Load dither table base pointer into x7 (skip zero halfwords) */
             {
+                int       _dstart        = block_pos;
                 uintptr_t dither_rb_addr = dither2x2 ? (uintptr_t) dither_rb2x2 : (uintptr_t) dither_rb;
                 uint16_t _dh0 = dither_rb_addr & 0xFFFF;
                 uint16_t _dh1 = (dither_rb_addr >> 16) & 0xFFFF;
@@ -4053,6 +4639,7 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
                     addlong(ARM64_MOVK_X(7, _dh2, 2));
                 if (_df < 3 && _dh3)
                     addlong(ARM64_MOVK_X(7, _dh3, 3));
+                arm64_codegen_add_reloc(dither2x2 ? ARM64_RELOC_DITHER_RB2X2 : ARM64_RELOC_DITHER_RB, _dstart, block_pos);
             }
 
             /* w5 = real_y (saved in x24 by prologue) */
@@ -4448,6 +5035,22 @@ arm64_codegen_set_executable(uint8_t *code_block)
 #endif
 }
 
+static inline int
+arm64_codegen_key_matches(const voodoo_arm64_data_t *data, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state)
+{
+    return state->xdir == data->xdir
+        && params->alphaMode == data->alphaMode
+        && params->fbzMode == data->fbzMode
+        && params->fogMode == data->fogMode
+        && params->fbzColorPath == data->fbzColorPath
+        && (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1
+        && params->textureMode[0] == data->textureMode[0]
+        && params->textureMode[1] == data->textureMode[1]
+        && (params->tLOD[0] & LOD_MASK) == data->tLOD[0]
+        && (params->tLOD[1] & LOD_MASK) == data->tLOD[1]
+        && ((params->col_tiled || params->aux_tiled) ? 1 : 0) == data->is_tiled;
+}
+
 static inline void
 arm64_codegen_store_cache_key(voodoo_arm64_data_t *data, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int valid, int rejected)
 {
@@ -4480,16 +5083,27 @@ arm64_codegen_store_cache_key(voodoo_arm64_data_t *data, voodoo_t *voodoo, voodo
  * for the active pipeline stages. This is dramatically faster than the
  * C interpreter, which must check every option on every pixel.
  *
- * Blocks are cached in a 32-entry LRU cache per partition. When the game
- * changes rendering state (e.g., switches from opaque to transparent
- * objects), a new block is compiled for the new state. On miss, the
- * least-recently-used slot is evicted. Most games use only a handful of
- * distinct pipeline configurations per frame.
+ * Blocks live in a single BLOCK_NUM-entry LRU cache shared by every render
+ * thread. Previously each odd_even partition had its own 32 slots, so with
+ * four render threads every render state was compiled four times and held
+ * four code slots; now the first thread to meet a state compiles it and the
+ * others reuse the finished block.
  *
- * Array layout: contiguous per-partition (partition * BLOCK_NUM + slot).
- * This keeps all 32 slots for one partition in adjacent memory, reducing
- * cache line footprint during the linear scan from ~125 lines (interleaved)
- * to ~36 lines (contiguous) on a 64-byte cache line architecture.
+ * Concurrency:
+ *   - Hits are lock-free. Each slot carries a seqlock counter (seq, odd
+ *     while the slot is being rewritten). A reader samples seq, compares
+ *     the key, publishes the slot in voodoo->jit_hazard[odd_even] and then
+ *     re-reads seq; if it moved, the slot was recycled and the probe
+ *     restarts.
+ *   - Misses take voodoo->jit_mutex, probe again (another thread may have
+ *     just compiled the same key), and only then compile. This gives one
+ *     compiler per key; threads waiting on the same key pick up the result.
+ *   - A victim is claimed by making seq odd and then checking every render
+ *     thread's hazard slot. A thread keeps its hazard on the block it is
+ *     running until its next voodoo_get_block() call, so a block is never
+ *     overwritten while another thread may be executing it.
+ *   Both sides store-then-load through sequentially consistent atomics, so
+ *   at least one of them always sees the other.
  *
  * On macOS ARM64, the JIT must handle W^X (write-xor-execute) memory
  * protection: code pages are made writable for compilation, then switched
@@ -4499,99 +5113,461 @@ arm64_codegen_store_cache_key(voodoo_arm64_data_t *data, voodoo_t *voodoo, voodo
  * BLOCK_SIZE, to minimize unnecessary cache line invalidations.
  * ======================================================================== */
 
+/*
+ * arm64_codegen_key_hash() -- hash of the render-state key.
+ *
+ * Computed once per voodoo_get_block() call and reused for the MRU check,
+ * both index probes and the insert on a miss.
+ */
+static inline uint32_t
+arm64_codegen_key_hash(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    hash = (hash ^ (uint32_t) state->xdir) * 0x01000193;
+    hash = (hash ^ params->alphaMode) * 0x01000193;
+    hash = (hash ^ params->fbzMode) * 0x01000193;
+    hash = (hash ^ params->fogMode) * 0x01000193;
+    hash = (hash ^ params->fbzColorPath) * 0x01000193;
+    hash = (hash ^ (voodoo->trexInit1[0] & (1 << 18))) * 0x01000193;
+    hash = (hash ^ params->textureMode[0]) * 0x01000193;
+    hash = (hash ^ params->textureMode[1]) * 0x01000193;
+    hash = (hash ^ (params->tLOD[0] & LOD_MASK)) * 0x01000193;
+    hash = (hash ^ (params->tLOD[1] & LOD_MASK)) * 0x01000193;
+    hash = (hash ^ ((params->col_tiled || params->aux_tiled) ? 1 : 0)) * 0x01000193;
+
+    /* FNV leaves the low bits weakly mixed; the index only uses those */
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+
+    return hash;
+}
+
+/*
+ * arm64_codegen_probe_slot() -- compare one slot against the key and pin it.
+ *
+ * Returns 1 on a hit (slot pinned in jit_hazard[odd_even]), 0 on mismatch,
+ * or -1 if the slot was recycled between the compare and the pin, in which
+ * case the caller restarts its probe.
+ */
+static inline int
+arm64_codegen_probe_slot(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even, int slot, uint32_t hash)
+{
+    voodoo_arm64_data_t *data = &((voodoo_arm64_data_t *) voodoo->codegen_data)[slot];
+    int                  seq  = ATOMIC_LOAD(data->seq);
+
+    if ((seq & 1) || !(data->valid || data->rejected) || data->hash != hash)
+        return 0;
+    if (!arm64_codegen_key_matches(data, voodoo, params, state))
+        return 0;
+
+    ATOMIC_STORE(voodoo->jit_hazard[odd_even], slot);
+    if (ATOMIC_LOAD(data->seq) != seq)
+        return -1;
+
+    return 1;
+}
+
+/*
+ * arm64_codegen_lookup() -- lock-free probe of the shared cache.
+ *
+ * Tries the calling thread's MRU hint, then walks the key's chain in
+ * voodoo->jit_index. The index is only a hint to the lock-free side: every
+ * candidate is validated against the slot's own key and seq, so a probe that
+ * races with an index update can at worst miss and fall through to the
+ * locked probe, which sees a consistent index. On a hit the slot is pinned
+ * in jit_hazard[odd_even] and its index returned; -1 on miss.
+ */
+static inline int
+arm64_codegen_lookup(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even, uint32_t hash)
+{
+    int slot;
+    int ret;
+
+retry:
+    slot = voodoo->jit_last_block[odd_even];
+    ret  = arm64_codegen_probe_slot(voodoo, params, state, odd_even, slot, hash);
+    if (ret > 0)
+        return slot;
+    if (ret < 0)
+        goto retry;
+
+    for (int c = 0; c < INDEX_NUM; c++) {
+        slot = ATOMIC_LOAD(voodoo->jit_index[(hash + c) & INDEX_MASK]);
+        if (slot == INDEX_EMPTY)
+            break;
+        if (slot == INDEX_TOMBSTONE)
+            continue;
+
+        ret = arm64_codegen_probe_slot(voodoo, params, state, odd_even, slot, hash);
+        if (ret > 0)
+            return slot;
+        if (ret < 0)
+            goto retry;
+    }
+
+    return -1;
+}
+
+/*
+ * Index maintenance. Caller holds jit_mutex, so writers never race each
+ * other; lock-free readers are covered by the validation in
+ * arm64_codegen_probe_slot().
+ */
+static inline void
+arm64_codegen_index_place(voodoo_t *voodoo, int slot)
+{
+    voodoo_arm64_data_t *data = &((voodoo_arm64_data_t *) voodoo->codegen_data)[slot];
+
+    for (int c = 0; c < INDEX_NUM; c++) {
+        int pos  = (data->hash + c) & INDEX_MASK;
+        int prev = ATOMIC_LOAD(voodoo->jit_index[pos]);
+
+        if (prev == INDEX_EMPTY || prev == INDEX_TOMBSTONE) {
+            if (prev == INDEX_TOMBSTONE)
+                voodoo->jit_index_tombstones--;
+            ATOMIC_STORE(voodoo->jit_index[pos], slot);
+            return;
+        }
+    }
+}
+
+static inline void
+arm64_codegen_index_remove(voodoo_t *voodoo, int slot)
+{
+    voodoo_arm64_data_t *data = &((voodoo_arm64_data_t *) voodoo->codegen_data)[slot];
+
+    for (int c = 0; c < INDEX_NUM; c++) {
+        int pos  = (data->hash + c) & INDEX_MASK;
+        int prev = ATOMIC_LOAD(voodoo->jit_index[pos]);
+
+        if (prev == INDEX_EMPTY)
+            return;
+        if (prev == slot) {
+            ATOMIC_STORE(voodoo->jit_index[pos], INDEX_TOMBSTONE);
+            voodoo->jit_index_tombstones++;
+            return;
+        }
+    }
+}
+
+/* Insert a freshly keyed slot, rebuilding the index first once tombstones
+ * start lengthening the probe chains. */
+static inline void
+arm64_codegen_index_insert(voodoo_t *voodoo, int slot)
+{
+    voodoo_arm64_data_t *voodoo_arm64_data = voodoo->codegen_data;
+
+    if (voodoo->jit_index_tombstones > (INDEX_NUM / 4)) {
+        for (int c = 0; c < INDEX_NUM; c++)
+            ATOMIC_STORE(voodoo->jit_index[c], INDEX_EMPTY);
+        voodoo->jit_index_tombstones = 0;
+
+        for (int s = 0; s < BLOCK_NUM; s++) {
+            if (s != slot && (voodoo_arm64_data[s].valid || voodoo_arm64_data[s].rejected) && !(ATOMIC_LOAD(voodoo_arm64_data[s].seq) & 1))
+                arm64_codegen_index_place(voodoo, s);
+        }
+    }
+
+    arm64_codegen_index_place(voodoo, slot);
+}
+
+/*
+ * arm64_codegen_claim_victim() -- pick and lock the LRU slot for recompile.
+ *
+ * Caller holds jit_mutex. Slots pinned by any render thread are skipped.
+ * Returns with the victim's seq odd, or -1 if every slot is pinned (only
+ * possible with BLOCK_NUM <= render thread count).
+ */
+static inline int
+arm64_codegen_claim_victim(voodoo_t *voodoo)
+{
+    voodoo_arm64_data_t *voodoo_arm64_data = voodoo->codegen_data;
+    uint8_t              skip[BLOCK_NUM]   = { 0 };
+
+    for (int attempt = 0; attempt < BLOCK_NUM; attempt++) {
+        int      lru_slot = -1;
+        uint64_t lru_min  = UINT64_MAX;
+        int      pinned   = 0;
+
+        for (int s = 0; s < BLOCK_NUM; s++) {
+            if (!skip[s] && voodoo_arm64_data[s].last_used <= lru_min) {
+                lru_min  = voodoo_arm64_data[s].last_used;
+                lru_slot = s;
+            }
+        }
+        if (lru_slot < 0)
+            break;
+
+        ATOMIC_INC(voodoo_arm64_data[lru_slot].seq);
+        for (int t = 0; t < 4; t++) {
+            if (ATOMIC_LOAD(voodoo->jit_hazard[t]) == lru_slot)
+                pinned = 1;
+        }
+        if (!pinned)
+            return lru_slot;
+
+        /* Someone is (or may be) running it: release and try the next LRU */
+        ATOMIC_INC(voodoo_arm64_data[lru_slot].seq);
+        skip[lru_slot] = 1;
+    }
+
+    return -1;
+}
+
+/*
+ * ========================================================================
+ * PERSISTENT BLOCK CACHE
+ * ========================================================================
+ * Compiled blocks are also kept in a per-VM cache file (see
+ * vid_voodoo_jit_cache.c) so a later run can skip compilation for render
+ * states it has already met. The cached code is position-independent apart
+ * from the pointer loads recorded in arm64_codegen_relocs[]; on install each
+ * of those is re-emitted for the table's current address. The file is
+ * tagged with VOODOO_JIT_CACHE_REVISION and a fingerprint of everything
+ * else the code depends on (struct layouts, dither table spacing), so a
+ * file from a different build is simply discarded.
+ * ======================================================================== */
+
+static inline uintptr_t
+arm64_codegen_reloc_target(int sym)
+{
+    switch (sym) {
+        case ARM64_RELOC_LOGTABLE:
+            return (uintptr_t) &logtable;
+        case ARM64_RELOC_ALOOKUP:
+            return (uintptr_t) &alookup;
+        case ARM64_RELOC_AMINUSLOOKUP:
+            return (uintptr_t) &aminuslookup;
+        case ARM64_RELOC_NEON_00_FF_W:
+            return (uintptr_t) &neon_00_ff_w;
+        case ARM64_RELOC_I_00_FF_W:
+            return (uintptr_t) &i_00_ff_w;
+        case ARM64_RELOC_BILINEAR_LOOKUP:
+            return (uintptr_t) &bilinear_lookup;
+        case ARM64_RELOC_RGB565:
+            return (uintptr_t) &rgb565;
+        case ARM64_RELOC_NEON_01_W:
+            return (uintptr_t) &neon_01_w;
+        case ARM64_RELOC_NEON_FF_W:
+            return (uintptr_t) &neon_ff_w;
+        case ARM64_RELOC_NEON_FF_B:
+            return (uintptr_t) &neon_ff_b;
+        case ARM64_RELOC_DITHER_RB:
+            return (uintptr_t) dither_rb;
+        case ARM64_RELOC_DITHER_RB2X2:
+            return (uintptr_t) dither_rb2x2;
+        default:
+            return 0;
+    }
+}
+
+/* FNV-1a over the build-specific values baked into generated code that the
+ * relocations don't cover, plus the code generator options. */
+static inline uint64_t
+arm64_codegen_cache_fingerprint(voodoo_t *voodoo)
+{
+    const uint64_t v[] = {
+        BLOCK_SIZE,
+        voodoo->jit_span4_enabled,
+        ARM64_RELOC_MAX,
+        sizeof(voodoo_params_t),
+        sizeof(voodoo_state_t),
+        sizeof(voodoo_neon_reg_t),
+        (uint64_t) ((uintptr_t) dither_g - (uintptr_t) dither_rb),
+        (uint64_t) ((uintptr_t) dither_g2x2 - (uintptr_t) dither_rb2x2)
+    };
+    const uint8_t *p    = (const uint8_t *) v;
+    uint64_t       hash = 0xcbf29ce484222325ULL;
+
+    for (size_t c = 0; c < sizeof(v); c++) {
+        hash ^= p[c];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static inline void
+arm64_codegen_cache_key(voodoo_jit_cache_key_t *key, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state)
+{
+    memset(key, 0, sizeof(voodoo_jit_cache_key_t));
+    key->xdir           = state->xdir;
+    key->alphaMode      = params->alphaMode;
+    key->fbzMode        = params->fbzMode;
+    key->fogMode        = params->fogMode;
+    key->fbzColorPath   = params->fbzColorPath;
+    key->textureMode[0] = params->textureMode[0];
+    key->textureMode[1] = params->textureMode[1];
+    key->tLOD[0]        = params->tLOD[0] & LOD_MASK;
+    key->tLOD[1]        = params->tLOD[1] & LOD_MASK;
+    key->trexInit1      = voodoo->trexInit1[0] & (1 << 18);
+    key->is_tiled       = (params->col_tiled || params->aux_tiled) ? 1 : 0;
+    key->dual_tmus      = voodoo->dual_tmus;
+    key->tmuConfig      = voodoo->tmuConfig;
+}
+
+/*
+ * arm64_codegen_install_cached() -- copy a persisted block into code_block
+ * and re-target its pointer loads. The new load must fit in the
+ * instructions the original used (shorter ones are NOP-padded); if it
+ * doesn't, or the entry looks malformed, return 0 and let the caller
+ * compile from scratch.
+ */
+static inline int
+arm64_codegen_install_cached(uint8_t *code_block, const voodoo_jit_cache_entry_t *entry)
+{
+    memcpy(code_block, entry->code, entry->code_size);
+
+    for (uint32_t c = 0; c < entry->reloc_count; c++) {
+        const voodoo_jit_cache_reloc_t *reloc = &entry->relocs[c];
+        uint32_t                       *insn  = (uint32_t *) &code_block[reloc->pos];
+        uint64_t                        v;
+        uint16_t                        hw[4];
+        int                             d;
+        int                             n = 0;
+
+        if (reloc->sym >= ARM64_RELOC_MAX || !reloc->len || reloc->pos & 3
+            || (reloc->pos + reloc->len * 4) > entry->code_size)
+            return 0;
+        if ((insn[0] & 0xFF800000) != 0xD2800000) /* MOVZ Xd */
+            return 0;
+
+        d     = insn[0] & 0x1F;
+        v     = (uint64_t) arm64_codegen_reloc_target(reloc->sym);
+        hw[0] = v & 0xFFFF;
+        hw[1] = (v >> 16) & 0xFFFF;
+        hw[2] = (v >> 32) & 0xFFFF;
+        hw[3] = (v >> 48) & 0xFFFF;
+
+        for (int h = 0; h < 4; h++) {
+            if (!hw[h] && (n || h < 3))
+                continue;
+            if (n >= reloc->len)
+                return 0;
+            insn[n] = n ? ARM64_MOVK_X(d, hw[h], h) : ARM64_MOVZ_X_HW(d, hw[h], h);
+            n++;
+        }
+        while (n < reloc->len)
+            insn[n++] = ARM64_NOP;
+    }
+
+    return 1;
+}
+
 /*
  * voodoo_get_block() -- find or JIT-compile a pixel pipeline block.
  *
  * Algorithm:
- *   1. Probe starting at jit_last_block[odd_even] (MRU hint), scanning all
- *      32 slots for a cached block whose key matches the current state.
+ *   1. Hash the key once, then do a lock-free probe of the MRU hint and the
+ *      hash index (arm64_codegen_lookup).
  *   2. On hit: update LRU timestamp, update MRU hint, return code_block.
- *   3. On miss: scan all 32 slots for the one with the smallest last_used
- *      (LRU eviction), then JIT-compile into that slot:
+ *   3. On miss: take jit_mutex, probe again, then claim the LRU slot no
+ *      render thread has pinned, drop it from the index and JIT-compile
+ *      into it:
  *      a. Make code page writable (W^X toggle).
- *      b. Call voodoo_generate() to emit ARM64 into data->code_block.
+ *      b. Install the block from the persistent cache if it has one, else
+ *         call voodoo_generate() to emit ARM64 into data->code_block and
+ *         hand the result to the persistent cache.
  *      c. Check for emit overflow (block exceeded BLOCK_SIZE).
  *      d. Make code page executable and flush I-cache (narrow range).
  *   4. On reject (W^X fail or emit overflow): set last_used = 0 so the
  *      slot is evicted first on the next miss.
  *   5. Return the compiled code_block pointer, or NULL for interpreter fallback.
  *
- * odd_even selects the partition (0-3). Array layout is contiguous:
- * slot index = odd_even * BLOCK_NUM + probe.
+ * odd_even identifies the calling render thread (0-3); it selects the MRU
+ * hint and the hazard slot, not a cache partition.
  */
 static inline void *
 voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
 {
-    int                  b                 = voodoo->jit_last_block[odd_even];
-    int                  base              = odd_even * BLOCK_NUM;
     voodoo_arm64_data_t *voodoo_arm64_data = voodoo->codegen_data;
-    voodoo_arm64_data_t *data;
-
-    /* --- Cache lookup: linear scan from MRU hint --- */
-    for (uint8_t c = 0; c < BLOCK_NUM; c++) {
-        int probe = (b + c) & BLOCK_MASK;
-        data      = &voodoo_arm64_data[base + probe];
-
-        if ((data->valid || data->rejected)
-            && state->xdir == data->xdir
-            && params->alphaMode == data->alphaMode
-            && params->fbzMode == data->fbzMode
-            && params->fogMode == data->fogMode
-            && params->fbzColorPath == data->fbzColorPath
-            && (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1
-            && params->textureMode[0] == data->textureMode[0]
-            && params->textureMode[1] == data->textureMode[1]
-            && (params->tLOD[0] & LOD_MASK) == data->tLOD[0]
-            && (params->tLOD[1] & LOD_MASK) == data->tLOD[1]
-            && ((params->col_tiled || params->aux_tiled) ? 1 : 0) == data->is_tiled) {
-            if (data->rejected)
-                return NULL;
-
-            /* LRU: stamp this slot as most-recently-used */
-            data->last_used                  = ++voodoo->jit_generation[odd_even];
-            voodoo->jit_last_block[odd_even] = probe;
-            return data->code_block;
+    voodoo_arm64_data_t            *data;
+    int                             slot;
+    int                             code_size;
+    voodoo_jit_cache_key_t          key;
+    const voodoo_jit_cache_entry_t *entry = NULL;
+    uint32_t                        hash  = arm64_codegen_key_hash(voodoo, params, state);
+
+    /* --- Cache lookup: lock-free --- */
+    slot = arm64_codegen_lookup(voodoo, params, state, odd_even, hash);
+    if (slot < 0) {
+        thread_wait_mutex(voodoo->jit_mutex);
+
+        /* Another thread may have compiled this key while we waited */
+        slot = arm64_codegen_lookup(voodoo, params, state, odd_even, hash);
+        if (slot >= 0) {
+            thread_release_mutex(voodoo->jit_mutex);
         }
     }
+    if (slot >= 0) {
+        data = &voodoo_arm64_data[slot];
+        if (data->rejected)
+            return NULL;
+
+        /* LRU: stamp this slot as most-recently-used (racy but monotonic enough) */
+        data->last_used                  = ++voodoo->jit_generation;
+        voodoo->jit_last_block[odd_even] = slot;
+        voodoo->jit_hits[odd_even]++;
+        return data->code_block;
+    }
 
-    /* --- Cache miss: find LRU victim --- */
-    {
-        int      lru_slot = 0;
-        uint64_t lru_min  = voodoo_arm64_data[base].last_used;
-        for (int s = 1; s < BLOCK_NUM; s++) {
-            if (voodoo_arm64_data[base + s].last_used < lru_min) {
-                lru_min  = voodoo_arm64_data[base + s].last_used;
-                lru_slot = s;
-            }
-        }
-        data = &voodoo_arm64_data[base + lru_slot];
+    /* --- Cache miss, jit_mutex held: claim the LRU victim --- */
+    voodoo->jit_misses++;
+    slot = arm64_codegen_claim_victim(voodoo);
+    if (slot < 0) {
+        thread_release_mutex(voodoo->jit_mutex);
+        return NULL;
     }
+    data = &voodoo_arm64_data[slot];
+    arm64_codegen_index_remove(voodoo, slot);
+    data->hash = hash;
 
     /* W^X: make code page writable before JIT emission. */
     if (!arm64_codegen_set_writable(data->code_block)) {
         arm64_codegen_store_cache_key(data, voodoo, params, state, 0, 1);
         data->last_used = 0;
-        return NULL;
+        goto publish_rejected;
     }
 
-    int code_size = voodoo_generate(data->code_block, voodoo, params, state, depth_op);
-
-    if (arm64_codegen_emit_overflowed()) {
-        arm64_codegen_store_cache_key(data, voodoo, params, state, 0, 1);
-        data->last_used = 0;
-        arm64_codegen_set_executable(data->code_block);
-        return NULL;
+    /* Persistent cache: install a block compiled by an earlier run */
+    if (voodoo->jit_cache) {
+        arm64_codegen_cache_key(&key, voodoo, params, state);
+        entry = voodoo_jit_cache_find(voodoo->jit_cache, &key);
+        if (entry && !arm64_codegen_install_cached(data->code_block, entry)) {
+            voodoo->jit_cache->rejects++;
+            entry = NULL;
+        }
     }
 
-    arm64_codegen_store_cache_key(data, voodoo, params, state, 1, 0);
-    data->last_used                  = ++voodoo->jit_generation[odd_even];
-    voodoo->jit_last_block[odd_even] = (int) (data - &voodoo_arm64_data[base]);
+    if (entry) {
+        voodoo->jit_cache->hits++;
+        code_size = entry->code_size;
+    } else {
+        uint64_t compile_start = plat_timer_read();
+
+        code_size = voodoo_generate(data->code_block, voodoo, params, state, depth_op);
+        voodoo->jit_compiles++;
+        voodoo->jit_compile_ticks += plat_timer_read() - compile_start;
+
+        if (arm64_codegen_emit_overflowed()) {
+            arm64_codegen_store_cache_key(data, voodoo, params, state, 0, 1);
+            data->last_used = 0;
+            arm64_codegen_set_executable(data->code_block);
+            goto publish_rejected;
+        }
+
+        if (voodoo->jit_cache && arm64_codegen_reloc_count <= VOODOO_JIT_CACHE_MAX_RELOCS)
+            voodoo_jit_cache_store(voodoo->jit_cache, &key, data->code_block, code_size,
+                                   arm64_codegen_relocs, arm64_codegen_reloc_count);
+    }
 
     /* W^X: make executable, flush I-cache (narrow range = actual code size) */
     if (!arm64_codegen_set_executable(data->code_block)) {
         arm64_codegen_store_cache_key(data, voodoo, params, state, 0, 1);
         data->last_used = 0;
-        return NULL;
+        goto publish_rejected;
     }
 #if defined(__aarch64__) || defined(_M_ARM64)
 #    ifdef _WIN32
@@ -4601,7 +5577,25 @@ voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *stat
 #    endif
 #endif
 
+    arm64_codegen_store_cache_key(data, voodoo, params, state, 1, 0);
+    data->last_used                  = ++voodoo->jit_generation;
+    voodoo->jit_last_block[odd_even] = slot;
+
+    /* Pin before publishing so nobody can recycle it under the caller */
+    arm64_codegen_index_insert(voodoo, slot);
+    ATOMIC_STORE(voodoo->jit_hazard[odd_even], slot);
+    ATOMIC_INC(data->seq);
+    thread_release_mutex(voodoo->jit_mutex);
+
     return data->code_block;
+
+publish_rejected:
+    arm64_codegen_index_insert(voodoo, slot);
+    ATOMIC_STORE(voodoo->jit_hazard[odd_even], slot);
+    ATOMIC_INC(data->seq);
+    thread_release_mutex(voodoo->jit_mutex);
+
+    return NULL;
 }
 
 /*
@@ -4611,8 +5605,8 @@ voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *stat
  * One-time setup when the emulated Voodoo card is initialized:
  *
  * 1. Allocate executable memory (MAP_JIT on macOS) for compiled blocks.
- *    Each block gets BLOCK_SIZE bytes. Total allocation covers all cache
- *    slots across both render targets (odd/even double-buffering).
+ *    Each block gets BLOCK_SIZE bytes. Total allocation covers the
+ *    BLOCK_NUM slots of the cache shared by all render threads.
  *
  * 2. Build lookup tables used by the compiled code at runtime:
  *    - alookup[256]: alpha multiply factors {a, a, a, a} as NEON halfwords
@@ -4634,14 +5628,14 @@ voodoo_codegen_init(voodoo_t *voodoo)
     voodoo_arm64_data_t *voodoo_arm64_data;
     uint32_t             slot;
 
-    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4, 0);
+    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM, 0);
     if (!voodoo->codegen_data) {
         fatal("ARM64 JIT: failed to allocate codegen metadata buffer\n");
     }
     voodoo_arm64_data = voodoo->codegen_data;
-    memset(voodoo_arm64_data, 0, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+    memset(voodoo_arm64_data, 0, sizeof(voodoo_arm64_data_t) * BLOCK_NUM);
 
-    for (slot = 0; slot < (uint32_t) (BLOCK_NUM * 4); slot++) {
+    for (slot = 0; slot < (uint32_t) BLOCK_NUM; slot++) {
         voodoo_arm64_data[slot].code_block = plat_mmap(BLOCK_SIZE, 1);
         if (!voodoo_arm64_data[slot].code_block) {
             while (slot > 0) {
@@ -4651,7 +5645,7 @@ voodoo_codegen_init(voodoo_t *voodoo)
                     voodoo_arm64_data[slot].code_block = NULL;
                 }
             }
-            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM);
             voodoo->codegen_data = NULL;
             fatal("ARM64 JIT: failed to allocate executable code block\n");
         }
@@ -4666,7 +5660,7 @@ voodoo_codegen_init(voodoo_t *voodoo)
                     voodoo_arm64_data[slot].code_block = NULL;
                 }
             }
-            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+            plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM);
             voodoo->codegen_data = NULL;
             fatal("ARM64 JIT: failed to set code block executable\n");
         }
@@ -4675,7 +5669,19 @@ voodoo_codegen_init(voodoo_t *voodoo)
 
     /* Initialize per-instance JIT cache state */
     memset(voodoo->jit_last_block, 0, sizeof(voodoo->jit_last_block));
-    memset(voodoo->jit_generation, 0, sizeof(voodoo->jit_generation));
+    for (int t = 0; t < 4; t++)
+        ATOMIC_STORE(voodoo->jit_hazard[t], -1);
+    voodoo->jit_generation = 0;
+    voodoo->jit_mutex      = thread_create_mutex();
+
+    voodoo->jit_index = malloc(sizeof(ATOMIC_INT) * INDEX_NUM);
+    for (int c = 0; c < INDEX_NUM; c++)
+        ATOMIC_STORE(voodoo->jit_index[c], INDEX_EMPTY);
+    voodoo->jit_index_tombstones = 0;
+
+    if (voodoo->jit_cache_enabled)
+        voodoo->jit_cache = voodoo_jit_cache_open("voodoo_jit_arm64", voodoo->type, VOODOO_JIT_CACHE_ARCH_ARM64, VOODOO_JIT_CACHE_REVISION,
+                                                  BLOCK_SIZE, arm64_codegen_cache_fingerprint(voodoo));
 
     for (uint16_t c = 0; c < 256; c++) {
         int d[4];
@@ -4775,15 +5781,32 @@ voodoo_codegen_close(voodoo_t *voodoo)
         return;
     }
 
-    for (slot = 0; slot < (uint32_t) (BLOCK_NUM * 4); slot++) {
+    for (slot = 0; slot < (uint32_t) BLOCK_NUM; slot++) {
         if (voodoo_arm64_data[slot].code_block) {
             plat_munmap(voodoo_arm64_data[slot].code_block, BLOCK_SIZE);
             voodoo_arm64_data[slot].code_block = NULL;
         }
     }
 
-    plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * 4);
+    plat_munmap(voodoo_arm64_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM);
     voodoo->codegen_data = NULL;
+
+    thread_close_mutex(voodoo->jit_mutex);
+    voodoo->jit_mutex = NULL;
+
+    free((void *) voodoo->jit_index);
+    voodoo->jit_index = NULL;
+
+    if (voodoo->jit_cache) {
+        if (voodoo->wait_stats_enabled && voodoo->wait_stats_explicit) {
+            pclog("Voodoo JIT cache: %" PRIu64 "/%" PRIu64 " hits, %" PRIu64 " rejected, %" PRIu64 " stored, %i loaded, load ticks=%" PRIu64 "\n",
+                  voodoo->jit_cache->hits, voodoo->jit_cache->lookups, voodoo->jit_cache->rejects,
+                  voodoo->jit_cache->stores, voodoo->jit_cache->loaded_entries,
+                  voodoo->jit_cache->load_ticks);
+        }
+        voodoo_jit_cache_close(voodoo->jit_cache);
+        voodoo->jit_cache = NULL;
+    }
 }
 
 #endif /* VIDEO_VOODOO_CODEGEN_ARM64_H */
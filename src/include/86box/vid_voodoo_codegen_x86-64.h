@@ -9,11 +9,18 @@
 #define VIDEO_VOODOO_CODEGEN_X86_64_H
 
 #include <xmmintrin.h>
+#include <emmintrin.h>
 
-#define BLOCK_NUM  8
+#define BLOCK_NUM  128
 #define BLOCK_MASK (BLOCK_NUM - 1)
 #define BLOCK_SIZE 8192
 
+/*Open-addressed hash index over the blocks, kept at <= 25% load*/
+#define INDEX_NUM       (BLOCK_NUM * 4)
+#define INDEX_MASK      (INDEX_NUM - 1)
+#define INDEX_EMPTY     -1
+#define INDEX_TOMBSTONE -2
+
 #define LOD_MASK   (LOD_TMIRROR_S | LOD_TMIRROR_T)
 
 /* Suppress a false positive warning on gcc that causes excessive build log spam */
@@ -21,26 +28,26 @@
 #    pragma GCC diagnostic ignored "-Wstringop-overflow"
 #endif
 
+/*One cache of BLOCK_NUM blocks is shared by all render threads. seq is a
+  seqlock counter, odd while the slot is being recompiled. hash is the key
+  hash, which places the block in voodoo->jit_index.*/
 typedef struct voodoo_x86_data_t {
-    uint8_t  code_block[BLOCK_SIZE];
-    int      xdir;
-    uint32_t alphaMode;
-    uint32_t fbzMode;
-    uint32_t fogMode;
-    uint32_t fbzColorPath;
-    uint32_t textureMode[2];
-    uint32_t tLOD[2];
-    uint32_t trexInit1;
-    int      is_tiled;
+    uint8_t    code_block[BLOCK_SIZE];
+    uint64_t   last_used;
+    ATOMIC_INT seq;
+    uint32_t   hash;
+    int        valid;
+    int        xdir;
+    uint32_t   alphaMode;
+    uint32_t   fbzMode;
+    uint32_t   fogMode;
+    uint32_t   fbzColorPath;
+    uint32_t   textureMode[2];
+    uint32_t   tLOD[2];
+    uint32_t   trexInit1;
+    int        is_tiled;
 } voodoo_x86_data_t;
 
-#if 0
-static voodoo_x86_data_t voodoo_x86_data[2][BLOCK_NUM];
-#endif
-
-static int last_block[4]          = { 0, 0 };
-static int next_block_to_write[4] = { 0, 0 };
-
 #define addbyte(val)                   \
     do {                               \
         code_block[block_pos++] = val; \
@@ -3484,31 +3491,236 @@ voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo_params_t *params,
     addbyte(0xC3); /*RET*/
 }
 int voodoo_recomp = 0;
-static inline void *
-voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
+
+static inline int
+voodoo_x86_key_matches(const voodoo_x86_data_t *data, voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state)
+{
+    return state->xdir == data->xdir && params->alphaMode == data->alphaMode && params->fbzMode == data->fbzMode && params->fogMode == data->fogMode && params->fbzColorPath == data->fbzColorPath && (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1 && params->textureMode[0] == data->textureMode[0] && params->textureMode[1] == data->textureMode[1] && (params->tLOD[0] & LOD_MASK) == data->tLOD[0] && (params->tLOD[1] & LOD_MASK) == data->tLOD[1] && ((params->col_tiled || params->aux_tiled) ? 1 : 0) == data->is_tiled;
+}
+
+/*Hash of the render-state key, computed once per voodoo_get_block() call*/
+static inline uint32_t
+voodoo_x86_key_hash(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    hash = (hash ^ (uint32_t) state->xdir) * 0x01000193;
+    hash = (hash ^ params->alphaMode) * 0x01000193;
+    hash = (hash ^ params->fbzMode) * 0x01000193;
+    hash = (hash ^ params->fogMode) * 0x01000193;
+    hash = (hash ^ params->fbzColorPath) * 0x01000193;
+    hash = (hash ^ (voodoo->trexInit1[0] & (1 << 18))) * 0x01000193;
+    hash = (hash ^ params->textureMode[0]) * 0x01000193;
+    hash = (hash ^ params->textureMode[1]) * 0x01000193;
+    hash = (hash ^ (params->tLOD[0] & LOD_MASK)) * 0x01000193;
+    hash = (hash ^ (params->tLOD[1] & LOD_MASK)) * 0x01000193;
+    hash = (hash ^ ((params->col_tiled || params->aux_tiled) ? 1 : 0)) * 0x01000193;
+
+    /*Mix the high bits down, the index only uses the low ones*/
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+
+    return hash;
+}
+
+/*Compare one block against the key and pin it in jit_hazard[odd_even] so
+  that no other thread recycles it while this thread may be running it, then
+  re-check seq in case it was recycled between the compare and the pin.
+  Returns 1 on a hit, 0 on mismatch, -1 if the probe must restart. ATOMIC_*
+  are plain volatile accesses on x86, so the store->load ordering needs an
+  explicit fence.*/
+static inline int
+voodoo_x86_probe_slot(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even, int slot, uint32_t hash)
+{
+    voodoo_x86_data_t *data = &((voodoo_x86_data_t *) voodoo->codegen_data)[slot];
+    int                seq  = data->seq;
+
+    if ((seq & 1) || !data->valid || data->hash != hash || !voodoo_x86_key_matches(data, voodoo, params, state))
+        return 0;
+
+    voodoo->jit_hazard[odd_even] = slot;
+    _mm_mfence();
+    if (data->seq != seq)
+        return -1;
+
+    return 1;
+}
+
+/*Lock-free probe: MRU hint first, then the key's chain in jit_index. The
+  index is only a hint here - candidates are validated against the block
+  itself - so racing with an index update can at worst produce a false miss,
+  which the locked re-probe in voodoo_get_block() resolves.*/
+static inline int
+voodoo_x86_lookup(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even, uint32_t hash)
+{
+    int slot;
+    int ret;
+
+retry:
+    slot = voodoo->jit_last_block[odd_even];
+    ret  = voodoo_x86_probe_slot(voodoo, params, state, odd_even, slot, hash);
+    if (ret > 0)
+        return slot;
+    if (ret < 0)
+        goto retry;
+
+    for (int c = 0; c < INDEX_NUM; c++) {
+        slot = voodoo->jit_index[(hash + c) & INDEX_MASK];
+        if (slot == INDEX_EMPTY)
+            break;
+        if (slot == INDEX_TOMBSTONE)
+            continue;
+
+        ret = voodoo_x86_probe_slot(voodoo, params, state, odd_even, slot, hash);
+        if (ret > 0)
+            return slot;
+        if (ret < 0)
+            goto retry;
+    }
+
+    return -1;
+}
+
+/*Index maintenance, called with jit_mutex held*/
+static inline void
+voodoo_x86_index_place(voodoo_t *voodoo, int slot)
+{
+    voodoo_x86_data_t *data = &((voodoo_x86_data_t *) voodoo->codegen_data)[slot];
+
+    for (int c = 0; c < INDEX_NUM; c++) {
+        int pos  = (data->hash + c) & INDEX_MASK;
+        int prev = voodoo->jit_index[pos];
+
+        if (prev == INDEX_EMPTY || prev == INDEX_TOMBSTONE) {
+            if (prev == INDEX_TOMBSTONE)
+                voodoo->jit_index_tombstones--;
+            voodoo->jit_index[pos] = slot;
+            return;
+        }
+    }
+}
+
+static inline void
+voodoo_x86_index_remove(voodoo_t *voodoo, int slot)
+{
+    voodoo_x86_data_t *data = &((voodoo_x86_data_t *) voodoo->codegen_data)[slot];
+
+    for (int c = 0; c < INDEX_NUM; c++) {
+        int pos  = (data->hash + c) & INDEX_MASK;
+        int prev = voodoo->jit_index[pos];
+
+        if (prev == INDEX_EMPTY)
+            return;
+        if (prev == slot) {
+            voodoo->jit_index[pos] = INDEX_TOMBSTONE;
+            voodoo->jit_index_tombstones++;
+            return;
+        }
+    }
+}
+
+/*Rebuild the index once tombstones start lengthening the probe chains*/
+static inline void
+voodoo_x86_index_insert(voodoo_t *voodoo, int slot)
 {
-    int                b               = last_block[odd_even];
     voodoo_x86_data_t *voodoo_x86_data = voodoo->codegen_data;
-    voodoo_x86_data_t *data;
 
-    for (uint8_t c = 0; c < 8; c++) {
-        data = &voodoo_x86_data[odd_even + c * 4]; //&voodoo_x86_data[odd_even][b];
+    if (voodoo->jit_index_tombstones > (INDEX_NUM / 4)) {
+        for (int c = 0; c < INDEX_NUM; c++)
+            voodoo->jit_index[c] = INDEX_EMPTY;
+        voodoo->jit_index_tombstones = 0;
 
-        if (state->xdir == data->xdir && params->alphaMode == data->alphaMode && params->fbzMode == data->fbzMode && params->fogMode == data->fogMode && params->fbzColorPath == data->fbzColorPath && (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1 && params->textureMode[0] == data->textureMode[0] && params->textureMode[1] == data->textureMode[1] && (params->tLOD[0] & LOD_MASK) == data->tLOD[0] && (params->tLOD[1] & LOD_MASK) == data->tLOD[1] && ((params->col_tiled || params->aux_tiled) ? 1 : 0) == data->is_tiled) {
-            last_block[odd_even] = b;
-            return data->code_block;
+        for (int s = 0; s < BLOCK_NUM; s++) {
+            if (s != slot && voodoo_x86_data[s].valid && !(voodoo_x86_data[s].seq & 1))
+                voodoo_x86_index_place(voodoo, s);
         }
+    }
 
-        b = (b + 1) & 7;
+    voodoo_x86_index_place(voodoo, slot);
+}
+
+/*Claim the least recently used slot that no render thread has pinned.
+  Called with jit_mutex held; returns with the slot's seq odd.*/
+static inline int
+voodoo_x86_claim_victim(voodoo_t *voodoo)
+{
+    voodoo_x86_data_t *voodoo_x86_data = voodoo->codegen_data;
+    uint8_t            skip[BLOCK_NUM] = { 0 };
+
+    for (int attempt = 0; attempt < BLOCK_NUM; attempt++) {
+        int      lru_slot = -1;
+        uint64_t lru_min  = UINT64_MAX;
+        int      pinned   = 0;
+
+        for (int s = 0; s < BLOCK_NUM; s++) {
+            if (!skip[s] && voodoo_x86_data[s].last_used <= lru_min) {
+                lru_min  = voodoo_x86_data[s].last_used;
+                lru_slot = s;
+            }
+        }
+        if (lru_slot < 0)
+            break;
+
+        voodoo_x86_data[lru_slot].seq++;
+        _mm_mfence();
+        for (int t = 0; t < 4; t++) {
+            if (voodoo->jit_hazard[t] == lru_slot)
+                pinned = 1;
+        }
+        if (!pinned)
+            return lru_slot;
+
+        voodoo_x86_data[lru_slot].seq++;
+        skip[lru_slot] = 1;
     }
-    voodoo_recomp++;
-    data = &voodoo_x86_data[odd_even + next_block_to_write[odd_even] * 4];
-#if 0
-    code_block = data->code_block;
-#endif
 
+    return -1;
+}
+
+static inline void *
+voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
+{
+    voodoo_x86_data_t *voodoo_x86_data = voodoo->codegen_data;
+    voodoo_x86_data_t *data;
+    int                slot;
+    uint32_t           hash = voodoo_x86_key_hash(voodoo, params, state);
+    uint64_t           compile_start;
+
+    slot = voodoo_x86_lookup(voodoo, params, state, odd_even, hash);
+    if (slot < 0) {
+        /*Miss - serialise so each render state is compiled only once, and
+          check again in case another render thread just compiled it*/
+        thread_wait_mutex(voodoo->jit_mutex);
+        slot = voodoo_x86_lookup(voodoo, params, state, odd_even, hash);
+        if (slot >= 0)
+            thread_release_mutex(voodoo->jit_mutex);
+    }
+    if (slot >= 0) {
+        data                             = &voodoo_x86_data[slot];
+        data->last_used                  = ++voodoo->jit_generation;
+        voodoo->jit_last_block[odd_even] = slot;
+        voodoo->jit_hits[odd_even]++;
+        return data->code_block;
+    }
+
+    voodoo->jit_misses++;
+    slot = voodoo_x86_claim_victim(voodoo);
+    if (slot < 0) {
+        thread_release_mutex(voodoo->jit_mutex);
+        return NULL;
+    }
+    data = &voodoo_x86_data[slot];
+    voodoo_x86_index_remove(voodoo, slot);
+
+    voodoo_recomp++;
+    compile_start = plat_timer_read();
     voodoo_generate(data->code_block, voodoo, params, state, depth_op);
+    voodoo->jit_compiles++;
+    voodoo->jit_compile_ticks += plat_timer_read() - compile_start;
 
+    data->valid          = 1;
+    data->hash           = hash;
     data->xdir           = state->xdir;
     data->alphaMode      = params->alphaMode;
     data->fbzMode        = params->fbzMode;
@@ -3520,8 +3732,14 @@ voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *stat
     data->tLOD[0]        = params->tLOD[0] & LOD_MASK;
     data->tLOD[1]        = params->tLOD[1] & LOD_MASK;
     data->is_tiled       = (params->col_tiled || params->aux_tiled) ? 1 : 0;
+    data->last_used      = ++voodoo->jit_generation;
 
-    next_block_to_write[odd_even] = (next_block_to_write[odd_even] + 1) & 7;
+    voodoo->jit_last_block[odd_even] = slot;
+    voodoo_x86_index_insert(voodoo, slot);
+    voodoo->jit_hazard[odd_even] = slot;
+    _mm_mfence();
+    data->seq++;
+    thread_release_mutex(voodoo->jit_mutex);
 
     return data->code_block;
 }
@@ -3529,7 +3747,19 @@ voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *stat
 void
 voodoo_codegen_init(voodoo_t *voodoo)
 {
-    voodoo->codegen_data = plat_mmap(sizeof(voodoo_x86_data_t) * BLOCK_NUM * 4, 1);
+    voodoo->codegen_data = plat_mmap(sizeof(voodoo_x86_data_t) * BLOCK_NUM, 1);
+    memset(voodoo->codegen_data, 0, sizeof(voodoo_x86_data_t) * BLOCK_NUM);
+
+    memset(voodoo->jit_last_block, 0, sizeof(voodoo->jit_last_block));
+    for (int t = 0; t < 4; t++)
+        voodoo->jit_hazard[t] = -1;
+    voodoo->jit_generation = 0;
+    voodoo->jit_mutex      = thread_create_mutex();
+
+    voodoo->jit_index = malloc(sizeof(ATOMIC_INT) * INDEX_NUM);
+    for (int c = 0; c < INDEX_NUM; c++)
+        voodoo->jit_index[c] = INDEX_EMPTY;
+    voodoo->jit_index_tombstones = 0;
 
     for (uint16_t c = 0; c < 256; c++) {
         int d[4];
@@ -3555,7 +3785,11 @@ voodoo_codegen_init(voodoo_t *voodoo)
 void
 voodoo_codegen_close(voodoo_t *voodoo)
 {
-    plat_munmap(voodoo->codegen_data, sizeof(voodoo_x86_data_t) * BLOCK_NUM * 4);
+    plat_munmap(voodoo->codegen_data, sizeof(voodoo_x86_data_t) * BLOCK_NUM);
+    thread_close_mutex(voodoo->jit_mutex);
+    voodoo->jit_mutex = NULL;
+    free((void *) voodoo->jit_index);
+    voodoo->jit_index = NULL;
 }
 
 #endif /*VIDEO_VOODOO_CODEGEN_X86_64_H*/
@@ -26,8 +26,10 @@
 #define LOD_MAX         8
 
 #define TEX_DIRTY_SHIFT 10
+#define TEX_PAGES       16384 /*1KB pages of the largest texture memory*/
 
-#define TEX_CACHE_MAX   64
+#define TEX_CACHE_MAX   64   /*Default entries per TMU*/
+#define TEX_CACHE_LIMIT 1024 /*Largest VOODOO_TEX_CACHE accepted*/
 
 enum {
     VOODOO_1 = 0,
@@ -97,6 +99,14 @@ enum {
 #define PARAM_MASK       (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
 
+/*Render threads split the screen into bands of 1 << VOODOO_BAND_SHIFT rows*/
+#define VOODOO_BAND_SHIFT 3
+#define VOODOO_BANDS      (2048 >> VOODOO_BAND_SHIFT)
+#define VOODOO_BAND_MASK  (VOODOO_BANDS - 1)
+
+/*Framebuffer surfaces (colour buffers, aux buffer) tracked for LFB hazards*/
+#define VOODOO_LFB_HAZARD_SURFACES 4
+
 /* On ARM64, params/busy fields are cache-line padded to prevent false sharing
    between render threads. These accessors hide the .value indirection. */
 #if (defined __aarch64__ || defined _M_ARM64)
@@ -113,6 +123,17 @@ enum {
 #define PARAM_FULL(x)    ((PARAMS_WRITE_IDX(voodoo) - PARAMS_READ_IDX(voodoo, x)) >= PARAM_SIZE)
 #define PARAM_EMPTY(x)   (PARAMS_READ_IDX(voodoo, x) == PARAMS_WRITE_IDX(voodoo))
 
+/*One scanline for the scan-out worker*/
+#define VOODOO_SCANOUT_JOBS 2048
+#define VOODOO_SCANOUT_MASK (VOODOO_SCANOUT_JOBS - 1)
+
+typedef struct voodoo_scanout_job_t {
+    struct voodoo_t *draw_voodoo;
+    uint32_t        *dst;
+    const uint16_t  *src;
+    int              line;
+} voodoo_scanout_job_t;
+
 typedef struct
 {
     uint32_t addr_type;
@@ -239,6 +260,10 @@ typedef struct voodoo_params_t {
     int aux_tiled;
     int row_width;
     int aux_row_width;
+
+    int y_origin; /*Latched at queue time, so a later origin change can't
+                    move rows between render threads mid-triangle*/
+    int fastfill; /*Queued fastfillCMD rather than a triangle*/
 } voodoo_params_t;
 
 typedef struct texture_t {
@@ -251,6 +276,9 @@ typedef struct texture_t {
     uint32_t   addr_start[4];
     uint32_t   addr_end[4];
     uint32_t  *data;
+    int        hash_next;  /*Next entry in the same texture_hash chain, or -1*/
+    int        referenced; /*Hit since the eviction clock last passed*/
+    uint32_t   decoded;    /*LODs whose data[] is current*/
 } texture_t;
 
 typedef struct vert_t {
@@ -379,6 +407,10 @@ typedef struct voodoo_t {
     event_t  *fifo_not_full_event;
     event_t  *fifo_empty_event;
     ATOMIC_INT fifo_empty_signaled;
+    /* Set while the FIFO thread is blocked on wake_fifo_thread. With FIFO
+       batching (VOODOO_FIFO_BATCH) writers only signal a parked thread. */
+    atomic_int fifo_thread_parked;
+    int        fifo_batch_enabled;
     event_t  *render_not_full_event[4];
     event_t  *wake_render_thread[4];
 
@@ -395,12 +427,36 @@ typedef struct voodoo_t {
 #endif
 
     int render_threads;
-    int odd_even_mask;
+
+    /*Band ownership: row r is drawn by render_band_owner[r >> VOODOO_BAND_SHIFT].
+      Each thread accumulates the pixels it drew per band in its own row of
+      render_band_work, which voodoo_render_rebalance() uses to move bands
+      from busy threads to idle ones.*/
+    uint8_t  render_band_owner[VOODOO_BANDS];
+    uint32_t render_band_work[4][VOODOO_BANDS];
+    int      render_band_tris;
+    uint64_t render_band_moves;
+
+    /*LFB write hazards, maintained by the FIFO thread. For each surface the
+      queued triangles draw to, keyed by its base offset, lfb_hazard_idx
+      holds the ring index of the last triangle whose rows fall in each band
+      (lfb_hazard_live marks bands that have one). An LFB write waits only
+      for the band's owner to get past that triangle. The table is dropped
+      whenever the ring is fully retired; if more surfaces are in flight than
+      it holds, LFB writes fall back to draining every render thread.*/
+    uint32_t lfb_hazard_offset[VOODOO_LFB_HAZARD_SURFACES];
+    int      lfb_hazard_surfaces;
+    int      lfb_hazard_overflow;
+    int      lfb_hazard_idx[VOODOO_LFB_HAZARD_SURFACES][VOODOO_BANDS];
+    uint8_t  lfb_hazard_live[VOODOO_LFB_HAZARD_SURFACES][VOODOO_BANDS];
+    uint64_t lfb_hazard_waits;
+    uint64_t lfb_hazard_drains;
 
     int pixel_count[4];
     int texel_count[4];
     int tri_count;
     int frame_count;
+    int swapbuffer_count; /*swapbufferCMDs executed, vsynced or not*/
     int pixel_count_old[4];
     int texel_count_old[4];
     int wr_count;
@@ -450,6 +506,15 @@ typedef struct voodoo_t {
     ATOMIC_INT      params_read_idx[4];
     ATOMIC_INT      params_write_idx;
 #endif
+    /*All render threads walk the one ring. params_mask holds the threads that
+      own a band the triangle touches, params_refs how many of those are still
+      to draw it; a slot is reused once its count drops to zero. params_seq is
+      the ring index the slot was written for, or -1 while it is rewritten.*/
+    uint8_t    params_mask[PARAM_SIZE];
+    atomic_int params_refs[PARAM_SIZE];
+    atomic_int params_seq[PARAM_SIZE];
+    int        params_free_idx;
+    event_t   *render_slot_free_event;
 
     uint32_t   cmdfifo_base;
     uint32_t   cmdfifo_end;
@@ -479,6 +544,9 @@ typedef struct voodoo_t {
     uint32_t   cmdfifo_amax_2;
     int        cmdfifo_holecount_2;
 
+    uint64_t cmdfifo_block_reads;     /* packet runs copied out in one go */
+    uint64_t cmdfifo_block_fallbacks; /* packet runs read a word at a time */
+
     ATOMIC_UINT cmd_status, cmd_status_2;
 
     uint32_t     sSetupMode;
@@ -666,6 +734,11 @@ typedef struct voodoo_t {
     int         clutData_dirty;
     rgbvoodoo_t clutData256[256];
     uint32_t    video_16to32[0x10000];
+    /*Per-component view of video_16to32: the 8-bit output for each 5-bit
+      blue, 6-bit green and 5-bit red field*/
+    uint8_t     video_565_b[32];
+    uint8_t     video_565_g[64];
+    uint8_t     video_565_r[32];
 
     uint8_t dirty_line[2048];
     int     dirty_line_low;
@@ -700,10 +773,29 @@ typedef struct voodoo_t {
     uint8_t  thefilterg[256][256];
     uint8_t  thefilterb[256][256];
     uint16_t purpleline[256][3];
-
-    texture_t texture_cache[2][TEX_CACHE_MAX];
-    uint8_t   texture_present[2][16384];
-    int       texture_last_removed;
+    /*Thresholds (red, green, blue) and generator (1 or 2) the tables above
+      were last built with; the vector scan-out filters compute the same
+      function directly from these*/
+    int      filter_caps[3];
+    int      filter_type;
+
+    /*texture_cache_size entries per TMU. Valid entries are chained off
+      texture_hash[] by (base, tLOD, palette checksum); texture_last_removed
+      is the eviction clock hand.*/
+    texture_t *texture_cache[2];
+    int       *texture_hash[2];
+    int        texture_cache_size;
+    /*texture_page_map holds a bitmap of the entries with decoded LODs backed
+      by each 1KB page of texture memory (texture_cache_size / 32 words per
+      page), and texture_present the number of bits set in it*/
+    uint32_t  *texture_page_map[2];
+    uint16_t   texture_present[2][TEX_PAGES];
+    int        texture_last_removed;
+    uint64_t   texture_cache_hits;
+    uint64_t   texture_cache_misses;
+    uint64_t   texture_cache_stalls;
+    uint64_t   texture_lod_redecodes;
+    uint64_t   texture_cache_evictions;
 
     uint32_t palette_checksum[2];
     int      palette_dirty[2];
@@ -716,6 +808,9 @@ typedef struct voodoo_t {
     uint64_t fifo_empty_waits;
     uint64_t fifo_empty_wait_ticks;
     uint64_t fifo_empty_spin_checks;
+    uint64_t fifo_wake_signals;   /* wake timer arms and direct wakes from writers */
+    uint64_t fifo_wakeups;        /* FIFO thread returns from wake_fifo_thread */
+    uint64_t fifo_spin_hits;      /* work found while spinning, no park needed */
     uint64_t render_waits;
     uint64_t render_wait_ticks;
     uint64_t render_wait_spin_checks;
@@ -744,9 +839,58 @@ typedef struct voodoo_t {
     int   use_recompiler;
     void *codegen_data;
 
-    /* JIT cache state -- per-instance to avoid races between render threads */
-    int jit_last_block[4];
-    uint64_t jit_generation[4];
+    int      simd_span_enabled;    /* vector interpreter spans (VOODOO_SIMD_SPAN) */
+    uint64_t simd_span_pixels[4];  /* per render thread */
+    int      jit_span4_enabled;    /* four-pixel JIT spans (VOODOO_JIT_SPAN4) */
+    int      jit_span4_blocks;     /* blocks compiled with the four-pixel loop */
+    int      lfb_hazard_enabled;   /* band-tracked LFB writes (VOODOO_LFB_HAZARDS) */
+    int      banshee_blt_fast_enabled; /* 2D row kernels (VOODOO_BLT_FAST) */
+    int      fastfill_bands_enabled;   /* fastfill on the render threads (VOODOO_FASTFILL_BANDS) */
+    uint64_t fastfill_queued;
+    uint64_t banshee_blt_fast_rows;
+
+    /*Scan-out worker (VOODOO_SCANOUT_THREAD). voodoo_callback() queues the
+      dirty lines of a frame here instead of converting them itself; the
+      queue is drained before the frame is blitted.*/
+    int                   scanout_thread_enabled;
+    int                   scanout_thread_run;
+    thread_t             *scanout_thread;
+    event_t              *scanout_wake_event;
+    event_t              *scanout_idle_event;
+    ATOMIC_INT            scanout_read_idx;
+    ATOMIC_INT            scanout_write_idx;
+    voodoo_scanout_job_t  scanout_jobs[VOODOO_SCANOUT_JOBS];
+    uint64_t              scanout_lines;
+    uint64_t              scanout_waits;
+
+    /* JIT cache state -- one cache per instance, shared by the render threads */
+    int        jit_last_block[4]; /* per-thread MRU hint */
+    ATOMIC_INT jit_hazard[4];     /* slot each render thread may be running, -1 = none */
+    ATOMIC_INT *jit_index;        /* open-addressed key hash -> slot index */
+    int        jit_index_tombstones;
+    uint64_t   jit_generation;    /* LRU clock */
+    mutex_t   *jit_mutex;         /* serialises misses (one compiler per key) */
+    int        jit_cache_enabled; /* persist compiled blocks (VOODOO_JIT_CACHE) */
+    struct voodoo_jit_cache_t *jit_cache;
+    uint64_t   jit_hits[4];       /* per render thread */
+    uint64_t   jit_misses;        /* counted under jit_mutex */
+    uint64_t   jit_compiles;
+    uint64_t   jit_compile_ticks;
+
+    /*Differential JIT verifier (VOODOO_JIT_VERIFY=n): every nth JIT span is
+      redrawn by the interpreter and compared. Per render thread.*/
+    int       jit_verify; /* n, 0 = off */
+    int       jit_verify_logged;
+    uint32_t  jit_verify_count[4];
+    uint64_t  jit_verify_spans[4];
+    uint64_t  jit_verify_mismatches[4];
+    uint16_t *jit_verify_buf[4];
+
+    int metrics_enabled; /* per-frame metrics (VOODOO_METRICS) */
+    int metrics_slot;    /* vid_voodoo_metrics.c slot, -1 = none */
+
+    struct voodoo_capture_t *capture; /* command stream capture (VOODOO_CAPTURE) */
+
     struct voodoo_set_t *set;
 
     uint32_t launch_pending;
@@ -23,4 +23,7 @@ void voodoo_generate_filter_v2(voodoo_t *voodoo);
 void voodoo_threshold_check(voodoo_t *voodoo);
 void voodoo_callback(void *priv);
 
+void voodoo_scanout_init(voodoo_t *voodoo);
+void voodoo_scanout_close(voodoo_t *voodoo);
+
 #endif /*VIDEO_VOODOO_DISPLAY_H*/
@@ -0,0 +1,89 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Persistent on-disk cache of Voodoo JIT pixel pipeline blocks.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#ifndef VIDEO_VOODOO_JIT_CACHE_H
+#define VIDEO_VOODOO_JIT_CACHE_H
+
+#define VOODOO_JIT_CACHE_ARCH_ARM64 1
+
+#define VOODOO_JIT_CACHE_MAX_RELOCS 16
+
+/*Render-state key of a compiled block, plus the per-card values the code
+  generator bakes in. Stored verbatim in the cache file.*/
+typedef struct voodoo_jit_cache_key_t {
+    int32_t  xdir;
+    uint32_t alphaMode;
+    uint32_t fbzMode;
+    uint32_t fogMode;
+    uint32_t fbzColorPath;
+    uint32_t textureMode[2];
+    uint32_t tLOD[2];
+    uint32_t trexInit1;
+    uint32_t is_tiled;
+    uint32_t dual_tmus;
+    uint32_t tmuConfig;
+} voodoo_jit_cache_key_t;
+
+/*A relocation is an absolute pointer load of `len` instructions at byte
+  offset `pos` in the block. `sym` identifies the target to the code
+  generator, which re-emits the load for the current address on install.*/
+typedef struct voodoo_jit_cache_reloc_t {
+    uint16_t pos;
+    uint8_t  len;
+    uint8_t  sym;
+} voodoo_jit_cache_reloc_t;
+
+typedef struct voodoo_jit_cache_entry_t {
+    voodoo_jit_cache_key_t   key;
+    uint32_t                 code_size;
+    uint32_t                 reloc_count;
+    voodoo_jit_cache_reloc_t relocs[VOODOO_JIT_CACHE_MAX_RELOCS];
+    uint8_t                 *code;
+    int                      code_owned;
+} voodoo_jit_cache_entry_t;
+
+typedef struct voodoo_jit_cache_t {
+    char name[64];
+    int  type;
+    int  instance;
+    char path[1024];
+
+    uint32_t arch;
+    uint32_t revision;
+    uint32_t block_size;
+    uint64_t fingerprint;
+
+    voodoo_jit_cache_entry_t *entries;
+    int                       nr_entries;
+    int                       max_entries;
+    int                      *hash; /*entry index by key, -1 if empty*/
+    uint8_t                  *image;
+    int                       dirty;
+
+    /*Statistics*/
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t rejects;
+    uint64_t stores;
+    uint64_t load_ticks;
+    int      loaded_entries;
+} voodoo_jit_cache_t;
+
+extern voodoo_jit_cache_t             *voodoo_jit_cache_open(const char *name, int type, uint32_t arch, uint32_t revision, uint32_t block_size, uint64_t fingerprint);
+extern void                            voodoo_jit_cache_close(voodoo_jit_cache_t *cache);
+extern const voodoo_jit_cache_entry_t *voodoo_jit_cache_find(voodoo_jit_cache_t *cache, const voodoo_jit_cache_key_t *key);
+extern void                            voodoo_jit_cache_store(voodoo_jit_cache_t *cache, const voodoo_jit_cache_key_t *key, const uint8_t *code, uint32_t code_size,
+                                                              const voodoo_jit_cache_reloc_t *relocs, uint32_t reloc_count);
+
+#endif /*VIDEO_VOODOO_JIT_CACHE_H*/
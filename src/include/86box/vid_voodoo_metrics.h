@@ -0,0 +1,66 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Per-frame Voodoo pipeline metrics.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#ifndef VIDEO_VOODOO_METRICS_H
+#define VIDEO_VOODOO_METRICS_H
+
+#define VOODOO_METRICS_CARDS 4
+
+/*Work done between two buffer swaps of one card. Counts are deltas over the
+  frame; frame and time_ms identify it.*/
+typedef struct voodoo_metrics_t {
+    uint64_t frame;   /*swaps seen on this card so far*/
+    uint32_t time_ms; /*plat_get_ticks() at the end of the frame*/
+    uint32_t frame_ms;
+
+    uint64_t triangles;
+    uint64_t pixels;
+    uint64_t texels;
+
+    uint64_t jit_hits;
+    uint64_t jit_misses;
+    uint64_t jit_compiles;
+    uint64_t jit_compile_ticks; /*plat_timer_read() units*/
+
+    uint64_t tex_hits;
+    uint64_t tex_misses;
+    uint64_t tex_evictions;
+
+    uint64_t fifo_stalls;      /*writes that found the FIFO full*/
+    uint64_t fifo_stall_ticks;
+    uint64_t fifo_wakeups;     /*times the FIFO thread was woken from sleep*/
+    uint64_t lfb_syncs;        /*LFB reads that drained the pipeline*/
+} voodoo_metrics_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*Reader side, callable from any thread. card is the order the cards were
+  initialised in (the SLI slave follows its master). Returns 0 if the card
+  does not exist or has not finished a frame yet.*/
+extern int voodoo_metrics_get(int card, voodoo_metrics_t *out);
+extern int voodoo_metrics_format(const voodoo_metrics_t *m, char *buf, int len);
+
+/*Card side, called on the emulation thread*/
+struct voodoo_t;
+extern void voodoo_metrics_init(struct voodoo_t *voodoo);
+extern void voodoo_metrics_close(struct voodoo_t *voodoo);
+extern void voodoo_metrics_frame(struct voodoo_t *voodoo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*VIDEO_VOODOO_METRICS_H*/
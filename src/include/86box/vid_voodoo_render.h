@@ -10,51 +10,51 @@ void voodoo_codegen_init(voodoo_t *voodoo);
 void voodoo_codegen_close(voodoo_t *voodoo);
 #endif
 
-#define DEPTH_TEST(comp_depth)                    \
-    do {                                          \
-        switch (depth_op) {                       \
-            case DEPTHOP_NEVER:                   \
-                voodoo->fbiZFuncFail++;           \
-                goto skip_pixel;                  \
-            case DEPTHOP_LESSTHAN:                \
-                if (!(comp_depth < old_depth)) {  \
-                    voodoo->fbiZFuncFail++;       \
-                    goto skip_pixel;              \
-                }                                 \
-                break;                            \
-            case DEPTHOP_EQUAL:                   \
-                if (!(comp_depth == old_depth)) { \
-                    voodoo->fbiZFuncFail++;       \
-                    goto skip_pixel;              \
-                }                                 \
-                break;                            \
-            case DEPTHOP_LESSTHANEQUAL:           \
-                if (!(comp_depth <= old_depth)) { \
-                    voodoo->fbiZFuncFail++;       \
-                    goto skip_pixel;              \
-                }                                 \
-                break;                            \
-            case DEPTHOP_GREATERTHAN:             \
-                if (!(comp_depth > old_depth)) {  \
-                    voodoo->fbiZFuncFail++;       \
-                    goto skip_pixel;              \
-                }                                 \
-                break;                            \
-            case DEPTHOP_NOTEQUAL:                \
-                if (!(comp_depth != old_depth)) { \
-                    voodoo->fbiZFuncFail++;       \
-                    goto skip_pixel;              \
-                }                                 \
-                break;                            \
-            case DEPTHOP_GREATERTHANEQUAL:        \
-                if (!(comp_depth >= old_depth)) { \
-                    voodoo->fbiZFuncFail++;       \
-                    goto skip_pixel;              \
-                }                                 \
-                break;                            \
-            case DEPTHOP_ALWAYS:                  \
-                break;                            \
-        }                                         \
+#define DEPTH_TEST(comp_depth)                      \
+    do {                                            \
+        switch (depth_op) {                         \
+            case DEPTHOP_NEVER:                     \
+                voodoo->fbiZFuncFail++;             \
+                goto skip_pixel;                    \
+            case DEPTHOP_LESSTHAN:                  \
+                if (!((comp_depth) < old_depth)) {  \
+                    voodoo->fbiZFuncFail++;         \
+                    goto skip_pixel;                \
+                }                                   \
+                break;                              \
+            case DEPTHOP_EQUAL:                     \
+                if (!((comp_depth) == old_depth)) { \
+                    voodoo->fbiZFuncFail++;         \
+                    goto skip_pixel;                \
+                }                                   \
+                break;                              \
+            case DEPTHOP_LESSTHANEQUAL:             \
+                if (!((comp_depth) <= old_depth)) { \
+                    voodoo->fbiZFuncFail++;         \
+                    goto skip_pixel;                \
+                }                                   \
+                break;                              \
+            case DEPTHOP_GREATERTHAN:               \
+                if (!((comp_depth) > old_depth)) {  \
+                    voodoo->fbiZFuncFail++;         \
+                    goto skip_pixel;                \
+                }                                   \
+                break;                              \
+            case DEPTHOP_NOTEQUAL:                  \
+                if (!((comp_depth) != old_depth)) { \
+                    voodoo->fbiZFuncFail++;         \
+                    goto skip_pixel;                \
+                }                                   \
+                break;                              \
+            case DEPTHOP_GREATERTHANEQUAL:          \
+                if (!((comp_depth) >= old_depth)) { \
+                    voodoo->fbiZFuncFail++;         \
+                    goto skip_pixel;                \
+                }                                   \
+                break;                              \
+            case DEPTHOP_ALWAYS:                    \
+                break;                              \
+        }                                           \
     } while (0)
 
 #define APPLY_FOG(src_r, src_g, src_b, z, ia, w)                                               \
@@ -274,7 +274,11 @@ void voodoo_render_thread_1(void *param);
 void voodoo_render_thread_2(void *param);
 void voodoo_render_thread_3(void *param);
 void voodoo_render_thread_4(void *param);
+extern void (*const voodoo_render_thread_funcs[4])(void *param);
 void voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params);
+void voodoo_queue_fastfill(voodoo_t *voodoo, voodoo_params_t *params);
+void voodoo_render_init_bands(voodoo_t *voodoo);
+void voodoo_wait_for_render_band(voodoo_t *voodoo, uint32_t offset, int row);
 
 extern int voodoo_recomp;
 extern int tris;
@@ -282,29 +286,44 @@ extern int tris;
 static __inline void
 voodoo_wake_render_thread(voodoo_t *voodoo)
 {
-    thread_set_event(voodoo->wake_render_thread[0]); /*Wake up render thread if moving from idle*/
-    if (voodoo->render_threads >= 2)
-        thread_set_event(voodoo->wake_render_thread[1]); /*Wake up render thread if moving from idle*/
-    if (voodoo->render_threads == 4) {
-        thread_set_event(voodoo->wake_render_thread[2]); /*Wake up render thread if moving from idle*/
-        thread_set_event(voodoo->wake_render_thread[3]); /*Wake up render thread if moving from idle*/
+    for (int c = 0; c < voodoo->render_threads; c++)
+        thread_set_event(voodoo->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+}
+
+static __inline int
+voodoo_render_threads_busy(voodoo_t *voodoo)
+{
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (RENDER_VOODOO_BUSY(voodoo, c))
+            return 1;
     }
+    return 0;
+}
+
+static __inline int
+voodoo_render_thread_pending(voodoo_t *voodoo, int c)
+{
+    return !PARAM_EMPTY(c) || RENDER_VOODOO_BUSY(voodoo, c);
 }
 
 static __inline void
 voodoo_wait_for_render_thread_idle(voodoo_t *voodoo)
 {
-    while (!PARAM_EMPTY(0) || (voodoo->render_threads >= 2 && !PARAM_EMPTY(1)) || (voodoo->render_threads == 4 && (!PARAM_EMPTY(2) || !PARAM_EMPTY(3))) || RENDER_VOODOO_BUSY(voodoo, 0) || (voodoo->render_threads >= 2 && RENDER_VOODOO_BUSY(voodoo, 1)) || (voodoo->render_threads == 4 && (RENDER_VOODOO_BUSY(voodoo, 2) || RENDER_VOODOO_BUSY(voodoo, 3)))) {
+    int pending;
+
+    do {
+        pending = 0;
+        for (int c = 0; c < voodoo->render_threads; c++)
+            pending |= voodoo_render_thread_pending(voodoo, c);
+        if (!pending)
+            break;
+
         voodoo_wake_render_thread(voodoo);
-        if (!PARAM_EMPTY(0) || RENDER_VOODOO_BUSY(voodoo, 0))
-            thread_wait_event(voodoo->render_not_full_event[0], 1);
-        if (voodoo->render_threads >= 2 && (!PARAM_EMPTY(1) || RENDER_VOODOO_BUSY(voodoo, 1)))
-            thread_wait_event(voodoo->render_not_full_event[1], 1);
-        if (voodoo->render_threads == 4 && (!PARAM_EMPTY(2) || RENDER_VOODOO_BUSY(voodoo, 2)))
-            thread_wait_event(voodoo->render_not_full_event[2], 1);
-        if (voodoo->render_threads == 4 && (!PARAM_EMPTY(3) || RENDER_VOODOO_BUSY(voodoo, 3)))
-            thread_wait_event(voodoo->render_not_full_event[3], 1);
-    }
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            if (voodoo_render_thread_pending(voodoo, c))
+                thread_wait_event(voodoo->render_not_full_event[c], 1);
+        }
+    } while (1);
 }
 
 #endif /*VIDEO_VOODOO_RENDER_H*/
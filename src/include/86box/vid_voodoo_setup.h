@@ -17,5 +17,7 @@
 #define VIDEO_VOODOO_SETUP_H
 
 void voodoo_triangle_setup(voodoo_t *voodoo);
+void voodoo_setup_begin_tri(voodoo_t *voodoo);
+void voodoo_setup_draw_tri(voodoo_t *voodoo);
 
 #endif /*VIDEO_VOODOO_SETUP_H*/
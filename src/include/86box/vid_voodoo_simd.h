@@ -0,0 +1,418 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Portable 4 x int32 vector helpers for the Voodoo interpreter.
+ *
+ *          One lane per pixel. Backed by SSE2 on x86, NEON on ARM64 and
+ *          plain arrays elsewhere, so the same span code runs on every
+ *          host. Comparisons return all-ones/all-zero lane masks. Shift
+ *          counts must be compile-time constants (NEON immediates).
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#ifndef VIDEO_VOODOO_SIMD_H
+#define VIDEO_VOODOO_SIMD_H
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define VOODOO_SIMD_SSE2
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define VOODOO_SIMD_NEON
+#else
+#    define VOODOO_SIMD_SCALAR
+#endif
+
+#define VOODOO_SIMD_LANES 4
+
+#if defined VOODOO_SIMD_SSE2
+typedef __m128i voodoo_v4i_t;
+
+#    define voodoo_v4i_srai(a, n) _mm_srai_epi32(a, n)
+#    define voodoo_v4i_srli(a, n) _mm_srli_epi32(a, n)
+#    define voodoo_v4i_slli(a, n) _mm_slli_epi32(a, n)
+
+static inline voodoo_v4i_t
+voodoo_v4i_set1(int32_t a)
+{
+    return _mm_set1_epi32(a);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_load(const int32_t *p)
+{
+    return _mm_loadu_si128((const __m128i *) p);
+}
+
+static inline void
+voodoo_v4i_store(int32_t *p, voodoo_v4i_t a)
+{
+    _mm_storeu_si128((__m128i *) p, a);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_add(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_sub(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_sub_epi32(a, b);
+}
+
+/*SSE2 has no 32-bit multiply-low; build it from the even/odd 32x32->64
+  products*/
+static inline voodoo_v4i_t
+voodoo_v4i_mul(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_and(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_and_si128(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_or(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_or_si128(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_xor(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_xor_si128(a, b);
+}
+
+/*a & ~mask*/
+static inline voodoo_v4i_t
+voodoo_v4i_andnot(voodoo_v4i_t a, voodoo_v4i_t mask)
+{
+    return _mm_andnot_si128(mask, a);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_cmpeq(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_cmpeq_epi32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_cmpgt(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_cmpgt_epi32(a, b);
+}
+
+/*mask ? a : b*/
+static inline voodoo_v4i_t
+voodoo_v4i_select(voodoo_v4i_t mask, voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/*One bit per lane, lane 0 in bit 0*/
+static inline int
+voodoo_v4i_movemask(voodoo_v4i_t mask)
+{
+    return _mm_movemask_ps(_mm_castsi128_ps(mask));
+}
+#elif defined VOODOO_SIMD_NEON
+typedef int32x4_t voodoo_v4i_t;
+
+#    define voodoo_v4i_srai(a, n) vshrq_n_s32(a, n)
+#    define voodoo_v4i_srli(a, n) vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), n))
+#    define voodoo_v4i_slli(a, n) vshlq_n_s32(a, n)
+
+static inline voodoo_v4i_t
+voodoo_v4i_set1(int32_t a)
+{
+    return vdupq_n_s32(a);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_load(const int32_t *p)
+{
+    return vld1q_s32(p);
+}
+
+static inline void
+voodoo_v4i_store(int32_t *p, voodoo_v4i_t a)
+{
+    vst1q_s32(p, a);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_add(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vaddq_s32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_sub(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vsubq_s32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_mul(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vmulq_s32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_and(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vandq_s32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_or(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vorrq_s32(a, b);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_xor(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return veorq_s32(a, b);
+}
+
+/*a & ~mask*/
+static inline voodoo_v4i_t
+voodoo_v4i_andnot(voodoo_v4i_t a, voodoo_v4i_t mask)
+{
+    return vbicq_s32(a, mask);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_cmpeq(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vreinterpretq_s32_u32(vceqq_s32(a, b));
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_cmpgt(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vreinterpretq_s32_u32(vcgtq_s32(a, b));
+}
+
+/*mask ? a : b*/
+static inline voodoo_v4i_t
+voodoo_v4i_select(voodoo_v4i_t mask, voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return vbslq_s32(vreinterpretq_u32_s32(mask), a, b);
+}
+
+/*One bit per lane, lane 0 in bit 0*/
+static inline int
+voodoo_v4i_movemask(voodoo_v4i_t mask)
+{
+    static const uint32_t bits[4] = { 1, 2, 4, 8 };
+
+    return vaddvq_u32(vandq_u32(vreinterpretq_u32_s32(mask), vld1q_u32(bits)));
+}
+#else
+typedef struct voodoo_v4i_t {
+    int32_t v[4];
+} voodoo_v4i_t;
+
+#    define VOODOO_V4I_OP(expr)                  \
+        do {                                     \
+            for (int _l = 0; _l < 4; _l++)       \
+                r.v[_l] = (expr);                \
+        } while (0)
+
+static inline voodoo_v4i_t
+voodoo_v4i_srai_s(voodoo_v4i_t a, int n)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(a.v[_l] >> n);
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_srli_s(voodoo_v4i_t a, int n)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((int32_t) ((uint32_t) a.v[_l] >> n));
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_slli_s(voodoo_v4i_t a, int n)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((int32_t) ((uint32_t) a.v[_l] << n));
+    return r;
+}
+
+#    define voodoo_v4i_srai(a, n) voodoo_v4i_srai_s(a, n)
+#    define voodoo_v4i_srli(a, n) voodoo_v4i_srli_s(a, n)
+#    define voodoo_v4i_slli(a, n) voodoo_v4i_slli_s(a, n)
+
+static inline voodoo_v4i_t
+voodoo_v4i_set1(int32_t a)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(a);
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_load(const int32_t *p)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(p[_l]);
+    return r;
+}
+
+static inline void
+voodoo_v4i_store(int32_t *p, voodoo_v4i_t a)
+{
+    for (int l = 0; l < 4; l++)
+        p[l] = a.v[l];
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_add(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((int32_t) ((uint32_t) a.v[_l] + (uint32_t) b.v[_l]));
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_sub(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((int32_t) ((uint32_t) a.v[_l] - (uint32_t) b.v[_l]));
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_mul(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((int32_t) ((uint32_t) a.v[_l] * (uint32_t) b.v[_l]));
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_and(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(a.v[_l] & b.v[_l]);
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_or(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(a.v[_l] | b.v[_l]);
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_xor(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(a.v[_l] ^ b.v[_l]);
+    return r;
+}
+
+/*a & ~mask*/
+static inline voodoo_v4i_t
+voodoo_v4i_andnot(voodoo_v4i_t a, voodoo_v4i_t mask)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP(a.v[_l] & ~mask.v[_l]);
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_cmpeq(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((a.v[_l] == b.v[_l]) ? -1 : 0);
+    return r;
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_cmpgt(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((a.v[_l] > b.v[_l]) ? -1 : 0);
+    return r;
+}
+
+/*mask ? a : b*/
+static inline voodoo_v4i_t
+voodoo_v4i_select(voodoo_v4i_t mask, voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    voodoo_v4i_t r;
+    VOODOO_V4I_OP((a.v[_l] & mask.v[_l]) | (b.v[_l] & ~mask.v[_l]));
+    return r;
+}
+
+/*One bit per lane, lane 0 in bit 0*/
+static inline int
+voodoo_v4i_movemask(voodoo_v4i_t mask)
+{
+    int r = 0;
+
+    for (int l = 0; l < 4; l++)
+        r |= (mask.v[l] < 0) << l;
+    return r;
+}
+#endif
+
+/*Derived operations shared by every backend*/
+static inline voodoo_v4i_t
+voodoo_v4i_min(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return voodoo_v4i_select(voodoo_v4i_cmpgt(a, b), b, a);
+}
+
+static inline voodoo_v4i_t
+voodoo_v4i_max(voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    return voodoo_v4i_select(voodoo_v4i_cmpgt(a, b), a, b);
+}
+
+/*CLAMP() - saturate each lane to 0..0xff*/
+static inline voodoo_v4i_t
+voodoo_v4i_clamp8(voodoo_v4i_t a)
+{
+    return voodoo_v4i_min(voodoo_v4i_max(a, voodoo_v4i_set1(0)), voodoo_v4i_set1(0xff));
+}
+
+/*CLAMP16() - saturate each lane to 0..0xffff*/
+static inline voodoo_v4i_t
+voodoo_v4i_clamp16(voodoo_v4i_t a)
+{
+    return voodoo_v4i_min(voodoo_v4i_max(a, voodoo_v4i_set1(0)), voodoo_v4i_set1(0xffff));
+}
+
+/*Exact x / 255 for 0 <= x <= 255 * 255*/
+static inline voodoo_v4i_t
+voodoo_v4i_div255(voodoo_v4i_t a)
+{
+    return voodoo_v4i_srli(voodoo_v4i_add(voodoo_v4i_add(a, voodoo_v4i_set1(1)), voodoo_v4i_srli(a, 8)), 8);
+}
+
+#endif /*VIDEO_VOODOO_SIMD_H*/
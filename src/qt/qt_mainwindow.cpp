@@ -49,6 +49,7 @@ extern "C" {
 #include <86box/mouse.h>
 #include <86box/machine.h>
 #include <86box/vid_ega.h>
+#include <86box/vid_voodoo_metrics.h>
 #include <86box/version.h>
 #include <86box/timer.h>
 #include <86box/apm.h>
@@ -205,6 +206,14 @@ MainWindow::MainWindow(QWidget *parent)
         hz = ((hz + 2) / 5) * 5;
 #endif
         hertz_label->setText(tr("%1 Hz").arg(QString::number(hz) + (monitors[0].mon_interlace ? "i" : "")));
+
+        voodoo_metrics_t metrics;
+        if (voodoo_metrics_get(0, &metrics)) {
+            char buf[512];
+            voodoo_metrics_format(&metrics, buf, sizeof(buf));
+            hertz_label->setToolTip(QString(buf));
+        } else
+            hertz_label->setToolTip(QString());
     });
     statusBar()->addPermanentWidget(hertz_label);
     frameRateTimer->start(1000);
@@ -21,6 +21,7 @@
 extern "C" {
 #include "86box/plat.h"
 #include "86box/config.h"
+#include "86box/vid_voodoo_metrics.h"
 }
 
 VMManagerClientSocket::VMManagerClientSocket(QObject *obj)
@@ -179,6 +180,7 @@ VMManagerClientSocket::jsonReceived(const QJsonObject &json)
             break;
         case VMManagerProtocol::ManagerMessage::RequestStatus:
             qDebug("Status request command received from manager");
+            sendStatus();
             break;
         case VMManagerProtocol::ManagerMessage::GlobalConfigurationChanged:
             {
@@ -196,6 +198,42 @@ VMManagerClientSocket::jsonReceived(const QJsonObject &json)
     }
 }
 
+void
+VMManagerClientSocket::sendStatus() const
+{
+    QJsonArray  voodoo_array;
+    QJsonObject extra_object;
+
+    // Last complete frame of every Voodoo card that has one
+    for (int card = 0; card < VOODOO_METRICS_CARDS; card++) {
+        voodoo_metrics_t metrics;
+        QJsonObject      card_object;
+
+        if (!voodoo_metrics_get(card, &metrics))
+            continue;
+        card_object["card"]              = card;
+        card_object["frame"]             = static_cast<qint64>(metrics.frame);
+        card_object["frame_ms"]          = static_cast<qint64>(metrics.frame_ms);
+        card_object["triangles"]         = static_cast<qint64>(metrics.triangles);
+        card_object["pixels"]            = static_cast<qint64>(metrics.pixels);
+        card_object["texels"]            = static_cast<qint64>(metrics.texels);
+        card_object["jit_hits"]          = static_cast<qint64>(metrics.jit_hits);
+        card_object["jit_misses"]        = static_cast<qint64>(metrics.jit_misses);
+        card_object["jit_compiles"]      = static_cast<qint64>(metrics.jit_compiles);
+        card_object["jit_compile_ticks"] = static_cast<qint64>(metrics.jit_compile_ticks);
+        card_object["tex_hits"]          = static_cast<qint64>(metrics.tex_hits);
+        card_object["tex_misses"]        = static_cast<qint64>(metrics.tex_misses);
+        card_object["tex_evictions"]     = static_cast<qint64>(metrics.tex_evictions);
+        card_object["fifo_stalls"]       = static_cast<qint64>(metrics.fifo_stalls);
+        card_object["fifo_stall_ticks"]  = static_cast<qint64>(metrics.fifo_stall_ticks);
+        card_object["fifo_wakeups"]      = static_cast<qint64>(metrics.fifo_wakeups);
+        card_object["lfb_syncs"]         = static_cast<qint64>(metrics.lfb_syncs);
+        voodoo_array.append(card_object);
+    }
+    extra_object["voodoo"] = voodoo_array;
+    sendMessageWithObject(VMManagerProtocol::ClientMessage::Status, extra_object);
+}
+
 void
 VMManagerClientSocket::connectionError(const QLocalSocket::LocalSocketError socketError)
 {
@@ -62,6 +62,8 @@ private:
     // Full send message function called by all convenience functions
     void sendMessageFull(VMManagerProtocol::ClientMessage protocol_message, const QStringList &list, const QJsonObject &json) const;
     void jsonReceived(const QJsonObject &json);
+    // Reply to RequestStatus with the per-frame Voodoo metrics
+    void sendStatus() const;
 
     void dataReady();
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
@@ -10,27 +11,132 @@
 uint64_t TIMER_USEC;
 uint64_t timer_target;
 
-/*Enabled timers are stored in a linked list, with the first timer to expire at
-  the head.*/
-pc_timer_t *timer_head = NULL;
+/*Enabled timers are kept in a linked list sorted on expiry while there are
+  few of them, and in a binary min-heap once there are TIMER_HEAP_ON or more.
+  The list is cheaper for the handful of timers most machines have, the heap
+  keeps re-arming O(log n) on machines with many. Either way the first timer
+  to expire is at the head, and timers due at the same time expire newest
+  first - each timer goes in front of any equal ones.*/
+#define TIMER_HEAP_ON  64 /*Move to the heap at this many enabled timers*/
+#define TIMER_HEAP_OFF 32 /*Back to the list below this many*/
+
+static pc_timer_t  *timer_head     = NULL;
+static pc_timer_t **timer_heap     = NULL;
+static int          timer_heap_on  = 0;
+static int          timer_heap_max = 0;
+static int          timer_count    = 0; /*Enabled timers, in the list or the heap*/
+static uint64_t     timer_seq      = 0;
 
 /* Are we initialized? */
 int timer_inited = 0;
 
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
-void
-timer_enable(pc_timer_t *timer)
+/*True if timer a expires before timer b*/
+static __inline int
+timer_heap_before(pc_timer_t *a, pc_timer_t *b)
 {
-    pc_timer_t *timer_node = timer_head;
+    int64_t diff = (int64_t) (a->ts_integer - b->ts_integer);
 
-    if (timer->flags & TIMER_ENABLED)
-        timer_disable(timer);
+    return (diff < 0) || (!diff && (a->seq > b->seq));
+}
 
-    if (timer->next || timer->prev)
-        fatal("timer_enable - timer->next\n");
+static __inline void
+timer_heap_set(int pos, pc_timer_t *timer)
+{
+    timer_heap[pos] = timer;
+    timer->heap_pos = pos;
+}
 
-    timer->flags |= TIMER_ENABLED;
+static __inline int
+timer_heap_contains(pc_timer_t *timer)
+{
+    return (timer->heap_pos >= 0) && (timer->heap_pos < timer_count) && (timer_heap[timer->heap_pos] == timer);
+}
+
+static void
+timer_heap_up(int pos)
+{
+    pc_timer_t *timer = timer_heap[pos];
+
+    while (pos > 0) {
+        int parent = (pos - 1) >> 1;
+
+        if (!timer_heap_before(timer, timer_heap[parent]))
+            break;
+        timer_heap_set(pos, timer_heap[parent]);
+        pos = parent;
+    }
+    timer_heap_set(pos, timer);
+}
+
+static void
+timer_heap_down(int pos)
+{
+    pc_timer_t *timer = timer_heap[pos];
+
+    while (1) {
+        int child = (pos << 1) + 1;
+
+        if (child >= timer_count)
+            break;
+        if (((child + 1) < timer_count) && timer_heap_before(timer_heap[child + 1], timer_heap[child]))
+            child++;
+        if (!timer_heap_before(timer_heap[child], timer))
+            break;
+        timer_heap_set(pos, timer_heap[child]);
+        pos = child;
+    }
+    timer_heap_set(pos, timer);
+}
+
+static void
+timer_heap_grow(void)
+{
+    timer_heap_max = timer_heap_max ? (timer_heap_max * 2) : (TIMER_HEAP_ON * 2);
+    timer_heap     = realloc(timer_heap, timer_heap_max * sizeof(pc_timer_t *));
+    if (!timer_heap)
+        fatal("timer_enable - out of memory\n");
+}
+
+static void
+timer_heap_insert(pc_timer_t *timer)
+{
+    if (timer_count == timer_heap_max)
+        timer_heap_grow();
+
+    timer_heap[timer_count] = timer;
+    timer_heap_up(timer_count++);
+
+    /*New first timer to expire*/
+    if (!timer->heap_pos)
+        timer_target = timer->ts_integer;
+}
+
+static void
+timer_heap_remove(pc_timer_t *timer)
+{
+    int         pos  = timer->heap_pos;
+    pc_timer_t *last = timer_heap[--timer_count];
+
+    timer->heap_pos = -1;
+    if (last == timer)
+        return;
+
+    /*Move the last timer into the hole, then up or down to its place*/
+    timer_heap_set(pos, last);
+    if ((pos > 0) && timer_heap_before(last, timer_heap[(pos - 1) >> 1]))
+        timer_heap_up(pos);
+    else
+        timer_heap_down(pos);
+}
+
+static void
+timer_list_insert(pc_timer_t *timer)
+{
+    pc_timer_t *timer_node = timer_head;
+
+    timer_count++;
 
     /*List currently empty - add to head*/
     if (!timer_head) {
@@ -40,8 +146,6 @@ timer_enable(pc_timer_t *timer)
         return;
     }
 
-    timer_node = timer_head;
-
     while (1) {
         /*
            Timer expires before timer_node.
@@ -74,56 +178,149 @@ timer_enable(pc_timer_t *timer)
     }
 }
 
+static void
+timer_list_remove(pc_timer_t *timer)
+{
+    timer_count--;
+
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        timer_head = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+/*The list is in expiry order, which is already a valid heap*/
+static void
+timer_list_to_heap(void)
+{
+    pc_timer_t *timer = timer_head;
+
+    while (timer_heap_max < (timer_count + 1))
+        timer_heap_grow();
+
+    for (int c = 0; timer; c++) {
+        pc_timer_t *next = timer->next;
+
+        timer_heap_set(c, timer);
+        timer->prev = timer->next = NULL;
+        timer = next;
+    }
+
+    timer_head    = NULL;
+    timer_heap_on = 1;
+}
+
+static int
+timer_compare(const void *a, const void *b)
+{
+    pc_timer_t *timer_a = *(pc_timer_t *const *) a;
+    pc_timer_t *timer_b = *(pc_timer_t *const *) b;
+
+    if (timer_heap_before(timer_a, timer_b))
+        return -1;
+    return timer_heap_before(timer_b, timer_a) ? 1 : 0;
+}
+
+static void
+timer_heap_to_list(void)
+{
+    qsort(timer_heap, timer_count, sizeof(pc_timer_t *), timer_compare);
+
+    timer_head = timer_count ? timer_heap[0] : NULL;
+    for (int c = 0; c < timer_count; c++) {
+        pc_timer_t *timer = timer_heap[c];
+
+        timer->prev     = c ? timer_heap[c - 1] : NULL;
+        timer->next     = ((c + 1) < timer_count) ? timer_heap[c + 1] : NULL;
+        timer->heap_pos = -1;
+    }
+
+    timer_heap_on = 0;
+}
+
+static __inline int
+timer_queued(pc_timer_t *timer)
+{
+    if (timer_heap_on)
+        return timer_heap_contains(timer);
+    return timer->next || timer->prev || (timer == timer_head);
+}
+
+void
+timer_enable(pc_timer_t *timer)
+{
+    if (timer->flags & TIMER_ENABLED)
+        timer_disable(timer);
+
+    if (timer_queued(timer))
+        fatal("timer_enable - timer already queued\n");
+
+    timer->flags |= TIMER_ENABLED;
+    timer->seq = timer_seq++;
+
+    if (!timer_heap_on && ((timer_count + 1) >= TIMER_HEAP_ON))
+        timer_list_to_heap();
+
+    if (timer_heap_on)
+        timer_heap_insert(timer);
+    else
+        timer_list_insert(timer);
+}
+
+static void
+timer_remove(pc_timer_t *timer)
+{
+    if (!timer_heap_on)
+        timer_list_remove(timer);
+    else {
+        timer_heap_remove(timer);
+        if (timer_count < TIMER_HEAP_OFF)
+            timer_heap_to_list();
+    }
+}
+
 void
 timer_disable(pc_timer_t *timer)
 {
     if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
         return;
 
-    if (!timer->next && !timer->prev && timer != timer_head) {
+    if (!timer_queued(timer)) {
         uint32_t *p = NULL;
         *p = 5;    /* Crash deliberately. */
-        fatal("timer_disable(): Attempting to disable an isolated "
-              "non-head timer incorrectly marked as enabled\n");
+        fatal("timer_disable(): Attempting to disable a timer that is "
+              "not queued but incorrectly marked as enabled\n");
     }
 
     timer->flags &= ~TIMER_ENABLED;
     timer->in_callback = 0;
 
-    if (timer->prev)
-        timer->prev->next = timer->next;
-    else
-        timer_head = timer->next;
-    if (timer->next)
-        timer->next->prev = timer->prev;
-    timer->prev = timer->next = NULL;
+    timer_remove(timer);
 }
 
-static void
-timer_remove_head(void)
+static __inline pc_timer_t *
+timer_first(void)
 {
-    if (timer_head) {
-        pc_timer_t *timer = timer_head;
-        timer_head = timer->next;
-        timer_head->prev = NULL;
-        timer->next = timer->prev = NULL;
-        timer->flags &= ~TIMER_ENABLED;
-    }
+    return timer_heap_on ? timer_heap[0] : timer_head;
 }
 
 void
 timer_process(void)
 {
-    if (!timer_head)
+    if (!timer_count)
         return;
 
-    while (1) {
-        pc_timer_t *timer = timer_head;
+    while (timer_count) {
+        pc_timer_t *timer = timer_first();
 
         if (!TIMER_LESS_THAN_VAL(timer, (uint64_t) tsc))
             break;
 
-        timer_remove_head();
+        timer_remove(timer);
+        timer->flags &= ~TIMER_ENABLED;
 
         if (timer->flags & TIMER_SPLIT)
             timer_advance_ex(timer, 0);   /* We're splitting a > 1 s period into
@@ -140,25 +337,36 @@ timer_process(void)
         }
     }
 
-    timer_target = timer_head->ts_integer;
+    if (timer_count)
+        timer_target = timer_first()->ts_integer;
 }
 
 void
 timer_close(void)
 {
-    pc_timer_t *t = timer_head;
-    pc_timer_t *r;
-
-    /* Set all timers' prev and next to NULL so it is assured that
-       timers that are not in calloc'd structs don't keep pointing
-       to timers that may be in calloc'd structs. */
-    while (t != NULL) {
-        r       = t;
-        r->prev = r->next = NULL;
-        t                 = r->next;
+    /* Drop all timers from the queue, so that timers that are not in
+       calloc'd structs aren't left marked as enabled or pointing to
+       timers that may be in calloc'd structs. */
+    if (timer_heap_on) {
+        for (int c = 0; c < timer_count; c++) {
+            timer_heap[c]->flags &= ~TIMER_ENABLED;
+            timer_heap[c]->heap_pos = -1;
+        }
+    } else {
+        pc_timer_t *t = timer_head;
+
+        while (t != NULL) {
+            pc_timer_t *r = t;
+
+            t = r->next;
+            r->flags &= ~TIMER_ENABLED;
+            r->prev = r->next = NULL;
+        }
     }
 
-    timer_head = NULL;
+    timer_head    = NULL;
+    timer_heap_on = 0;
+    timer_count   = 0;
 
     timer_inited = 0;
 }
@@ -185,6 +393,7 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->priv        = priv;
     timer->flags       = 0;
     timer->prev        = timer->next = NULL;
+    timer->heap_pos    = -1;
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -259,29 +468,36 @@ timer_on_auto(pc_timer_t *timer, double period)
         timer_stop(timer);
 }
 
+static void
+timer_shift_tsc(pc_timer_t *timer, uint64_t new_tsc)
+{
+    int64_t offset_from_current_tsc = (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
+    timer->ts_integer = new_tsc + offset_from_current_tsc;
+}
+
 void
 timer_set_new_tsc(uint64_t new_tsc)
 {
-    pc_timer_t *timer = NULL;
     /* Run timers already expired. */
 #ifdef USE_DYNAREC
     if (cpu_use_dynarec)
         update_tsc();
 #endif
 
-    if (!timer_head) {
+    if (!timer_count) {
         tsc = new_tsc;
         return;
     }
 
-    timer = timer_head;
-    timer_target = new_tsc + (int64_t)(timer_get_ts_int(timer_head) - (uint64_t)tsc);
+    timer_target = new_tsc + (int64_t)(timer_get_ts_int(timer_first()) - (uint64_t)tsc);
 
-    while (timer) {
-        int64_t offset_from_current_tsc = (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
-        timer->ts_integer = new_tsc + offset_from_current_tsc;
-
-        timer = timer->next;
+    /* Every timer moves by the same amount, so the queue stays ordered. */
+    if (timer_heap_on) {
+        for (int c = 0; c < timer_count; c++)
+            timer_shift_tsc(timer_heap[c], new_tsc);
+    } else {
+        for (pc_timer_t *timer = timer_head; timer; timer = timer->next)
+            timer_shift_tsc(timer, new_tsc);
     }
 
     tsc = new_tsc;
@@ -0,0 +1,355 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Timer queue micro-benchmark.
+ *
+ *          Runs timer.c against stubs for the rest of the machine and, for
+ *          a range of active timer counts, reports the cost of re-arming a
+ *          timer (timer_set_delay_u64()), disabling one, and firing one from
+ *          timer_process() with the callback re-arming it as devices do.
+ *          The same operations are timed on a copy of the sorted list the
+ *          queue used to be, and the order timers fire in is checked
+ *          against it, ties included.
+ *
+ *          Usage: timer_bench [-n ops]
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/timer.h>
+#include <86box/nv/vid_nv_rivatimer.h>
+
+/*CPU cycles per us*/
+#define BENCH_CLOCK_MHZ 100
+
+/*Machine stubs*/
+uint64_t tsc;
+int      cpu_use_dynarec;
+
+void
+update_tsc(void)
+{
+}
+
+void
+rivatimer_init(void)
+{
+}
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+/*The old timer queue: a list sorted on ts, each timer inserted in front of
+  any equal ones*/
+typedef struct ref_timer_t {
+    uint64_t            ts;
+    uint64_t            period;
+    int                 id;
+    int                 enabled;
+    struct ref_timer_t *prev;
+    struct ref_timer_t *next;
+} ref_timer_t;
+
+static ref_timer_t *ref_head;
+
+static void
+ref_disable(ref_timer_t *timer)
+{
+    if (!timer->enabled)
+        return;
+    timer->enabled = 0;
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        ref_head = timer->next;
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+static void
+ref_enable(ref_timer_t *timer)
+{
+    ref_timer_t *node;
+    ref_timer_t *last = NULL;
+
+    ref_disable(timer);
+    timer->enabled = 1;
+    node           = ref_head;
+    while (node && (int64_t) (timer->ts - node->ts) > 0) {
+        last = node;
+        node = node->next;
+    }
+    timer->prev = last;
+    timer->next = node;
+    if (last)
+        last->next = timer;
+    else
+        ref_head = timer;
+    if (node)
+        node->prev = timer;
+}
+
+/*Workload*/
+typedef struct bench_timer_t {
+    pc_timer_t  timer;
+    ref_timer_t ref;
+    uint64_t    period; /*32:32*/
+} bench_timer_t;
+
+static bench_timer_t *bench_timers;
+static int           *bench_order;
+static int           *fire_log;
+static int            fire_pos;
+static int            fire_max;
+static uint32_t       bench_rand_state;
+
+static uint32_t
+bench_rand(void)
+{
+    bench_rand_state = bench_rand_state * 1103515245 + 12345;
+    return bench_rand_state >> 8;
+}
+
+/*Whole microseconds, so plenty of timers fall due together*/
+static uint64_t
+bench_delay(void)
+{
+    return (uint64_t) (1 + (bench_rand() % 64)) * TIMER_USEC;
+}
+
+static void
+bench_callback(void *priv)
+{
+    bench_timer_t *t = (bench_timer_t *) priv;
+
+    if (fire_pos < fire_max)
+        fire_log[fire_pos++] = (int) (t - bench_timers);
+    timer_advance_u64(&t->timer, t->period);
+}
+
+static void
+ref_process(void)
+{
+    while (ref_head && (int64_t) (ref_head->ts - tsc) <= 0) {
+        ref_timer_t *timer = ref_head;
+
+        ref_disable(timer);
+        if (fire_pos < fire_max)
+            fire_log[fire_pos++] = timer->id;
+        timer->ts += timer->period >> 32;
+        ref_enable(timer);
+    }
+}
+
+static uint64_t
+bench_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static void
+bench_setup(int count, int ref)
+{
+    bench_rand_state = count;
+    tsc              = 0;
+    if (ref)
+        ref_head = NULL;
+    else {
+        timer_close();
+        timer_init();
+    }
+
+    for (int c = 0; c < count; c++) {
+        bench_timer_t *t = &bench_timers[c];
+
+        t->period = bench_delay();
+        if (ref) {
+            memset(&t->ref, 0, sizeof(ref_timer_t));
+            t->ref.id     = c;
+            t->ref.period = t->period;
+            t->ref.ts     = t->period >> 32;
+            ref_enable(&t->ref);
+        } else {
+            timer_add(&t->timer, bench_callback, t, 0);
+            timer_set_delay_u64(&t->timer, t->period);
+        }
+    }
+}
+
+/*Re-arm, disable and fire ops times each; returns ns per op in ns[3]*/
+static void
+bench_run(int count, int ops, int ref, double *ns)
+{
+    uint64_t start;
+    uint64_t step = BENCH_CLOCK_MHZ;
+
+    bench_setup(count, ref);
+    for (int c = 0; c < count; c++)
+        bench_order[c] = c;
+
+    start = bench_time_ns();
+    for (int c = 0; c < ops; c++) {
+        bench_timer_t *t = &bench_timers[bench_rand() % count];
+
+        if (ref) {
+            t->ref.ts = tsc + (bench_delay() >> 32);
+            ref_enable(&t->ref);
+        } else
+            timer_set_delay_u64(&t->timer, bench_delay());
+    }
+    ns[0] = (double) (bench_time_ns() - start) / ops;
+
+    /*Disable every timer in a shuffled order, then re-arm them untimed*/
+    ns[1] = 0;
+    for (int done = 0; done < ops; done += count) {
+        for (int c = count - 1; c > 0; c--) {
+            int tmp        = bench_order[c];
+            int d          = bench_rand() % (c + 1);
+            bench_order[c] = bench_order[d];
+            bench_order[d] = tmp;
+        }
+
+        start = bench_time_ns();
+        for (int c = 0; c < count; c++) {
+            bench_timer_t *t = &bench_timers[bench_order[c]];
+
+            if (ref)
+                ref_disable(&t->ref);
+            else
+                timer_disable(&t->timer);
+        }
+        ns[1] += (double) (bench_time_ns() - start);
+
+        for (int c = 0; c < count; c++) {
+            bench_timer_t *t = &bench_timers[c];
+
+            if (ref) {
+                t->ref.ts = tsc + (bench_delay() >> 32);
+                ref_enable(&t->ref);
+            } else
+                timer_set_delay_u64(&t->timer, bench_delay());
+        }
+    }
+    ns[1] /= ((ops + count - 1) / count) * count;
+
+    fire_pos = 0;
+    fire_max = ops;
+    start    = bench_time_ns();
+    while (fire_pos < ops) {
+        tsc += step;
+        if (ref)
+            ref_process();
+        else if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint64_t) tsc))
+            timer_process();
+    }
+    ns[2] = (double) (bench_time_ns() - start) / ops;
+}
+
+/*Fire the same schedule through both queues and compare the order*/
+static int
+bench_check(int count, int ops)
+{
+    int *log = malloc(ops * sizeof(int));
+    int  ret = 1;
+
+    for (int ref = 0; ref < 2; ref++) {
+        bench_setup(count, ref);
+        fire_pos = 0;
+        fire_max = ops;
+        while (fire_pos < ops) {
+            tsc += BENCH_CLOCK_MHZ;
+            if (ref)
+                ref_process();
+            else if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint64_t) tsc))
+                timer_process();
+        }
+        if (!ref)
+            memcpy(log, fire_log, ops * sizeof(int));
+    }
+
+    for (int c = 0; c < ops; c++) {
+        if (log[c] != fire_log[c]) {
+            fprintf(stderr, "%i timers: firing order differs at %i (timer %i, list has %i)\n",
+                    count, c, log[c], fire_log[c]);
+            ret = 0;
+            break;
+        }
+    }
+    free(log);
+
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    static const int counts[] = { 4, 8, 16, 32, 64, 128, 256, 1024 };
+    const int        max      = counts[(sizeof(counts) / sizeof(counts[0])) - 1];
+    int              ops      = 1000000;
+    int              ok       = 1;
+
+    if (argc == 3 && !strcmp(argv[1], "-n"))
+        ops = atoi(argv[2]);
+    if ((argc != 1 && argc != 3) || ops < 1) {
+        fprintf(stderr, "usage: %s [-n ops]\n", argv[0]);
+        return 1;
+    }
+
+    TIMER_USEC   = (uint64_t) BENCH_CLOCK_MHZ << 32;
+    bench_timers = calloc(max, sizeof(bench_timer_t));
+    bench_order  = malloc(max * sizeof(int));
+    fire_log     = malloc(ops * sizeof(int));
+    timer_init();
+
+    printf("ns/op      re-arm            disable           fire\n");
+    printf("timers     queue    list     queue    list     queue    list\n");
+    for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        double queue[3];
+        double list[3];
+
+        ok &= bench_check(counts[c], ops);
+        bench_run(counts[c], ops, 0, queue);
+        bench_run(counts[c], ops, 1, list);
+        printf("%-8i %7.1f  %7.1f  %7.1f  %7.1f  %7.1f  %7.1f\n", counts[c],
+               queue[0], list[0], queue[1], list[1], queue[2], list[2]);
+    }
+
+    timer_close();
+    free(fire_log);
+    free(bench_order);
+    free(bench_timers);
+
+    if (!ok)
+        return 2;
+    printf("Firing order matches the sorted list\n");
+    return 0;
+}
@@ -75,9 +75,13 @@ static int dither[4][4] = {
 #define RB_SIZE 256
 #define RB_MASK (RB_SIZE - 1)
 
-#define RB_ENTRIES (virge->s3d_write_idx - virge->s3d_read_idx)
+#define RB_ENTRIES (virge->s3d_write_idx - s3_virge_s3d_read_idx(virge))
 #define RB_FULL (RB_ENTRIES == RB_SIZE)
 #define RB_EMPTY (!RB_ENTRIES)
+#define RB_THREAD_PENDING(t) (virge->s3d_write_idx != virge->s3d_read_idx[t])
+
+#define S3D_MAX_RENDER_THREADS 4
+#define S3D_BAND_SHIFT         3 /*8-line bands*/
 
 #define FIFO_SIZE 65536
 #define FIFO_MASK (FIFO_SIZE - 1)
@@ -219,11 +223,12 @@ typedef struct virge_t {
     int dithering_enabled;
     int memory_size;
 
-    int pixel_count;
-    int tri_count;
+    ATOMIC_INT pixel_count;
+    int        tri_count;
 
-    thread_t *render_thread;
-    event_t  *wake_render_thread;
+    int       render_threads;
+    thread_t *render_thread[S3D_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[S3D_MAX_RENDER_THREADS];
     event_t  *wake_main_thread;
     event_t  *not_full_event;
 
@@ -291,9 +296,9 @@ typedef struct virge_t {
     s3d_t s3d_tri;
 
     s3d_t      s3d_buffer[RB_SIZE];
-    ATOMIC_INT s3d_read_idx;
+    ATOMIC_INT s3d_read_idx[S3D_MAX_RENDER_THREADS];
     ATOMIC_INT s3d_write_idx;
-    ATOMIC_INT s3d_busy;
+    ATOMIC_INT s3d_busy; /*Bit per render thread*/
 
     struct {
         uint32_t pri_ctrl;
@@ -3422,9 +3427,9 @@ skip_line:
         g = (val & 0xff00) >> 8;   \
         r = (val & 0xff0000) >> 16
 
-#define RGB15(r, g, b, dest)                        \
+#define RGB15(r, g, b, x, y, dest)                  \
         if (virge->dithering_enabled) {             \
-                int add = dither[_y & 3][_x & 3];   \
+                int add = dither[(y) & 3][(x) & 3]; \
                 int _r = (r > 248) ? 248 : r + add; \
                 int _g = (g > 248) ? 248 : g + add; \
                 int _b = (b > 248) ? 248 : b + add; \
@@ -3445,6 +3450,23 @@ typedef struct rgba_t {
     int a;
 } rgba_t;
 
+enum {
+    S3D_TEX_ARGB8888 = 0,
+    S3D_TEX_ARGB4444,
+    S3D_TEX_ARGB1555
+};
+
+enum {
+    S3D_LIT_GOURAUD = 0,
+    S3D_LIT_UNLIT,
+    S3D_LIT_REFLECTION,
+    S3D_LIT_MODULATE
+};
+
+struct s3d_state_t;
+
+typedef void (*s3d_tri_span_t)(virge_t *virge, s3d_t *s3d_tri, struct s3d_state_t *state, int yc, int32_t dx1, int32_t dx2);
+
 typedef struct s3d_state_t {
     int32_t r;
     int32_t g;
@@ -3482,6 +3504,19 @@ typedef struct s3d_state_t {
     int y;
 
     rgba_t dest_rgba;
+
+    /*Texture addressing, fixed per triangle*/
+    int tex_wrap;
+    int tex_mipmap;
+    int tex_persp_shift; /*0 = affine, 12 = 325/VX/GX, 8 = DX/GX2*/
+
+    /*Rows drawn by this thread are those with ((y >> S3D_BAND_SHIFT) % band_threads) == band_thread*/
+    int band_thread;
+    int band_threads;
+
+    int pixel_count;
+
+    s3d_tri_span_t tri_span;
 } s3d_state_t;
 
 typedef struct s3d_texture_state_t {
@@ -3492,322 +3527,61 @@ typedef struct s3d_texture_state_t {
     int32_t v;
 } s3d_texture_state_t;
 
-static void (*tex_read)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
-static void (*tex_sample)(s3d_state_t *state);
-static void (*dest_pixel)(s3d_state_t *state);
-
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-static int _x;
-static int _y;
-
-static void
-tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    out->r = ((val & 0x7c00) >> 7) | ((val & 0x7000) >> 12);
-    out->g = ((val & 0x03e0) >> 2) | ((val & 0x0380) >> 7);
-    out->b = ((val & 0x001f) << 3) | ((val & 0x001c) >> 2);
-    out->a = (val & 0x8000) ? 0xff : 0;
-}
-
-static void
-tex_ARGB1555_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    if (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000)
-        val = state->tex_bdr_clr;
-
-    out->r = ((val & 0x7c00) >> 7) | ((val & 0x7000) >> 12);
-    out->g = ((val & 0x03e0) >> 2) | ((val & 0x0380) >> 7);
-    out->b = ((val & 0x001f) << 3) | ((val & 0x001c) >> 2);
-    out->a = (val & 0x8000) ? 0xff : 0;
-}
-
-static void
-tex_ARGB4444(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+/*Texel fetch. format is a compile-time constant in every caller, so each span
+  instance below only carries the decode for its own format.*/
+__attribute__((always_inline)) static inline void
+tex_read(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out, const int format)
 {
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    out->r = ((val & 0x0f00) >> 4) | ((val & 0x0f00) >> 8);
-    out->g = (val & 0x00f0) | ((val & 0x00f0) >> 4);
-    out->b = ((val & 0x000f) << 4) | (val & 0x000f);
-    out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
-}
-
-static void
-tex_ARGB4444_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    if (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000)
-        val = state->tex_bdr_clr;
-
-    out->r = ((val & 0x0f00) >> 4) | ((val & 0x0f00) >> 8);
-    out->g = (val & 0x00f0) | ((val & 0x00f0) >> 4);
-    out->b = ((val & 0x000f) << 4) | (val & 0x000f);
-    out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
-}
-
-static void
-tex_ARGB8888(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                  (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint32_t val = ((uint32_t *)state->texture[texture_state->level])[offset];
-
-    out->r = (val >> 16) & 0xff;
-    out->g = (val >> 8) & 0xff;
-    out->b = val & 0xff;
-    out->a = (val >> 24) & 0xff;
-}
-
-static void
-tex_ARGB8888_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint32_t val = ((uint32_t *)state->texture[texture_state->level])[offset];
-
-    if (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000)
-        val = state->tex_bdr_clr;
-
-    out->r = (val >> 16) & 0xff;
-    out->g = (val >> 8) & 0xff;
-    out->b = val & 0xff;
-    out->a = (val >> 24) & 0xff;
-}
-
-static void
-tex_sample_normal(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = state->u + state->tbu;
-    texture_state.v             = state->v + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_normal_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_mipmap(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = state->u + state->tbu;
-    texture_state.v             = state->v + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_mipmap_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_persp_normal(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_persp_normal_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-    int32_t             u;
-    int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    int      offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
+                      (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
+    int      border = !state->tex_wrap && (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000);
+    uint32_t val;
 
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
+    switch (format) {
+        case S3D_TEX_ARGB8888:
+            val = ((uint32_t *) state->texture[texture_state->level])[offset];
+            if (border)
+                val = state->tex_bdr_clr;
 
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
+            out->r = (val >> 16) & 0xff;
+            out->g = (val >> 8) & 0xff;
+            out->b = val & 0xff;
+            out->a = (val >> 24) & 0xff;
+            break;
 
-static void
-tex_sample_persp_normal_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
+        case S3D_TEX_ARGB4444:
+            val = state->texture[texture_state->level][offset];
+            if (border)
+                val = state->tex_bdr_clr & 0xffff;
 
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
+            out->r = ((val & 0x0f00) >> 4) | ((val & 0x0f00) >> 8);
+            out->g = (val & 0x00f0) | ((val & 0x00f0) >> 4);
+            out->b = ((val & 0x000f) << 4) | (val & 0x000f);
+            out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
+            break;
 
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
+        default:
+            val = state->texture[texture_state->level][offset];
+            if (border)
+                val = state->tex_bdr_clr & 0xffff;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+            out->r = ((val & 0x7c00) >> 7) | ((val & 0x7000) >> 12);
+            out->g = ((val & 0x03e0) >> 2) | ((val & 0x0380) >> 7);
+            out->b = ((val & 0x001f) << 3) | ((val & 0x001c) >> 2);
+            out->a = (val & 0x8000) ? 0xff : 0;
+            break;
+    }
 }
 
-static void
-tex_sample_persp_normal_filter_375(s3d_state_t *state)
+/*Texture sample into state->dest_rgba. Mipmapping and perspective correction
+  are per-triangle flags; format and filter are compile-time constants.*/
+__attribute__((always_inline)) static inline void
+tex_sample(s3d_state_t *state, const int format, const int filter)
 {
     s3d_texture_state_t texture_state;
-    int32_t             w = 0;
     int32_t             u;
     int32_t             v;
     int                 tex_offset;
@@ -3816,187 +3590,51 @@ tex_sample_persp_normal_filter_375(s3d_state_t *state)
     int                 dv;
     int                 d[4];
 
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
-
-    texture_state.level         = state->max_d;
+    if (state->tex_mipmap) {
+        texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
+        if (texture_state.level < 0)
+            texture_state.level = 0;
+    } else
+        texture_state.level = state->max_d;
     texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
 
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_persp_mipmap(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
+    if (state->tex_persp_shift) {
+        int32_t w = 0;
 
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
+        if (state->w)
+            w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
 
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_persp_mipmap_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-    int32_t             u;
-    int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
+        u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (state->tex_persp_shift + state->max_d)) + state->tbu;
+        v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (state->tex_persp_shift + state->max_d)) + state->tbv;
+    } else {
+        u = state->u + state->tbu;
+        v = state->v + state->tbv;
+    }
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_persp_mipmap_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-    int32_t             u;
-    int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
+    if (!filter) {
+        tex_read(state, &texture_state, &state->dest_rgba, format);
+        return;
+    }
 
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
+    tex_offset = 1 << texture_state.texture_shift;
 
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    tex_read(state, &texture_state, &tex_samples[0], format);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    tex_read(state, &texture_state, &tex_samples[1], format);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    tex_read(state, &texture_state, &tex_samples[2], format);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    tex_read(state, &texture_state, &tex_samples[3], format);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -4012,7 +3650,6 @@ tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
     state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
                           tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
 }
-
 #define CLAMP(x)                      \
     do {                              \
         if ((x) & ~0xff)              \
@@ -4045,76 +3682,71 @@ tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
             b = 0xff;      \
     } while (0)
 
-static void
-dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
+__attribute__((always_inline)) static inline void
+dest_pixel(s3d_state_t *state, const int lit, const int format, const int filter)
 {
-    state->dest_rgba.r = state->r >> 7;
-    CLAMP(state->dest_rgba.r);
-
-    state->dest_rgba.g = state->g >> 7;
-    CLAMP(state->dest_rgba.g);
+    int r;
+    int g;
+    int b;
+    int a;
 
-    state->dest_rgba.b = state->b >> 7;
-    CLAMP(state->dest_rgba.b);
+    switch (lit) {
+        case S3D_LIT_GOURAUD:
+            state->dest_rgba.r = state->r >> 7;
+            CLAMP(state->dest_rgba.r);
 
-    state->dest_rgba.a = state->a >> 7;
-    CLAMP(state->dest_rgba.a);
-}
+            state->dest_rgba.g = state->g >> 7;
+            CLAMP(state->dest_rgba.g);
 
-static void
-dest_pixel_unlit_texture_triangle(s3d_state_t *state)
-{
-    tex_sample(state);
+            state->dest_rgba.b = state->b >> 7;
+            CLAMP(state->dest_rgba.b);
 
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a = state->a >> 7;
-}
+            state->dest_rgba.a = state->a >> 7;
+            CLAMP(state->dest_rgba.a);
+            break;
 
-static void
-dest_pixel_lit_texture_decal(s3d_state_t *state)
-{
-    tex_sample(state);
+        case S3D_LIT_UNLIT: /*Also lit decal*/
+            tex_sample(state, format, filter);
 
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a = state->a >> 7;
-}
+            if (state->cmd_set & CMD_SET_ABC_SRC)
+                state->dest_rgba.a = state->a >> 7;
+            break;
 
-static void
-dest_pixel_lit_texture_reflection(s3d_state_t *state)
-{
-    tex_sample(state);
+        case S3D_LIT_REFLECTION:
+            tex_sample(state, format, filter);
 
-    state->dest_rgba.r += (state->r >> 7);
-    state->dest_rgba.g += (state->g >> 7);
-    state->dest_rgba.b += (state->b >> 7);
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a += (state->a >> 7);
+            state->dest_rgba.r += (state->r >> 7);
+            state->dest_rgba.g += (state->g >> 7);
+            state->dest_rgba.b += (state->b >> 7);
+            if (state->cmd_set & CMD_SET_ABC_SRC)
+                state->dest_rgba.a += (state->a >> 7);
 
-    CLAMP_RGBA(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, state->dest_rgba.a);
-}
+            CLAMP_RGBA(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, state->dest_rgba.a);
+            break;
 
-static void
-dest_pixel_lit_texture_modulate(s3d_state_t *state)
-{
-    int r = state->r >> 7;
-    int g = state->g >> 7;
-    int b = state->b >> 7;
-    int a = state->a >> 7;
+        case S3D_LIT_MODULATE:
+            r = state->r >> 7;
+            g = state->g >> 7;
+            b = state->b >> 7;
+            a = state->a >> 7;
 
-    tex_sample(state);
+            tex_sample(state, format, filter);
 
-    CLAMP_RGBA(r, g, b, a);
+            CLAMP_RGBA(r, g, b, a);
 
-    state->dest_rgba.r = ((state->dest_rgba.r) * r) >> 8;
-    state->dest_rgba.g = ((state->dest_rgba.g) * g) >> 8;
-    state->dest_rgba.b = ((state->dest_rgba.b) * b) >> 8;
+            state->dest_rgba.r = ((state->dest_rgba.r) * r) >> 8;
+            state->dest_rgba.g = ((state->dest_rgba.g) * g) >> 8;
+            state->dest_rgba.b = ((state->dest_rgba.b) * b) >> 8;
 
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a = a;
+            if (state->cmd_set & CMD_SET_ABC_SRC)
+                state->dest_rgba.a = a;
+            break;
+    }
 }
 
-static void
-tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2)
+__attribute__((always_inline)) static inline void
+tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2,
+    const int lit, const int format, const int filter)
 {
     uint8_t *vram    = virge->svga.vram;
     int      x_dir   = s3d_tri->tlr ? 1 : -1;
@@ -4161,6 +3793,10 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
         int      xe = (state->x2 + ((1 << 20) - 1)) >> 20;
         uint32_t z  = (state->base_z > 0) ? (state->base_z << 1) : 0;
 
+        if (state->band_threads > 1 &&
+            (((uint32_t) state->y >> S3D_BAND_SHIFT) % state->band_threads) != state->band_thread)
+            goto tri_skip_line;
+
         if (x_dir < 0) {
             x--;
             xe--;
@@ -4246,9 +3882,6 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 int      update = 1;
                 uint16_t src_z  = 0;
 
-                _x = x;
-                _y = state->y;
-
                 if (use_z) {
                     src_z = Z_READ(z_addr);
                     Z_CLIP(src_z, z >> 16);
@@ -4257,7 +3890,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 if (update) {
                     uint32_t dest_col;
 
-                    dest_pixel(state);
+                    dest_pixel(state, lit, format, filter);
 
                     if (s3d_tri->cmd_set & CMD_SET_FE) {
                         int a              = state->a >> 7;
@@ -4296,7 +3929,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                             /*Not implemented yet*/
                             break;
                         case 1: /*16 bpp*/
-                            RGB15(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, dest_col);
+                            RGB15(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, x, state->y, dest_col);
                             *(uint16_t *) &vram[dest_addr] = dest_col;
                             break;
                         case 2: /*24 bpp*/
@@ -4322,7 +3955,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 state->w += s3d_tri->TdWdX;
                 dest_addr += x_offset;
                 z_addr += xz_offset;
-                virge->pixel_count++;
+                state->pixel_count++;
             }
         }
 
@@ -4344,15 +3977,55 @@ tri_skip_line:
     }
 }
 
+/*One span function per (lighting mode, texture format, filter), so the pixel
+  pipeline is inlined with no indirect calls in the inner loop.*/
+#define S3D_TRI_SPAN(name, lit, format, filter)                                                   \
+    static void                                                                                   \
+    name(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2)    \
+    {                                                                                             \
+        tri(virge, s3d_tri, state, yc, dx1, dx2, lit, format, filter);                            \
+    }
+
+#define S3D_TRI_SPANS(name, lit)                                         \
+    S3D_TRI_SPAN(name##_8888, lit, S3D_TEX_ARGB8888, 0)                  \
+    S3D_TRI_SPAN(name##_8888_filter, lit, S3D_TEX_ARGB8888, 1)           \
+    S3D_TRI_SPAN(name##_4444, lit, S3D_TEX_ARGB4444, 0)                  \
+    S3D_TRI_SPAN(name##_4444_filter, lit, S3D_TEX_ARGB4444, 1)           \
+    S3D_TRI_SPAN(name##_1555, lit, S3D_TEX_ARGB1555, 0)                  \
+    S3D_TRI_SPAN(name##_1555_filter, lit, S3D_TEX_ARGB1555, 1)
+
+S3D_TRI_SPAN(tri_gouraud, S3D_LIT_GOURAUD, S3D_TEX_ARGB1555, 0)
+S3D_TRI_SPANS(tri_unlit, S3D_LIT_UNLIT)
+S3D_TRI_SPANS(tri_reflection, S3D_LIT_REFLECTION)
+S3D_TRI_SPANS(tri_modulate, S3D_LIT_MODULATE)
+
+#define S3D_TRI_SPAN_TABLE(name)                  \
+    {                                             \
+        { name##_8888, name##_8888_filter },      \
+        { name##_4444, name##_4444_filter },      \
+        { name##_1555, name##_1555_filter }       \
+    }
+
+/*Indexed by [S3D_LIT_* - 1][S3D_TEX_*][filter]*/
+static const s3d_tri_span_t tri_spans[3][3][2] = {
+    S3D_TRI_SPAN_TABLE(tri_unlit),
+    S3D_TRI_SPAN_TABLE(tri_reflection),
+    S3D_TRI_SPAN_TABLE(tri_modulate)
+};
+
 static int tex_size[8] = { 4 * 2, 2 * 2, 2 * 2, 1 * 2, 2 / 1, 2 / 1, 1 * 2, 1 * 2 };
 
 static void
-s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
+s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri, int thread)
 {
     s3d_state_t state;
 
     uint32_t tex_base;
     int      c;
+    int      lit;
+    int      format;
+    int      filter;
+    int      tex_mode;
 
     uint64_t start_time = plat_timer_read();
     uint64_t end_time;
@@ -4376,6 +4049,10 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
     state.base_d = s3d_tri->tds;
     state.base_w = s3d_tri->tws;
 
+    state.band_thread  = thread;
+    state.band_threads = virge->render_threads;
+    state.pixel_count  = 0;
+
     tex_base = s3d_tri->tex_base;
     for (c = 9; c >= 0; c--) {
         state.texture[c] = (uint16_t *) &virge->svga.vram[tex_base];
@@ -4385,19 +4062,19 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
 
     switch ((s3d_tri->cmd_set >> 27) & 0xf) {
         case 0:
-            dest_pixel = dest_pixel_gouraud_shaded_triangle;
+            lit = S3D_LIT_GOURAUD;
             break;
         case 1:
         case 5:
             switch ((s3d_tri->cmd_set >> 15) & 0x3) {
                 case 0:
-                    dest_pixel = dest_pixel_lit_texture_reflection;
+                    lit = S3D_LIT_REFLECTION;
                     break;
                 case 1:
-                    dest_pixel = dest_pixel_lit_texture_modulate;
+                    lit = S3D_LIT_MODULATE;
                     break;
                 case 2:
-                    dest_pixel = dest_pixel_lit_texture_decal;
+                    lit = S3D_LIT_UNLIT; /*Decal*/
                     break;
                 default:
                     return;
@@ -4405,114 +4082,125 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
             break;
         case 2:
         case 6:
-            dest_pixel = dest_pixel_unlit_texture_triangle;
+            lit = S3D_LIT_UNLIT;
             break;
         default:
             return;
     }
 
-    switch (((s3d_tri->cmd_set >> 12) & 7) | ((s3d_tri->cmd_set & (1 << 29)) ? 8 : 0)) {
-        case 0:
-        case 1:
-            tex_sample = tex_sample_mipmap;
-            break;
-        case 2:
-        case 3:
-            tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
-            break;
-        case 4:
-        case 5:
-            tex_sample = tex_sample_normal;
-            break;
-        case 6:
-        case 7:
-            tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
-            break;
-        case (0 | 8):
-        case (1 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_mipmap_375;
-            else
-                tex_sample = tex_sample_persp_mipmap;
-            break;
-        case (2 | 8):
-        case (3 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
-                                                       tex_sample_persp_mipmap_375;
-            else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
-                                                       tex_sample_persp_mipmap;
-            break;
-        case (4 | 8):
-        case (5 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_normal_375;
-            else
-                tex_sample = tex_sample_persp_normal;
-            break;
-        case (6 | 8):
-        case (7 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
-                                                       tex_sample_persp_normal_375;
-            else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
-                                                       tex_sample_persp_normal;
-            break;
-    }
+    /*Bit 0 of the mode is ignored, bit 1 selects bilinear and bit 2 disables mipmapping*/
+    tex_mode         = (s3d_tri->cmd_set >> 12) & 7;
+    filter           = (tex_mode & 2) && virge->bilinear_enabled;
+    state.tex_mipmap = !(tex_mode & 4);
+    if (s3d_tri->cmd_set & (1 << 29))
+        state.tex_persp_shift = ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2)) ? 8 : 12;
+    else
+        state.tex_persp_shift = 0;
 
     switch ((s3d_tri->cmd_set >> 5) & 7) {
         case 0:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
+            format = S3D_TEX_ARGB8888;
             break;
         case 1:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
-            break;
-        case 2:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            format = S3D_TEX_ARGB4444;
             break;
         default:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            format = S3D_TEX_ARGB1555;
             break;
     }
+    state.tex_wrap = !!(s3d_tri->cmd_set & CMD_SET_TWE);
+
+    state.tri_span = (lit == S3D_LIT_GOURAUD) ? tri_gouraud : tri_spans[lit - 1][format][filter];
 
     state.y  = s3d_tri->tys;
     state.x1 = s3d_tri->txs;
     state.x2 = s3d_tri->txend01;
-    tri(virge, s3d_tri, &state, s3d_tri->ty01, s3d_tri->TdXdY02, s3d_tri->TdXdY01);
+    state.tri_span(virge, s3d_tri, &state, s3d_tri->ty01, s3d_tri->TdXdY02, s3d_tri->TdXdY01);
     state.x2 = s3d_tri->txend12;
-    tri(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
+    state.tri_span(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
+
+    virge->pixel_count += state.pixel_count;
+    if (!thread) {
+        virge->tri_count++;
+
+        end_time = plat_timer_read();
+
+        virge_time += end_time - start_time;
+    }
+}
 
-    virge->tri_count++;
+/*Oldest triangle not yet drawn by every render thread*/
+static int
+s3_virge_s3d_read_idx(virge_t *virge)
+{
+    int idx = virge->s3d_read_idx[0];
 
-    end_time = plat_timer_read();
+    for (int c = 1; c < virge->render_threads; c++) {
+        if ((int) (virge->s3d_read_idx[c] - idx) < 0)
+            idx = virge->s3d_read_idx[c];
+    }
 
-    virge_time += end_time - start_time;
+    return idx;
 }
 
+/*Every render thread walks the whole triangle ring and draws only the rows of
+  its own bands, so a ring slot is free once the slowest thread has passed it.*/
 static void
-render_thread(void *param)
+render_thread(void *param, int thread)
 {
     virge_t *virge = (virge_t *) param;
+    int      bit   = 1 << thread;
 
     while (virge->render_thread_run) {
-        thread_wait_event(virge->wake_render_thread, -1);
-        thread_reset_event(virge->wake_render_thread);
-        virge->s3d_busy = 1;
-        while (!RB_EMPTY) {
-            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK]);
-            virge->s3d_read_idx++;
-
-            if (RB_ENTRIES == RB_MASK)
-                thread_set_event(virge->not_full_event);
-        }
-        virge->s3d_busy = 0;
-        virge->subsys_stat |= INT_S3D_DONE;
-        virge->irq_pending++;
+        thread_wait_event(virge->wake_render_thread[thread], -1);
+        thread_reset_event(virge->wake_render_thread[thread]);
+        do {
+            virge->s3d_busy |= bit;
+            while (RB_THREAD_PENDING(thread)) {
+                s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx[thread] & RB_MASK], thread);
+                virge->s3d_read_idx[thread]++;
+
+                if (RB_ENTRIES == RB_MASK)
+                    thread_set_event(virge->not_full_event);
+            }
+            /*The last thread to go idle with the ring drained raises the interrupt*/
+            if (!(virge->s3d_busy &= ~bit) && RB_EMPTY) {
+                virge->subsys_stat |= INT_S3D_DONE;
+                virge->irq_pending++;
+            }
+            /*Recheck after dropping the busy bit, as queue_triangle() only wakes idle threads*/
+        } while (RB_THREAD_PENDING(thread) && virge->render_thread_run);
     }
 }
 
+static void
+render_thread_1(void *param)
+{
+    render_thread(param, 0);
+}
+static void
+render_thread_2(void *param)
+{
+    render_thread(param, 1);
+}
+static void
+render_thread_3(void *param)
+{
+    render_thread(param, 2);
+}
+static void
+render_thread_4(void *param)
+{
+    render_thread(param, 3);
+}
+
+static void (*const render_thread_funcs[S3D_MAX_RENDER_THREADS])(void *param) = {
+    render_thread_1,
+    render_thread_2,
+    render_thread_3,
+    render_thread_4
+};
+
 static void
 queue_triangle(virge_t *virge)
 {
@@ -4523,8 +4211,10 @@ queue_triangle(virge_t *virge)
     }
     virge->s3d_buffer[virge->s3d_write_idx & RB_MASK] = virge->s3d_tri;
     virge->s3d_write_idx++;
-    if (!virge->s3d_busy)
-        thread_set_event(virge->wake_render_thread); /*Wake up render thread if moving from idle*/
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (!(virge->s3d_busy & (1 << c)))
+            thread_set_event(virge->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+    }
 }
 
 static void
@@ -5316,7 +5006,8 @@ s3_virge_reset(void *priv)
         dev->fifo_read_idx    = 0;
         dev->s3d_busy         = 0;
         dev->s3d_write_idx    = 0;
-        dev->s3d_read_idx     = 0;
+        for (int c = 0; c < S3D_MAX_RENDER_THREADS; c++)
+            dev->s3d_read_idx[c] = 0;
         reset_state->pci_slot = dev->pci_slot;
 
         *dev = *reset_state;
@@ -5338,6 +5029,7 @@ s3_virge_init(const device_t *info)
 
     virge->bilinear_enabled  = device_get_config_int("bilinear");
     virge->dithering_enabled = device_get_config_int("dithering");
+    virge->render_threads    = device_get_config_int("render_threads");
     if (virge->type >= S3_VIRGE_GX2)
         virge->memory_size = 4;
     else if (virge->type == S3_VIRGE_325 && local & 0x100)
@@ -5575,11 +5267,13 @@ s3_virge_init(const device_t *info)
 
     virge->svga.force_old_addr = 1;
 
-    virge->render_thread_run  = 1;
-    virge->wake_render_thread = thread_create_event();
-    virge->wake_main_thread   = thread_create_event();
-    virge->not_full_event     = thread_create_event();
-    virge->render_thread      = thread_create(render_thread, virge);
+    virge->render_thread_run = 1;
+    virge->wake_main_thread  = thread_create_event();
+    virge->not_full_event    = thread_create_event();
+    for (int c = 0; c < virge->render_threads; c++) {
+        virge->wake_render_thread[c] = thread_create_event();
+        virge->render_thread[c]      = thread_create(render_thread_funcs[c], virge);
+    }
 
     virge->fifo_thread_run     = 1;
     virge->wake_fifo_thread    = thread_create_event();
@@ -5601,11 +5295,13 @@ s3_virge_close(void *priv)
     virge_t *virge = (virge_t *) priv;
 
     virge->render_thread_run = 0;
-    thread_set_event(virge->wake_render_thread);
-    thread_wait(virge->render_thread);
+    for (int c = 0; c < virge->render_threads; c++) {
+        thread_set_event(virge->wake_render_thread[c]);
+        thread_wait(virge->render_thread[c]);
+        thread_destroy_event(virge->wake_render_thread[c]);
+    }
     thread_destroy_event(virge->not_full_event);
     thread_destroy_event(virge->wake_main_thread);
-    thread_destroy_event(virge->wake_render_thread);
 
     virge->fifo_thread_run = 0;
     thread_set_event(virge->wake_fifo_thread);
@@ -5705,6 +5401,23 @@ static const device_config_t s3_virge_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5798,6 +5511,23 @@ static const device_config_t s3_virge_pci_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5835,6 +5565,23 @@ static const device_config_t s3_virge_onboard_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5919,6 +5666,23 @@ static const device_config_t s3_virge_vx_pci_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -6002,6 +5766,23 @@ static const device_config_t s3_virge_dx_pci_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -6054,6 +5835,23 @@ static const device_config_t s3_virge_gx2_pci_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -6138,6 +5936,23 @@ static const device_config_t s3_virge_gx2_agp_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -6192,6 +6007,23 @@ static const device_config_t s3_trio3d2x_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 2,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "1", .value = 1 },
+            { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
+            { .description = "4", .value = 4 },
+            { .description = ""              }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
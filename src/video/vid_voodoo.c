@@ -38,10 +38,12 @@
 #include <86box/vid_svga.h>
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_blitter.h>
+#include <86box/vid_voodoo_capture.h>
 #include <86box/vid_voodoo_display.h>
 #include <86box/vid_voodoo_dither.h>
 #include <86box/vid_voodoo_fb.h>
 #include <86box/vid_voodoo_fifo.h>
+#include <86box/vid_voodoo_metrics.h>
 #include <86box/vid_voodoo_reg.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
@@ -86,6 +88,16 @@ voodoo_init_relax_settings(voodoo_t *voodoo)
 {
     const char *relax_env = getenv("VOODOO_LFB_RELAX");
     const char *wait_env  = getenv("VOODOO_WAIT_STATS");
+    const char *jit_env   = getenv("VOODOO_JIT_CACHE");
+    const char *simd_env  = getenv("VOODOO_SIMD_SPAN");
+    const char *span4_env = getenv("VOODOO_JIT_SPAN4");
+    const char *lfb_env   = getenv("VOODOO_LFB_HAZARDS");
+    const char *scan_env  = getenv("VOODOO_SCANOUT_THREAD");
+    const char *blt_env   = getenv("VOODOO_BLT_FAST");
+    const char *ffill_env = getenv("VOODOO_FASTFILL_BANDS");
+    const char *metrics_env = getenv("VOODOO_METRICS");
+    const char *verify_env  = getenv("VOODOO_JIT_VERIFY");
+    const char *batch_env   = getenv("VOODOO_FIFO_BATCH");
     int         relax_enabled = 1;
 
     /* Default to front-sync relax mode; wait stats are opt-in. */
@@ -98,6 +110,46 @@ voodoo_init_relax_settings(voodoo_t *voodoo)
     voodoo->wait_stats_explicit = (wait_env && *wait_env);
     voodoo->wait_stats_enabled = voodoo->wait_stats_explicit && !voodoo_env_is_disabled(wait_env);
 
+    /* Per-frame metrics are on unless explicitly disabled. They need the FIFO
+       stall and LFB sync counters, which are otherwise only kept for wait stats;
+       the summary lines at close still follow VOODOO_WAIT_STATS alone. */
+    voodoo->metrics_enabled = !(metrics_env && voodoo_env_is_disabled(metrics_env));
+    if (voodoo->metrics_enabled)
+        voodoo->wait_stats_enabled = 1;
+
+    /* Persistent JIT block cache is on unless explicitly disabled. */
+    voodoo->jit_cache_enabled = !(jit_env && voodoo_env_is_disabled(jit_env));
+
+    /* Checking JIT spans against the interpreter is opt-in. A number checks
+       every nth span, anything else that isn't "off" checks them all. */
+    voodoo->jit_verify = 0;
+    if (verify_env && *verify_env && !voodoo_env_is_disabled(verify_env)) {
+        voodoo->jit_verify = atoi(verify_env);
+        if (voodoo->jit_verify < 1)
+            voodoo->jit_verify = 1;
+    }
+
+    /* Vectorised interpreter spans are on unless explicitly disabled. */
+    voodoo->simd_span_enabled = !(simd_env && voodoo_env_is_disabled(simd_env));
+
+    /* Four-pixel JIT span loop for simple states is on unless explicitly disabled. */
+    voodoo->jit_span4_enabled = !(span4_env && voodoo_env_is_disabled(span4_env));
+
+    /* LFB writes wait per band rather than draining the render threads, unless explicitly disabled. */
+    voodoo->lfb_hazard_enabled = !(lfb_env && voodoo_env_is_disabled(lfb_env));
+
+    /* Banshee/Voodoo3 2D row kernels are on unless explicitly disabled. */
+    voodoo->banshee_blt_fast_enabled = !(blt_env && voodoo_env_is_disabled(blt_env));
+
+    /* fastfillCMD runs on the render threads, per band, unless explicitly disabled. */
+    voodoo->fastfill_bands_enabled = !(ffill_env && voodoo_env_is_disabled(ffill_env));
+
+    /* FIFO thread spins before parking and writers signal it only when parked, unless explicitly disabled. */
+    voodoo->fifo_batch_enabled = !(batch_env && voodoo_env_is_disabled(batch_env));
+
+    /* Scan-out conversion on a worker thread is opt-in. */
+    voodoo->scanout_thread_enabled = scan_env && *scan_env && !voodoo_env_is_disabled(scan_env);
+
     voodoo->lfb_relax_enabled = relax_enabled;
     voodoo->lfb_relax_full = relax_enabled && (strcmp(relax_env, "full") == 0);
     voodoo->lfb_relax_ignore_cmdfifo = relax_enabled && (!strcmp(relax_env, "nocmdfifo") || !strcmp(relax_env, "2") || !strcmp(relax_env, "3") || !strcmp(relax_env, "4") || !strcmp(relax_env, "frontsync"));
@@ -438,9 +490,7 @@ voodoo_readl(uint32_t addr, void *priv)
                     int busy         = (written - voodoo->cmd_read) ||
                                (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) ||
                                voodoo->voodoo_busy ||
-                               RENDER_VOODOO_BUSY(voodoo, 0) ||
-                               (voodoo->render_threads >= 2 && RENDER_VOODOO_BUSY(voodoo, 1)) ||
-                               (voodoo->render_threads == 4 && (RENDER_VOODOO_BUSY(voodoo, 2) || RENDER_VOODOO_BUSY(voodoo, 3)));
+                               voodoo_render_threads_busy(voodoo);
 
                     if (SLI_ENABLED && voodoo->type != VOODOO_2) {
                         voodoo_t *voodoo_other  = (voodoo == voodoo->set->voodoos[0]) ? voodoo->set->voodoos[1] : voodoo->set->voodoos[0];
@@ -453,9 +503,7 @@ voodoo_readl(uint32_t addr, void *priv)
                         if ((other_written - voodoo_other->cmd_read) ||
                             (voodoo_other->cmdfifo_depth_rd != voodoo_other->cmdfifo_depth_wr) ||
                             voodoo_other->voodoo_busy ||
-                            RENDER_VOODOO_BUSY(voodoo_other, 0) ||
-                            (voodoo_other->render_threads >= 2 && RENDER_VOODOO_BUSY(voodoo_other, 1)) ||
-                            (voodoo_other->render_threads == 4 && (RENDER_VOODOO_BUSY(voodoo_other, 2) || RENDER_VOODOO_BUSY(voodoo_other, 3))))
+                            voodoo_render_threads_busy(voodoo_other))
                             busy = 1;
                         if (!voodoo_other->voodoo_busy)
                             voodoo_wake_fifo_thread(voodoo_other);
@@ -622,6 +670,9 @@ voodoo_writew(uint32_t addr, uint16_t val, void *priv)
     voodoo->wr_count++;
     addr &= 0xffffff;
 
+    if (voodoo->capture)
+        voodoo_capture_write(voodoo->capture, VOODOO_CAPTURE_WRITEW, addr, val);
+
     cycles -= voodoo->write_time;
 
     if ((addr & 0xc00000) == 0x400000) /*Framebuffer*/
@@ -637,6 +688,9 @@ voodoo_writel(uint32_t addr, uint32_t val, void *priv)
 
     addr &= 0xffffff;
 
+    if (voodoo->capture)
+        voodoo_capture_write(voodoo->capture, VOODOO_CAPTURE_WRITEL, addr, val);
+
     if (addr == voodoo->last_write_addr + 4)
         cycles -= voodoo->burst_time;
     else
@@ -1076,6 +1130,9 @@ voodoo_pci_write(int func, int addr, UNUSED(int len), uint8_t val, void *priv)
     if (func)
         return;
 
+    if (voodoo->capture)
+        voodoo_capture_write(voodoo->capture, VOODOO_CAPTURE_PCI, addr, val);
+
 #if 0
     voodoo_log("Voodoo PCI write %04X %02X PC=%08x\n", addr, val, cpu_state.pc);
 #endif
@@ -1165,7 +1222,6 @@ voodoo_card_init(void)
     voodoo->fb_size           = device_get_config_int("framebuffer_memory");
     voodoo->fb_mask           = (voodoo->fb_size << 20) - 1;
     voodoo->render_threads    = device_get_config_int("render_threads");
-    voodoo->odd_even_mask     = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
@@ -1201,16 +1257,7 @@ voodoo_card_init(void)
     voodoo->tex_mem_w[0] = (uint16_t *) voodoo->tex_mem[0];
     voodoo->tex_mem_w[1] = (uint16_t *) voodoo->tex_mem[1];
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        voodoo->texture_cache[0][c].data     = calloc(1, (256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-        voodoo->texture_cache[0][c].base     = -1; /*invalid*/
-        voodoo->texture_cache[0][c].refcount = 0;
-        if (voodoo->dual_tmus) {
-            voodoo->texture_cache[1][c].data     = calloc(1, (256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-            voodoo->texture_cache[1][c].base     = -1; /*invalid*/
-            voodoo->texture_cache[1][c].refcount = 0;
-        }
-    }
+    voodoo_texture_cache_init(voodoo);
 
     timer_add(&voodoo->timer, voodoo_callback, voodoo, 1);
 
@@ -1231,20 +1278,16 @@ voodoo_card_init(void)
     voodoo->render_not_full_event[1] = thread_create_event();
     voodoo->render_not_full_event[2] = thread_create_event();
     voodoo->render_not_full_event[3] = thread_create_event();
+    voodoo->render_slot_free_event   = thread_create_event();
     voodoo->fifo_thread_run          = 1;
     voodoo->fifo_thread              = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread_run[0]     = 1;
-    voodoo->render_thread[0]         = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 1;
-        voodoo->render_thread[1]     = thread_create(voodoo_render_thread_2, voodoo);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 1;
-        voodoo->render_thread[2]     = thread_create(voodoo_render_thread_3, voodoo);
-        voodoo->render_thread_run[3] = 1;
-        voodoo->render_thread[3]     = thread_create(voodoo_render_thread_4, voodoo);
+    voodoo_render_init_bands(voodoo);
+    for (c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 1;
+        voodoo->render_thread[c]     = thread_create(voodoo_render_thread_funcs[c], voodoo);
     }
+    voodoo_scanout_init(voodoo);
+    voodoo_metrics_init(voodoo);
     voodoo->swap_mutex = thread_create_mutex();
     timer_add(&voodoo->wake_timer, voodoo_wake_timer, (void *) voodoo, 0);
 
@@ -1324,7 +1367,6 @@ voodoo_2d3d_card_init(int type)
     voodoo->dithersub_enabled = device_get_config_int("dithersub");
     voodoo->scrfilter         = device_get_config_int("dacfilter");
     voodoo->render_threads    = device_get_config_int("render_threads");
-    voodoo->odd_even_mask     = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
     voodoo->use_recompiler = device_get_config_int("recompiler");
 #endif
@@ -1334,16 +1376,7 @@ voodoo_2d3d_card_init(int type)
     /*generate filter lookup tables*/
     voodoo_generate_filter_v2(voodoo);
 
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        voodoo->texture_cache[0][c].data     = calloc(1, (256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-        voodoo->texture_cache[0][c].base     = -1; /*invalid*/
-        voodoo->texture_cache[0][c].refcount = 0;
-        if (voodoo->dual_tmus) {
-            voodoo->texture_cache[1][c].data     = calloc(1, (256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4);
-            voodoo->texture_cache[1][c].base     = -1; /*invalid*/
-            voodoo->texture_cache[1][c].refcount = 0;
-        }
-    }
+    voodoo_texture_cache_init(voodoo);
 
     timer_add(&voodoo->timer, voodoo_callback, voodoo, 1);
 
@@ -1363,21 +1396,16 @@ voodoo_2d3d_card_init(int type)
     voodoo->render_not_full_event[1] = thread_create_event();
     voodoo->render_not_full_event[2] = thread_create_event();
     voodoo->render_not_full_event[3] = thread_create_event();
+    voodoo->render_slot_free_event   = thread_create_event();
     voodoo->fifo_thread_run          = 1;
     voodoo->fifo_thread              = thread_create(voodoo_fifo_thread, voodoo);
-    voodoo->render_thread_run[0]     = 1;
-    voodoo->render_thread[0]         = thread_create(voodoo_render_thread_1, voodoo);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 1;
-        voodoo->render_thread[1]     = thread_create(voodoo_render_thread_2, voodoo);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 1;
-        voodoo->render_thread[2]     = thread_create(voodoo_render_thread_3, voodoo);
-        voodoo->render_thread_run[3] = 1;
-        voodoo->render_thread[3]     = thread_create(voodoo_render_thread_4, voodoo);
+    voodoo_render_init_bands(voodoo);
+    for (c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 1;
+        voodoo->render_thread[c]     = thread_create(voodoo_render_thread_funcs[c], voodoo);
     }
     voodoo->swap_mutex = thread_create_mutex();
+    voodoo_metrics_init(voodoo);
     timer_add(&voodoo->wake_timer, voodoo_wake_timer, (void *) voodoo, 0);
 
     for (c = 0; c < 0x100; c++) {
@@ -1451,6 +1479,7 @@ voodoo_init(UNUSED(const device_t *info))
     voodoo_set_t *voodoo_set = calloc(1, sizeof(voodoo_set_t));
     uint32_t      tmuConfig  = 1;
     int           type;
+    const char   *capture_env;
 
     type = device_get_config_int("type");
 
@@ -1498,39 +1527,43 @@ voodoo_init(UNUSED(const device_t *info))
 
     mem_mapping_add(&voodoo_set->snoop_mapping, 0, 0, NULL, voodoo_snoop_readw, voodoo_snoop_readl, NULL, voodoo_snoop_writew, voodoo_snoop_writel, NULL, MEM_MAPPING_EXTERNAL, voodoo_set);
 
+    /*Capture is from power-on, so the replay needs nothing but the stream.
+      SLI pairs split the screen and aren't supported.*/
+    capture_env = getenv("VOODOO_CAPTURE");
+    if (capture_env && *capture_env) {
+        if (voodoo_set->nr_cards == 1)
+            voodoo_set->voodoos[0]->capture = voodoo_capture_open(voodoo_set->voodoos[0], capture_env);
+        else
+            pclog("Voodoo capture: not supported with SLI\n");
+    }
+
     return voodoo_set;
 }
 
 void
 voodoo_card_close(voodoo_t *voodoo)
 {
+    if (voodoo->capture)
+        voodoo_capture_close(voodoo->capture);
+    voodoo_metrics_close(voodoo);
+    voodoo_scanout_close(voodoo);
     voodoo->fifo_thread_run = 0;
     thread_set_event(voodoo->wake_fifo_thread);
     thread_wait(voodoo->fifo_thread);
-    voodoo->render_thread_run[0] = 0;
-    thread_set_event(voodoo->wake_render_thread[0]);
-    thread_wait(voodoo->render_thread[0]);
-    if (voodoo->render_threads >= 2) {
-        voodoo->render_thread_run[1] = 0;
-        thread_set_event(voodoo->wake_render_thread[1]);
-        thread_wait(voodoo->render_thread[1]);
-    }
-    if (voodoo->render_threads == 4) {
-        voodoo->render_thread_run[2] = 0;
-        thread_set_event(voodoo->wake_render_thread[2]);
-        thread_wait(voodoo->render_thread[2]);
-        voodoo->render_thread_run[3] = 0;
-        thread_set_event(voodoo->wake_render_thread[3]);
-        thread_wait(voodoo->render_thread[3]);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
     }
     thread_destroy_event(voodoo->fifo_not_full_event);
     thread_destroy_event(voodoo->fifo_empty_event);
     thread_destroy_event(voodoo->wake_main_thread);
     thread_destroy_event(voodoo->wake_fifo_thread);
-    thread_destroy_event(voodoo->wake_render_thread[0]);
-    thread_destroy_event(voodoo->wake_render_thread[1]);
-    thread_destroy_event(voodoo->render_not_full_event[0]);
-    thread_destroy_event(voodoo->render_not_full_event[1]);
+    for (int c = 0; c < 4; c++) {
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+        thread_destroy_event(voodoo->render_not_full_event[c]);
+    }
+    thread_destroy_event(voodoo->render_slot_free_event);
 
     if (voodoo->wait_stats_enabled && voodoo->wait_stats_explicit) {
         pclog("Voodoo wait stats (type=%d): fifo_full waits=%" PRIu64 " ticks=%" PRIu64 " spins=%" PRIu64
@@ -1572,13 +1605,43 @@ voodoo_card_close(voodoo_t *voodoo)
               voodoo->readl_fb_relaxed_buf[2],
               voodoo->readl_reg_count,
               voodoo->readl_tex_count);
+        pclog("Voodoo render bands (type=%d): threads=%d band_rows=%d moves=%" PRIu64 " lfb_hazards=%d lfb_waits=%" PRIu64 " lfb_drains=%" PRIu64 "\n",
+              voodoo->type, voodoo->render_threads, 1 << VOODOO_BAND_SHIFT, voodoo->render_band_moves,
+              voodoo->lfb_hazard_enabled, voodoo->lfb_hazard_waits, voodoo->lfb_hazard_drains);
+        pclog("Voodoo texture cache (type=%d): entries=%d hits=%" PRIu64 " misses=%" PRIu64 " stalls=%" PRIu64 " lod_redecodes=%" PRIu64 "\n",
+              voodoo->type, voodoo->texture_cache_size, voodoo->texture_cache_hits, voodoo->texture_cache_misses, voodoo->texture_cache_stalls,
+              voodoo->texture_lod_redecodes);
+        pclog("Voodoo interpreter (type=%d): simd_spans=%d simd_pixels=%" PRIu64 "\n",
+              voodoo->type, voodoo->simd_span_enabled,
+              voodoo->simd_span_pixels[0] + voodoo->simd_span_pixels[1] + voodoo->simd_span_pixels[2] + voodoo->simd_span_pixels[3]);
+        pclog("Voodoo JIT spans (type=%d): span4=%d span4_blocks=%d\n",
+              voodoo->type, voodoo->jit_span4_enabled, voodoo->jit_span4_blocks);
+        pclog("Voodoo scan-out (type=%d): thread=%d lines=%" PRIu64 " waits=%" PRIu64 "\n",
+              voodoo->type, voodoo->scanout_thread_enabled, voodoo->scanout_lines, voodoo->scanout_waits);
+        pclog("Voodoo 2D (type=%d): fast_blt=%d fast_rows=%" PRIu64 "\n",
+              voodoo->type, voodoo->banshee_blt_fast_enabled, voodoo->banshee_blt_fast_rows);
+        pclog("Voodoo fastfill (type=%d): bands=%d queued=%" PRIu64 "\n",
+              voodoo->type, voodoo->fastfill_bands_enabled, voodoo->fastfill_queued);
+        pclog("Voodoo CMDFIFO (type=%d): block_reads=%" PRIu64 " block_fallbacks=%" PRIu64 "\n",
+              voodoo->type, voodoo->cmdfifo_block_reads, voodoo->cmdfifo_block_fallbacks);
+        pclog("Voodoo FIFO wakeups (type=%d): batch=%d signals=%" PRIu64 " wakeups=%" PRIu64 " spin_hits=%" PRIu64 "\n",
+              voodoo->type, voodoo->fifo_batch_enabled, voodoo->fifo_wake_signals, voodoo->fifo_wakeups, voodoo->fifo_spin_hits);
     }
 
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->dual_tmus)
-            free(voodoo->texture_cache[1][c].data);
-        free(voodoo->texture_cache[0][c].data);
+    if (voodoo->jit_verify) {
+        uint64_t spans      = 0;
+        uint64_t mismatches = 0;
+
+        for (int c = 0; c < 4; c++) {
+            spans += voodoo->jit_verify_spans[c];
+            mismatches += voodoo->jit_verify_mismatches[c];
+            free(voodoo->jit_verify_buf[c]);
+        }
+        pclog("Voodoo JIT verify (type=%d): every %d span(s), checked=%" PRIu64 " mismatched=%" PRIu64 "\n",
+              voodoo->type, voodoo->jit_verify, spans, mismatches);
     }
+
+    voodoo_texture_cache_close(voodoo);
 #ifndef NO_CODEGEN
     voodoo_codegen_close(voodoo);
 #endif
@@ -1697,6 +1760,7 @@ static const device_config_t voodoo_config[] = {
         .selection      = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
             { .description = "4", .value = 4 },
             { .description = ""              }
         },
@@ -46,6 +46,7 @@
 #include <86box/vid_voodoo_display.h>
 #include <86box/vid_voodoo_fb.h>
 #include <86box/vid_voodoo_fifo.h>
+#include <86box/vid_voodoo_metrics.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
 #include <86box/vid_voodoo_texture.h>
@@ -3060,6 +3061,7 @@ banshee_vsync_callback(svga_t *svga)
         voodoo->frame_count++;
     } else
         thread_release_mutex(voodoo->swap_mutex);
+    voodoo_metrics_frame(voodoo);
 
     voodoo->overlay.src_y = 0;
     banshee->desktop_addr = banshee->vidDesktopStartAddr;
@@ -3813,6 +3815,7 @@ static const device_config_t voodoo_sgram_config[] = {
         .selection      = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
             { .description = "4", .value = 4 },
             { .description = ""              }
         },
@@ -3947,6 +3950,7 @@ static const device_config_t voodoo_banshee_pci_config[] = {
         .selection      = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
             { .description = "4", .value = 4 },
             { .description = ""              }
         },
@@ -4024,6 +4028,7 @@ static const device_config_t voodoo_nomem_config[] = {
         .selection      = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
             { .description = "4", .value = 4 },
             { .description = ""              }
         },
@@ -4163,6 +4168,7 @@ static const device_config_t voodoo_3_3500_agp_config[] = {
         .selection      = {
             { .description = "1", .value = 1 },
             { .description = "2", .value = 2 },
+            { .description = "3", .value = 3 },
             { .description = "4", .value = 4 },
             { .description = ""              }
         },
@@ -44,6 +44,13 @@
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_banshee_blitter.h>
 #include <86box/vid_voodoo_render.h>
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define VOODOO_BLT_SSE2
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define VOODOO_BLT_NEON
+#endif
 
 #define COMMAND_CMD_MASK                         (0xf)
 #define COMMAND_CMD_NOP                          (0 << 0)
@@ -428,6 +435,251 @@ end_command(voodoo_t *voodoo)
     }
 }
 
+/*Row kernels for the common 2D operations.
+
+  do_screen_to_screen_line() and banshee_do_rectfill() go through PLOT()/MIX()
+  for every pixel, which checks colorkeys, picks the pattern and recomputes the
+  (possibly tiled) address each time. For the operations that Windows draws
+  most -- SRCCOPY, PATCOPY, BLACKNESS and WHITENESS at 8, 16 and 32 bpp with
+  no colorkeys and no transparent mono pattern -- the result of a row does not
+  depend on the destination, so it can be written a run of bytes at a time.
+  A run ends at a 128 byte tile boundary on a tiled surface.*/
+enum {
+    BLT_ROW_COPY, /*dst = src*/
+    BLT_ROW_FILL, /*dst = constant*/
+    BLT_ROW_PAT   /*dst = pattern row*/
+};
+
+/*Bytes per pixel if the destination format has row kernels, else 0*/
+static int
+banshee_blt_fast_bpp(const voodoo_t *voodoo)
+{
+    switch (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK) {
+        case DST_FORMAT_COL_8_BPP:
+            return 1;
+        case DST_FORMAT_COL_16_BPP:
+            return 2;
+        case DST_FORMAT_COL_32_BPP:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/*Select the row kernel for the current command, or -1 for the general path.
+  *fill is set for BLT_ROW_FILL.*/
+static int
+banshee_blt_fast_kind(const voodoo_t *voodoo, int have_src, uint32_t *fill)
+{
+    if (!voodoo->banshee_blt_fast_enabled || !banshee_blt_fast_bpp(voodoo))
+        return -1;
+    if (voodoo->banshee_blt.commandExtra & (CMDEXTRA_SRC_COLORKEY | CMDEXTRA_DST_COLORKEY))
+        return -1;
+    if ((voodoo->banshee_blt.command & (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO)) == (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO))
+        return -1;
+
+    switch (voodoo->banshee_blt.rops[0]) {
+        case 0x00: /*BLACKNESS*/
+            *fill = 0;
+            return BLT_ROW_FILL;
+        case 0xff: /*WHITENESS*/
+            *fill = 0xffffffff;
+            return BLT_ROW_FILL;
+        case 0xcc: /*SRCCOPY*/
+            if (have_src)
+                return BLT_ROW_COPY;
+            *fill = voodoo->banshee_blt.colorFore;
+            return BLT_ROW_FILL;
+        case 0xf0: /*PATCOPY*/
+            return BLT_ROW_PAT;
+        default:
+            return -1;
+    }
+}
+
+/*Byte offset of byte x of a row within a surface*/
+static inline uint32_t
+banshee_blt_tile_offset(uint32_t x, int tiled)
+{
+    return tiled ? ((x & 127) + ((x >> 7) * 128 * 32)) : x;
+}
+
+static void
+banshee_blt_fill_run(uint8_t *p, uint32_t val, int bpp, int len)
+{
+    int x = 0;
+
+    if (bpp == 1) {
+        memset(p, val, len);
+        return;
+    }
+    if (bpp == 2)
+        val = (val & 0xffff) | (val << 16);
+
+#if defined VOODOO_BLT_SSE2
+    const __m128i v = _mm_set1_epi32(val);
+
+    for (; (x + 16) <= len; x += 16)
+        _mm_storeu_si128((__m128i *) &p[x], v);
+#elif defined VOODOO_BLT_NEON
+    const uint32x4_t v = vdupq_n_u32(val);
+
+    for (; (x + 16) <= len; x += 16)
+        vst1q_u8(&p[x], vreinterpretq_u8_u32(v));
+#endif
+    for (; (x + 4) <= len; x += 4)
+        memcpy(&p[x], &val, 4);
+    if (x < len)
+        memcpy(&p[x], &val, 2);
+}
+
+/*Write one clipped row with a row kernel. Returns 0, having written nothing,
+  if the row has to go through the general path instead: a destination that
+  wraps round fb_mask, a source that leaves VRAM, or a copy whose source and
+  destination overlap such that the pixel order of the general path matters.
+
+  src_p/src_addr/src_x/src_tiled are as for do_screen_to_screen_line(); src_p
+  is NULL for rectfill. pat_x is the pattern x of the first pixel in drawing
+  order.*/
+static int
+banshee_blt_fast_row(voodoo_t *voodoo, int kind, uint32_t fill, const uint8_t *src_p, uintptr_t src_addr, int src_x, int src_tiled,
+                     int backwards, int dst_y, int pat_x, int pat_y, uint8_t pattern_mask)
+{
+    const clip_t *clip      = &voodoo->banshee_blt.clip[(voodoo->banshee_blt.command & COMMAND_CLIP_SEL) ? 1 : 0];
+    const int     bpp       = banshee_blt_fast_bpp(voodoo);
+    const int     dst_tiled = voodoo->banshee_blt.dstBaseAddr_tiled;
+    int           dst_lo    = voodoo->banshee_blt.dstX;
+    int           dst_hi;
+    int           src_lo    = src_x;
+    uint32_t      dst_start;
+    uint32_t      dst_end;
+    uint32_t      pat_row[8];
+
+    /*Pixels in ascending x order, then clipped*/
+    if (backwards) {
+        dst_lo -= voodoo->banshee_blt.dstSizeX - 1;
+        src_lo -= voodoo->banshee_blt.dstSizeX - 1;
+    }
+    dst_hi = dst_lo + voodoo->banshee_blt.dstSizeX;
+    if (dst_lo < clip->x_min) {
+        src_lo += clip->x_min - dst_lo;
+        dst_lo = clip->x_min;
+    }
+    if (dst_hi > clip->x_max)
+        dst_hi = clip->x_max;
+    if (dst_lo >= dst_hi)
+        return 1;
+    if (dst_lo < 0 || (src_p && src_lo < 0))
+        return 0;
+
+    dst_start = get_addr(voodoo, dst_lo * bpp, dst_y, 0, 0);
+    dst_end   = get_addr(voodoo, (dst_hi - 1) * bpp, dst_y, 0, 0) + bpp;
+    if (dst_start > dst_end || (dst_end - dst_start) != (banshee_blt_tile_offset((dst_hi - 1) * bpp, dst_tiled) + bpp - banshee_blt_tile_offset(dst_lo * bpp, dst_tiled)) || (dst_end - 1) > voodoo->fb_mask)
+        return 0;
+
+    if (src_p && (((uintptr_t) src_p) - src_addr) == (uintptr_t) voodoo->vram) {
+        /*VRAM source: the general path skips pixels past vram_max, and reads
+          what earlier pixels of the row wrote if the two overlap*/
+        uintptr_t src_start = src_addr + banshee_blt_tile_offset(src_lo * bpp, src_tiled);
+        uintptr_t src_last  = src_addr + banshee_blt_tile_offset((src_lo + dst_hi - dst_lo - 1) * bpp, src_tiled);
+
+        if (src_last > voodoo->vram_max)
+            return 0;
+        if (kind == BLT_ROW_COPY && src_start < dst_end && dst_start < (src_last + bpp)) {
+            uint32_t dst_row = get_addr(voodoo, 0, dst_y, 0, 0);
+            intptr_t delta;
+
+            if (src_tiled != dst_tiled)
+                return 0;
+            if (src_tiled) {
+                /*Rows of a tiled surface only share bytes if they sit at the
+                  same line of a tile; otherwise only the same row overlaps*/
+                if ((src_addr | dst_row) & 127)
+                    return 0;
+                if (((src_addr ^ dst_row) >> 7) & 31)
+                    delta = 0;
+                else if (src_addr != dst_row)
+                    return 0;
+                else
+                    delta = (intptr_t) (src_lo - dst_lo) * bpp;
+            } else
+                delta = (intptr_t) src_start - (intptr_t) dst_start;
+
+            /*Safe if no pixel reads bytes an earlier pixel wrote*/
+            if (backwards ? (delta > 0) : (delta < 0))
+                return 0;
+        }
+    }
+
+    if (kind == BLT_ROW_PAT) {
+        /*Pattern x follows dst_x, so one row of eight covers either direction*/
+        int pat_x0 = pat_x - voodoo->banshee_blt.dstX;
+
+        for (int x = 0; x < 8; x++) {
+            int px = pat_x0 + x;
+
+            if (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO)
+                pat_row[x] = (pattern_mask & (1 << (7 - (px & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack;
+            else if (bpp == 1)
+                pat_row[x] = voodoo->banshee_blt.colorPattern8[(px & 7) + (pat_y & 7) * 8];
+            else if (bpp == 2)
+                pat_row[x] = voodoo->banshee_blt.colorPattern16[(px & 7) + (pat_y & 7) * 8];
+            else
+                pat_row[x] = voodoo->banshee_blt.colorPattern[(px & 7) + (pat_y & 7) * 8];
+        }
+    }
+
+    /*Runs in drawing order, each within one tile of both surfaces. With no
+      overlap hazard in that order, moving a run at a time gives the same
+      result as the general path.*/
+    for (int done = 0; done < (dst_hi - dst_lo);) {
+        int      x0 = dst_lo;
+        int      x1 = dst_hi;
+        uint32_t dst_off;
+        uint8_t *d;
+        int      len;
+
+        if (backwards) {
+            x1 = dst_hi - done;
+            if (dst_tiled)
+                x0 = MAX(x0, (((x1 - 1) * bpp) & ~127) / bpp);
+            if (src_p && src_tiled)
+                x0 = MAX(x0, dst_lo + ((((src_lo + x1 - 1 - dst_lo) * bpp) & ~127) / bpp) - src_lo);
+        } else {
+            x0 = dst_lo + done;
+            if (dst_tiled)
+                x1 = MIN(x1, (((x0 * bpp) | 127) + 1) / bpp);
+            if (src_p && src_tiled)
+                x1 = MIN(x1, dst_lo + (((((src_lo + x0 - dst_lo) * bpp) | 127) + 1) / bpp) - src_lo);
+        }
+        dst_off = get_addr(voodoo, x0 * bpp, dst_y, 0, 0);
+        d       = &voodoo->vram[dst_off];
+        len     = (x1 - x0) * bpp;
+
+        switch (kind) {
+            case BLT_ROW_COPY:
+                memmove(d, &src_p[banshee_blt_tile_offset((src_lo + x0 - dst_lo) * bpp, src_tiled)], len);
+                break;
+            case BLT_ROW_FILL:
+                banshee_blt_fill_run(d, fill, bpp, len);
+                break;
+            case BLT_ROW_PAT:
+                for (int x = x0; x < x1; x++)
+                    memcpy(&d[(x - x0) * bpp], &pat_row[x & 7], bpp);
+                break;
+
+            default:
+                break;
+        }
+
+        for (uint32_t page = dst_off >> 12; page <= ((dst_off + len - 1) >> 12); page++)
+            voodoo->changedvram[page] = changeframecount;
+        done += x1 - x0;
+    }
+
+    return 1;
+}
+
 static void
 banshee_do_rectfill(voodoo_t *voodoo)
 {
@@ -437,6 +689,8 @@ banshee_do_rectfill(voodoo_t *voodoo)
     int            pat_y             = (voodoo->banshee_blt.commandExtra & CMDEXTRA_FORCE_PAT_ROW0) ? 0 : (voodoo->banshee_blt.patoff_y + voodoo->banshee_blt.dstY);
     int            use_pattern_trans = (voodoo->banshee_blt.command & (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO)) == (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO);
     uint8_t        rop               = voodoo->banshee_blt.command >> 24;
+    uint32_t       fill              = 0;
+    int            fast_kind         = banshee_blt_fast_kind(voodoo, 0, &fill);
 
 #if 0
     bansheeblt_log("banshee_do_rectfill: size=%i,%i  dst=%i,%i\n", voodoo->banshee_blt.dstSizeX, voodoo->banshee_blt.dstSizeY, voodoo->banshee_blt.dstX, voodoo->banshee_blt.dstY);
@@ -450,14 +704,19 @@ banshee_do_rectfill(voodoo_t *voodoo)
             int     pat_x        = voodoo->banshee_blt.patoff_x + voodoo->banshee_blt.dstX;
             uint8_t pattern_mask = pattern_mono[pat_y & 7];
 
-            for (voodoo->banshee_blt.cur_x = 0; voodoo->banshee_blt.cur_x < voodoo->banshee_blt.dstSizeX; voodoo->banshee_blt.cur_x++) {
-                int pattern_trans = use_pattern_trans ? (pattern_mask & (1 << (7 - (pat_x & 7)))) : 1;
+            if (fast_kind >= 0 && banshee_blt_fast_row(voodoo, fast_kind, fill, NULL, 0, 0, 0, voodoo->banshee_blt.command & COMMAND_DX, dst_y, pat_x, pat_y, pattern_mask)) {
+                voodoo->banshee_blt.cur_x = voodoo->banshee_blt.dstSizeX;
+                voodoo->banshee_blt_fast_rows++;
+            } else {
+                for (voodoo->banshee_blt.cur_x = 0; voodoo->banshee_blt.cur_x < voodoo->banshee_blt.dstSizeX; voodoo->banshee_blt.cur_x++) {
+                    int pattern_trans = use_pattern_trans ? (pattern_mask & (1 << (7 - (pat_x & 7)))) : 1;
 
-                if (dst_x >= clip->x_min && dst_x < clip->x_max && pattern_trans)
-                    PLOT(voodoo, dst_x, dst_y, pat_x, pat_y, pattern_mask, rop, voodoo->banshee_blt.colorFore, COLORKEY_32);
+                    if (dst_x >= clip->x_min && dst_x < clip->x_max && pattern_trans)
+                        PLOT(voodoo, dst_x, dst_y, pat_x, pat_y, pattern_mask, rop, voodoo->banshee_blt.colorFore, COLORKEY_32);
 
-                dst_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
-                pat_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+                    dst_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+                    pat_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+                }
             }
         }
         dst_y += (voodoo->banshee_blt.command & COMMAND_DY) ? -1 : 1;
@@ -571,6 +830,8 @@ do_screen_to_screen_line(voodoo_t *voodoo, uint8_t *src_p, const uintptr_t src_a
     const uint8_t *pattern_mono      = (uint8_t *) voodoo->banshee_blt.colorPattern;
     int            use_pattern_trans = (voodoo->banshee_blt.command & (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO)) == (COMMAND_PATTERN_MONO | COMMAND_TRANS_MONO);
     uint8_t        rop               = voodoo->banshee_blt.command >> 24;
+    uint32_t       fill              = 0;
+    int            fast_kind         = banshee_blt_fast_kind(voodoo, 1, &fill);
     int            src_colorkey;
 
     switch (voodoo->banshee_blt.srcFormat & SRC_FORMAT_COL_MASK) {
@@ -594,87 +855,92 @@ do_screen_to_screen_line(voodoo_t *voodoo, uint8_t *src_p, const uintptr_t src_a
             int     pat_x        = voodoo->banshee_blt.patoff_x + voodoo->banshee_blt.dstX;
             uint8_t pattern_mask = pattern_mono[pat_y & 7];
 
-            for (voodoo->banshee_blt.cur_x = 0; voodoo->banshee_blt.cur_x < voodoo->banshee_blt.dstSizeX; voodoo->banshee_blt.cur_x++) {
-                int pattern_trans = use_pattern_trans ? (pattern_mask & (1 << (7 - (pat_x & 7)))) : 1;
-                int src_x_real    = (src_x * voodoo->banshee_blt.src_bpp) >> 3;
-
-                if (src_tiled)
-                    src_x_real = (src_x_real & 127) + ((src_x_real >> 7) * 128 * 32);
-
-                const uintptr_t ptr_base     = ((uintptr_t) src_p) - src_addr;
-                const int       do_something = ((ptr_base) != (uintptr_t) voodoo->vram) || ((src_addr + (uintptr_t) src_x_real) <= voodoo->vram_max);
-
-                if (do_something && dst_x >= clip->x_min && dst_x < clip->x_max && pattern_trans) {
-                    switch (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK) {
-                        case DST_FORMAT_COL_8_BPP:
-                            {
-                                uint32_t dst_addr = get_addr(voodoo, dst_x, dst_y, 0, 0); //(voodoo->banshee_blt.dstBaseAddr + dst_x + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
-                                uint32_t src      = src_p[src_x_real];
-                                uint32_t dest     = voodoo->vram[dst_addr];
-                                uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern8[(pat_x & 7) + (pat_y & 7) * 8];
-
-                                if (dst_addr > voodoo->fb_mask)
-                                     break;
-
-                                voodoo->vram[dst_addr]              = MIX(voodoo, dest, src, pattern, COLORKEY_8, COLORKEY_8);
-                                voodoo->changedvram[dst_addr >> 12] = changeframecount;
-                                break;
-                            }
-                        case DST_FORMAT_COL_16_BPP:
-                            {
-                                uint32_t dst_addr = get_addr(voodoo, dst_x * 2, dst_y, 0, 0); // dst_addr = (voodoo->banshee_blt.dstBaseAddr + dst_x*2 + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
-                                uint32_t src      = *(uint16_t *) &src_p[src_x_real];
-                                uint32_t dest     = *(uint16_t *) &voodoo->vram[dst_addr];
-                                uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern16[(pat_x & 7) + (pat_y & 7) * 8];
-
-                                if (dst_addr > voodoo->fb_mask)
-                                     break;
-
-                                *(uint16_t *) &voodoo->vram[dst_addr] = MIX(voodoo, dest, src, pattern, COLORKEY_16, COLORKEY_16);
-                                voodoo->changedvram[dst_addr >> 12]   = changeframecount;
-                                break;
-                            }
-                        case DST_FORMAT_COL_24_BPP:
-                            {
-                                uint32_t dst_addr = get_addr(voodoo, dst_x * 3, dst_y, 0, 0); // dst_addr = (voodoo->banshee_blt.dstBaseAddr + dst_x*3 + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
-                                uint32_t src      = *(uint32_t *) &src_p[src_x_real];
-                                uint32_t dest     = *(uint32_t *) &voodoo->vram[dst_addr];
-                                uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern24[(pat_x & 7) + (pat_y & 7) * 8];
-
-                                if (dst_addr > voodoo->fb_mask)
-                                     break;
+            if (fast_kind >= 0 && banshee_blt_fast_row(voodoo, fast_kind, fill, src_p, src_addr, src_x, src_tiled, use_x_dir && (voodoo->banshee_blt.command & COMMAND_DX), dst_y, pat_x, pat_y, pattern_mask)) {
+                voodoo->banshee_blt.cur_x = voodoo->banshee_blt.dstSizeX;
+                voodoo->banshee_blt_fast_rows++;
+            } else {
+                for (voodoo->banshee_blt.cur_x = 0; voodoo->banshee_blt.cur_x < voodoo->banshee_blt.dstSizeX; voodoo->banshee_blt.cur_x++) {
+                    int pattern_trans = use_pattern_trans ? (pattern_mask & (1 << (7 - (pat_x & 7)))) : 1;
+                    int src_x_real    = (src_x * voodoo->banshee_blt.src_bpp) >> 3;
+
+                    if (src_tiled)
+                        src_x_real = (src_x_real & 127) + ((src_x_real >> 7) * 128 * 32);
+
+                    const uintptr_t ptr_base     = ((uintptr_t) src_p) - src_addr;
+                    const int       do_something = ((ptr_base) != (uintptr_t) voodoo->vram) || ((src_addr + (uintptr_t) src_x_real) <= voodoo->vram_max);
+
+                    if (do_something && dst_x >= clip->x_min && dst_x < clip->x_max && pattern_trans) {
+                        switch (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK) {
+                            case DST_FORMAT_COL_8_BPP:
+                                {
+                                    uint32_t dst_addr = get_addr(voodoo, dst_x, dst_y, 0, 0); //(voodoo->banshee_blt.dstBaseAddr + dst_x + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
+                                    uint32_t src      = src_p[src_x_real];
+                                    uint32_t dest     = voodoo->vram[dst_addr];
+                                    uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern8[(pat_x & 7) + (pat_y & 7) * 8];
+
+                                    if (dst_addr > voodoo->fb_mask)
+                                         break;
+
+                                    voodoo->vram[dst_addr]              = MIX(voodoo, dest, src, pattern, COLORKEY_8, COLORKEY_8);
+                                    voodoo->changedvram[dst_addr >> 12] = changeframecount;
+                                    break;
+                                }
+                            case DST_FORMAT_COL_16_BPP:
+                                {
+                                    uint32_t dst_addr = get_addr(voodoo, dst_x * 2, dst_y, 0, 0); // dst_addr = (voodoo->banshee_blt.dstBaseAddr + dst_x*2 + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
+                                    uint32_t src      = *(uint16_t *) &src_p[src_x_real];
+                                    uint32_t dest     = *(uint16_t *) &voodoo->vram[dst_addr];
+                                    uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern16[(pat_x & 7) + (pat_y & 7) * 8];
+
+                                    if (dst_addr > voodoo->fb_mask)
+                                         break;
+
+                                    *(uint16_t *) &voodoo->vram[dst_addr] = MIX(voodoo, dest, src, pattern, COLORKEY_16, COLORKEY_16);
+                                    voodoo->changedvram[dst_addr >> 12]   = changeframecount;
+                                    break;
+                                }
+                            case DST_FORMAT_COL_24_BPP:
+                                {
+                                    uint32_t dst_addr = get_addr(voodoo, dst_x * 3, dst_y, 0, 0); // dst_addr = (voodoo->banshee_blt.dstBaseAddr + dst_x*3 + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
+                                    uint32_t src      = *(uint32_t *) &src_p[src_x_real];
+                                    uint32_t dest     = *(uint32_t *) &voodoo->vram[dst_addr];
+                                    uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern24[(pat_x & 7) + (pat_y & 7) * 8];
+
+                                    if (dst_addr > voodoo->fb_mask)
+                                         break;
+
+                                    *(uint32_t *) &voodoo->vram[dst_addr] = (MIX(voodoo, dest, src, pattern, COLORKEY_32, COLORKEY_32) & 0xffffff) | (dest & 0xff000000);
+                                    voodoo->changedvram[dst_addr >> 12]   = changeframecount;
+                                    break;
+                                }
+                            case DST_FORMAT_COL_32_BPP:
+                                {
+                                    uint32_t dst_addr = get_addr(voodoo, dst_x * 4, dst_y, 0, 0); // dst_addr = (voodoo->banshee_blt.dstBaseAddr + dst_x*4 + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
+                                    uint32_t src      = *(uint32_t *) &src_p[src_x_real];
+                                    uint32_t dest     = *(uint32_t *) &voodoo->vram[dst_addr];
+                                    uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern[(pat_x & 7) + (pat_y & 7) * 8];
+
+                                    if (dst_addr > voodoo->fb_mask)
+                                         break;
+
+                                    *(uint32_t *) &voodoo->vram[dst_addr] = MIX(voodoo, dest, src, pattern, COLORKEY_32, COLORKEY_32);
+                                    voodoo->changedvram[dst_addr >> 12]   = changeframecount;
+                                    break;
+                                }
 
-                                *(uint32_t *) &voodoo->vram[dst_addr] = (MIX(voodoo, dest, src, pattern, COLORKEY_32, COLORKEY_32) & 0xffffff) | (dest & 0xff000000);
-                                voodoo->changedvram[dst_addr >> 12]   = changeframecount;
+                            default:
                                 break;
-                            }
-                        case DST_FORMAT_COL_32_BPP:
-                            {
-                                uint32_t dst_addr = get_addr(voodoo, dst_x * 4, dst_y, 0, 0); // dst_addr = (voodoo->banshee_blt.dstBaseAddr + dst_x*4 + dst_y*voodoo->banshee_blt.dst_stride) & voodoo->fb_mask;
-                                uint32_t src      = *(uint32_t *) &src_p[src_x_real];
-                                uint32_t dest     = *(uint32_t *) &voodoo->vram[dst_addr];
-                                uint32_t pattern  = (voodoo->banshee_blt.command & COMMAND_PATTERN_MONO) ? ((pattern_mask & (1 << (7 - (pat_x & 7)))) ? voodoo->banshee_blt.colorFore : voodoo->banshee_blt.colorBack) : voodoo->banshee_blt.colorPattern[(pat_x & 7) + (pat_y & 7) * 8];
-
-                                if (dst_addr > voodoo->fb_mask)
-                                     break;
-
-                                *(uint32_t *) &voodoo->vram[dst_addr] = MIX(voodoo, dest, src, pattern, COLORKEY_32, COLORKEY_32);
-                                voodoo->changedvram[dst_addr >> 12]   = changeframecount;
-                                break;
-                            }
-
-                        default:
-                            break;
+                        }
+                    }
+                    if (use_x_dir) {
+                        src_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+                        dst_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+                        pat_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
+                    } else {
+                        src_x++;
+                        dst_x++;
+                        pat_x++;
                     }
-                }
-                if (use_x_dir) {
-                    src_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
-                    dst_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
-                    pat_x += (voodoo->banshee_blt.command & COMMAND_DX) ? -1 : 1;
-                } else {
-                    src_x++;
-                    dst_x++;
-                    pat_x++;
                 }
             }
         }
@@ -38,6 +38,13 @@
 #include <86box/vid_voodoo_dither.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define VOODOO_BLT_SSE2
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define VOODOO_BLT_NEON
+#endif
 
 enum {
     BLIT_COMMAND_SCREEN_TO_SCREEN = 0,
@@ -456,56 +463,95 @@ skip_pixel:
     }
 }
 
-void
-voodoo_fastfill(voodoo_t *voodoo, voodoo_params_t *params)
+/*Fill n 16-bit pixels with val*/
+static void
+voodoo_fastfill_span(uint16_t *p, uint16_t val, int n)
 {
-    int y;
-    int low_y;
-    int high_y;
+    int x = 0;
 
-    if (params->fbzMode & (1 << 17)) {
-        int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? (voodoo->y_origin_swap + 1) : voodoo->v_disp;
+#if defined VOODOO_BLT_SSE2
+    const __m128i v = _mm_set1_epi16(val);
+
+    for (; (x + 8) <= n; x += 8)
+        _mm_storeu_si128((__m128i *) &p[x], v);
+#elif defined VOODOO_BLT_NEON
+    const uint16x8_t v = vdupq_n_u16(val);
 
-        high_y = y_origin - params->clipLowY;
-        low_y  = y_origin - params->clipHighY;
+    for (; (x + 8) <= n; x += 8)
+        vst1q_u16(&p[x], v);
+#endif
+    for (; x < n; x++)
+        p[x] = val;
+}
+
+/*Fill pixels left..right-1 of a row. A tiled row is 64 pixel (128 byte)
+  pieces, one per tile, 32 rows apart.*/
+static void
+voodoo_fastfill_row(uint16_t *buf, int tiled, int left, int right, uint16_t val)
+{
+    if (!tiled) {
+        voodoo_fastfill_span(&buf[left], val, right - left);
+        return;
+    }
+
+    for (int x = left; x < right;) {
+        int end = MIN(right, (x | 63) + 1);
+
+        voodoo_fastfill_span(&buf[(x & 63) + ((x >> 6) * 128 * 32 / 2)], val, end - x);
+        x = end;
+    }
+}
+
+/*Rows fastfillCMD clears, low_y..high_y-1, in framebuffer order*/
+void
+voodoo_fastfill_rows(voodoo_params_t *params, int y_origin, int *low_y, int *high_y)
+{
+    if (params->fbzMode & (1 << 17)) {
+        *high_y = y_origin - params->clipLowY;
+        *low_y  = y_origin - params->clipHighY;
     } else {
-        low_y  = params->clipLowY;
-        high_y = params->clipHighY;
+        *low_y  = params->clipLowY;
+        *high_y = params->clipHighY;
     }
+}
 
-    if (params->fbzMode & FBZ_RGB_WMASK) {
-        int      r;
-        int      g;
-        int      b;
-        uint16_t col;
+/*Clear the rows of the colour and/or aux buffer. owner is the render thread
+  doing the clear, which only touches rows in its own bands, or -1 for all of
+  them.*/
+static void
+voodoo_fastfill_thread(voodoo_t *voodoo, voodoo_params_t *params, int y_origin, int owner)
+{
+    int      sli  = SLI_ENABLED;
+    int      step = sli ? 2 : 1;
+    int      low_y;
+    int      high_y;
+    int      r;
+    int      g;
+    int      b;
+    uint16_t col;
+
+    voodoo_fastfill_rows(params, y_origin, &low_y, &high_y);
+
+    r   = ((params->color1 >> 16) >> 3) & 0x1f;
+    g   = ((params->color1 >> 8) >> 2) & 0x3f;
+    b   = (params->color1 >> 3) & 0x1f;
+    col = b | (g << 5) | (r << 11);
 
-        r   = ((params->color1 >> 16) >> 3) & 0x1f;
-        g   = ((params->color1 >> 8) >> 2) & 0x3f;
-        b   = (params->color1 >> 3) & 0x1f;
-        col = b | (g << 5) | (r << 11);
+    if (params->fbzMode & FBZ_RGB_WMASK) {
+        for (int y = low_y; y < high_y; y += step) {
+            int row = sli ? (y >> 1) : y;
 
-        if (SLI_ENABLED) {
-            for (y = low_y; y < high_y; y += 2) {
-                uint16_t *cbuf = (uint16_t *) &voodoo->fb_mem[(params->draw_offset + (y >> 1) * voodoo->row_width) & voodoo->fb_mask];
+            if (owner >= 0 && voodoo->render_band_owner[(row >> VOODOO_BAND_SHIFT) & VOODOO_BAND_MASK] != owner)
+                continue;
 
-                for (int x = params->clipLeft; x < params->clipRight; x++)
-                    cbuf[x] = col;
-            }
-        } else {
-            for (y = low_y; y < high_y; y++) {
-                if (voodoo->col_tiled) {
-                    uint16_t *cbuf = (uint16_t *) &voodoo->fb_mem[(params->draw_offset + (y >> 5) * voodoo->row_width + (y & 31) * 128) & voodoo->fb_mask];
-
-                    for (int x = params->clipLeft; x < params->clipRight; x++) {
-                        int x2   = (x & 63) | ((x >> 6) * 128 * 32 / 2);
-                        cbuf[x2] = col;
-                    }
-                } else {
-                    uint16_t *cbuf = (uint16_t *) &voodoo->fb_mem[(params->draw_offset + y * voodoo->row_width) & voodoo->fb_mask];
+            if (sli)
+                voodoo_fastfill_row((uint16_t *) &voodoo->fb_mem[(params->draw_offset + row * params->row_width) & voodoo->fb_mask], 0, params->clipLeft, params->clipRight, col);
+            else {
+                if (params->col_tiled)
+                    voodoo_fastfill_row((uint16_t *) &voodoo->fb_mem[(params->draw_offset + (y >> 5) * params->row_width + (y & 31) * 128) & voodoo->fb_mask], 1, params->clipLeft, params->clipRight, col);
+                else
+                    voodoo_fastfill_row((uint16_t *) &voodoo->fb_mem[(params->draw_offset + y * params->row_width) & voodoo->fb_mask], 0, params->clipLeft, params->clipRight, col);
 
-                    for (int x = params->clipLeft; x < params->clipRight; x++)
-                        cbuf[x] = col;
-                }
                 /* Mark line dirty for single buffer mode */
                 if (params->draw_offset == params->front_offset && y < 2048)
                     voodoo->dirty_line[y] = 1;
@@ -513,29 +559,34 @@ voodoo_fastfill(voodoo_t *voodoo, voodoo_params_t *params)
         }
     }
     if (params->fbzMode & FBZ_DEPTH_WMASK) {
-        if (SLI_ENABLED) {
-            for (y = low_y; y < high_y; y += 2) {
-                uint16_t *abuf = (uint16_t *) &voodoo->fb_mem[(params->aux_offset + (y >> 1) * voodoo->row_width) & voodoo->fb_mask];
-
-                for (int x = params->clipLeft; x < params->clipRight; x++)
-                    abuf[x] = params->zaColor & 0xffff;
-            }
-        } else {
-            for (y = low_y; y < high_y; y++) {
-                if (voodoo->aux_tiled) {
-                    uint16_t *abuf = (uint16_t *) &voodoo->fb_mem[(params->aux_offset + (y >> 5) * voodoo->aux_row_width + (y & 31) * 128) & voodoo->fb_mask];
-
-                    for (int x = params->clipLeft; x < params->clipRight; x++) {
-                        int x2   = (x & 63) | ((x >> 6) * 128 * 32 / 2);
-                        abuf[x2] = params->zaColor & 0xffff;
-                    }
-                } else {
-                    uint16_t *abuf = (uint16_t *) &voodoo->fb_mem[(params->aux_offset + y * voodoo->aux_row_width) & voodoo->fb_mask];
-
-                    for (int x = params->clipLeft; x < params->clipRight; x++)
-                        abuf[x] = params->zaColor & 0xffff;
-                }
-            }
+        for (int y = low_y; y < high_y; y += step) {
+            int row = sli ? (y >> 1) : y;
+
+            if (owner >= 0 && voodoo->render_band_owner[(row >> VOODOO_BAND_SHIFT) & VOODOO_BAND_MASK] != owner)
+                continue;
+
+            if (sli)
+                voodoo_fastfill_row((uint16_t *) &voodoo->fb_mem[(params->aux_offset + row * params->row_width) & voodoo->fb_mask], 0, params->clipLeft, params->clipRight, params->zaColor & 0xffff);
+            else if (params->aux_tiled)
+                voodoo_fastfill_row((uint16_t *) &voodoo->fb_mem[(params->aux_offset + (y >> 5) * params->aux_row_width + (y & 31) * 128) & voodoo->fb_mask], 1, params->clipLeft, params->clipRight, params->zaColor & 0xffff);
+            else
+                voodoo_fastfill_row((uint16_t *) &voodoo->fb_mem[(params->aux_offset + y * params->aux_row_width) & voodoo->fb_mask], 0, params->clipLeft, params->clipRight, params->zaColor & 0xffff);
         }
     }
 }
+
+void
+voodoo_fastfill(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? (voodoo->y_origin_swap + 1) : voodoo->v_disp;
+
+    voodoo_fastfill_thread(voodoo, params, y_origin, -1);
+}
+
+/*A fastfill queued with voodoo_queue_fastfill(), run by render thread owner
+  for its bands*/
+void
+voodoo_fastfill_band(voodoo_t *voodoo, voodoo_params_t *params, int owner)
+{
+    voodoo_fastfill_thread(voodoo, params, params->y_origin + 1, owner);
+}
@@ -0,0 +1,101 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Voodoo command stream capture.
+ *
+ *          With VOODOO_CAPTURE set to a file name, every write the guest
+ *          makes to a Voodoo Graphics / Voodoo 2 card from power-on is
+ *          recorded: PCI config, registers, LFB, texture memory and the
+ *          CMDFIFO words. That is everything that reaches
+ *          voodoo_queue_command() or the CMDFIFO, in guest order, plus the
+ *          init registers written directly. voodoo_replay plays a capture
+ *          back headlessly.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_capture.h>
+
+voodoo_capture_t *
+voodoo_capture_open(voodoo_t *voodoo, const char *fn)
+{
+    voodoo_capture_header_t header;
+    voodoo_capture_t       *capture;
+    FILE                   *fp;
+
+    fp = plat_fopen(fn, "wb");
+    if (!fp) {
+        pclog("Voodoo capture: can't open %s\n", fn);
+        return NULL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VOODOO_CAPTURE_MAGIC, sizeof(header.magic));
+    header.version           = VOODOO_CAPTURE_VERSION;
+    header.type              = voodoo->type;
+    header.fb_size           = voodoo->fb_size;
+    header.texture_size      = voodoo->texture_size;
+    header.bilinear_enabled  = voodoo->bilinear_enabled;
+    header.dithersub_enabled = voodoo->dithersub_enabled;
+    header.scrfilter         = voodoo->scrfilter;
+    header.render_threads    = voodoo->render_threads;
+    header.recompiler        = voodoo->use_recompiler;
+    if (fwrite(&header, 1, sizeof(header), fp) != sizeof(header)) {
+        pclog("Voodoo capture: can't write %s\n", fn);
+        fclose(fp);
+        return NULL;
+    }
+
+    capture     = calloc(1, sizeof(voodoo_capture_t));
+    capture->fp = fp;
+    pclog("Voodoo capture: recording to %s\n", fn);
+
+    return capture;
+}
+
+void
+voodoo_capture_flush(voodoo_capture_t *capture)
+{
+    if (capture->pos && capture->fp) {
+        if (fwrite(capture->buf, sizeof(voodoo_capture_record_t), capture->pos, capture->fp) != (size_t) capture->pos) {
+            /*Out of space - a truncated capture still replays up to here*/
+            pclog("Voodoo capture: write failed, stopping after %" PRIu64 " records\n", capture->records);
+            fclose(capture->fp);
+            capture->fp = NULL;
+        } else
+            capture->records += capture->pos;
+    }
+    capture->pos = 0;
+}
+
+void
+voodoo_capture_close(voodoo_capture_t *capture)
+{
+    voodoo_capture_flush(capture);
+    if (capture->fp) {
+        fclose(capture->fp);
+        pclog("Voodoo capture: %" PRIu64 " records\n", capture->records);
+    }
+    free(capture);
+}
@@ -35,8 +35,16 @@
 #include <86box/vid_svga.h>
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_display.h>
+#include <86box/vid_voodoo_metrics.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define VOODOO_DISP_SSE2
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define VOODOO_DISP_NEON
+#endif
 
 #ifdef ENABLE_VOODOODISP_LOG
 int voodoodisp_do_log = ENABLE_VOODOODISP_LOG;
@@ -146,6 +154,14 @@ voodoo_calc_clutData(voodoo_t *voodoo)
 #endif
         voodoo->video_16to32[c] = (voodoo->clutData256[r].r << 16) | (voodoo->clutData256[g].g << 8) | voodoo->clutData256[b].b;
     }
+
+    for (c = 0; c < 64; c++) {
+        if (c < 32) {
+            voodoo->video_565_b[c] = voodoo->clutData256[c << 3].b;
+            voodoo->video_565_r[c] = voodoo->clutData256[c << 3].r;
+        }
+        voodoo->video_565_g[c] = voodoo->clutData256[c << 2].g;
+    }
 }
 
 #define FILTDIV 256
@@ -172,6 +188,11 @@ voodoo_generate_filter_v1(voodoo_t *voodoo)
     fcg = FILTCAPG * 6;
     fcb = FILTCAPB * 5;
 
+    voodoo->filter_caps[0] = FILTCAP;
+    voodoo->filter_caps[1] = FILTCAPG;
+    voodoo->filter_caps[2] = FILTCAPB;
+    voodoo->filter_type    = 1;
+
     for (uint16_t g = 0; g < FILTDIV; g++) // pixel 1
     {
         for (uint16_t h = 0; h < FILTDIV; h++) // pixel 2
@@ -269,6 +290,11 @@ voodoo_generate_filter_v2(voodoo_t *voodoo)
     if (fcb > 32)
         fcb = 32;
 
+    voodoo->filter_caps[0] = FILTCAP;
+    voodoo->filter_caps[1] = FILTCAPG;
+    voodoo->filter_caps[2] = FILTCAPB;
+    voodoo->filter_type    = 2;
+
     for (uint16_t g = 0; g < 256; g++) // pixel 1 - our target pixel we want to bleed into
     {
         for (uint16_t h = 0; h < 256; h++) // pixel 2 - our main pixel
@@ -504,6 +530,374 @@ voodoo_filterline_v2(voodoo_t *voodoo, uint8_t *fil, int column, uint16_t *src,
     fil3[(column - 1) * 3 + 2] = voodoo->thefilter[fil[(column - 1) * 3 + 2]][((src[column] >> 11) & 31) << 3];
 }
 
+/*The screen filters as arithmetic rather than thefilter*[g][h] lookups.
+  These give exactly what voodoo_generate_filter_v1()/_v2() put in the
+  tables for the same thresholds.*/
+static inline int
+voodoo_filter_v1_px(int g, int h, int cap)
+{
+    int d = h - g;
+
+    if (d > cap)
+        d = cap;
+    if (d < -cap)
+        d = -cap;
+
+    return g + (d >> 1);
+}
+
+static inline int
+voodoo_filter_v2_px(int g, int h, int cap)
+{
+    int d;
+
+    /*Only lightens, and only towards a close enough neighbour*/
+    if (h <= g || (h - g) > cap)
+        return g;
+
+    d = ((g + h * 4) / 5) - ((g * 4 + h) / 5);
+    if (d > cap)
+        d = cap;
+    if (d > 32)
+        d = 32;
+
+    return MIN(g + d, 255);
+}
+
+/*dst[x] = filter(a[x], h[x]) for x < n*/
+static void
+voodoo_filter_pass(int type, uint8_t *dst, const uint8_t *a, const uint8_t *h, int n, int cap)
+{
+    int x = 0;
+
+#if defined VOODOO_DISP_SSE2
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i vcap  = _mm_set1_epi16(cap);
+    const __m128i vncap = _mm_set1_epi16(-cap);
+    const __m128i vlim  = _mm_set1_epi16(MIN(cap, 32));
+    const __m128i v255  = _mm_set1_epi16(255);
+    const __m128i div5  = _mm_set1_epi16(13108); /*(x * 13108) >> 16 == x / 5 for x <= 1275*/
+
+    for (; (x + 8) <= n; x += 8) {
+        __m128i g = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &a[x]), zero);
+        __m128i o = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &h[x]), zero);
+        __m128i d = _mm_sub_epi16(o, g);
+        __m128i r;
+
+        if (type == 1) {
+            d = _mm_min_epi16(_mm_max_epi16(d, vncap), vcap);
+            r = _mm_add_epi16(g, _mm_srai_epi16(d, 1));
+        } else {
+            __m128i mask = _mm_andnot_si128(_mm_cmpgt_epi16(d, vcap), _mm_cmpgt_epi16(o, g));
+            __m128i hi   = _mm_mulhi_epu16(_mm_add_epi16(g, _mm_slli_epi16(o, 2)), div5);
+            __m128i lo   = _mm_mulhi_epu16(_mm_add_epi16(_mm_slli_epi16(g, 2), o), div5);
+
+            r = _mm_min_epi16(_mm_add_epi16(g, _mm_min_epi16(_mm_sub_epi16(hi, lo), vlim)), v255);
+            r = _mm_or_si128(_mm_and_si128(mask, r), _mm_andnot_si128(mask, g));
+        }
+        _mm_storel_epi64((__m128i *) &dst[x], _mm_packus_epi16(r, r));
+    }
+#elif defined VOODOO_DISP_NEON
+    const int16x8_t vcap  = vdupq_n_s16(cap);
+    const int16x8_t vncap = vdupq_n_s16(-cap);
+    const int16x8_t vlim  = vdupq_n_s16(MIN(cap, 32));
+    const int16x8_t v255  = vdupq_n_s16(255);
+
+    for (; (x + 8) <= n; x += 8) {
+        int16x8_t g = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&a[x])));
+        int16x8_t o = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&h[x])));
+        int16x8_t d = vsubq_s16(o, g);
+        int16x8_t r;
+
+        if (type == 1) {
+            d = vminq_s16(vmaxq_s16(d, vncap), vcap);
+            r = vsraq_n_s16(g, d, 1);
+        } else {
+            uint16x8_t mask = vbicq_u16(vcgtq_s16(o, g), vcgtq_s16(d, vcap));
+            /*(2 * x * 6554) >> 16 == x / 5 for x <= 1275*/
+            int16x8_t hi = vqdmulhq_n_s16(vaddq_s16(g, vshlq_n_s16(o, 2)), 6554);
+            int16x8_t lo = vqdmulhq_n_s16(vaddq_s16(vshlq_n_s16(g, 2), o), 6554);
+
+            r = vminq_s16(vaddq_s16(g, vminq_s16(vsubq_s16(hi, lo), vlim)), v255);
+            r = vbslq_s16(mask, r, g);
+        }
+        vst1_u8(&dst[x], vqmovun_s16(r));
+    }
+#endif
+    if (type == 1) {
+        for (; x < n; x++)
+            dst[x] = voodoo_filter_v1_px(a[x], h[x], cap);
+    } else {
+        for (; x < n; x++)
+            dst[x] = voodoo_filter_v2_px(a[x], h[x], cap);
+    }
+}
+
+/*One channel of an RGB565 line, scaled to 8 bits as the filters see it*/
+static void
+voodoo_filter_expand(uint8_t *dst, const uint16_t *src, int n, int channel)
+{
+    static const int shift[3] = { 0, 5, 11 };
+    const int        bits     = (channel == 1) ? 6 : 5;
+    const int        mask     = (1 << bits) - 1;
+    int              x        = 0;
+
+#if defined VOODOO_DISP_SSE2
+    const __m128i vmask = _mm_set1_epi16(mask);
+    const __m128i vsh   = _mm_cvtsi32_si128(shift[channel]);
+    const __m128i vup   = _mm_cvtsi32_si128(8 - bits);
+
+    for (; (x + 8) <= n; x += 8) {
+        __m128i v = _mm_and_si128(_mm_srl_epi16(_mm_loadu_si128((const __m128i *) &src[x]), vsh), vmask);
+
+        v = _mm_sll_epi16(v, vup);
+        _mm_storel_epi64((__m128i *) &dst[x], _mm_packus_epi16(v, v));
+    }
+#elif defined VOODOO_DISP_NEON
+    const uint16x8_t vmask = vdupq_n_u16(mask);
+    const int16x8_t  vsh   = vdupq_n_s16(-shift[channel]);
+    const int16x8_t  vup   = vdupq_n_s16(8 - bits);
+
+    for (; (x + 8) <= n; x += 8) {
+        uint16x8_t v = vandq_u16(vshlq_u16(vld1q_u16(&src[x]), vsh), vmask);
+
+        vst1_u8(&dst[x], vmovn_u16(vshlq_u16(v, vup)));
+    }
+#endif
+    for (; x < n; x++)
+        dst[x] = ((src[x] >> shift[channel]) & mask) << (8 - bits);
+}
+
+/*voodoo_filterline_v1() with planar channels. Each of its passes only
+  reads the other scratch line, so every pass vectorises as is.*/
+static void
+voodoo_filterline_v1_fast(voodoo_t *voodoo, uint8_t out[3][4096], int column, const uint16_t *src, int line)
+{
+    uint8_t s[4096];
+    uint8_t a[4096];
+    uint8_t b[4096];
+
+    for (int c = 0; c < 3; c++) {
+        /*filter_caps is red, green, blue; channels here are blue, green, red*/
+        int            cap = voodoo->filter_caps[2 - c];
+        const uint8_t *t   = s;
+
+        voodoo_filter_expand(s, src, column, c);
+
+        /*purpleline[][], held in out[c] until the last pass*/
+        if (line & 1) {
+            for (int x = 0; x < column; x++)
+                out[c][x] = voodoo->purpleline[s[x]][c];
+            t = out[c];
+        }
+
+        a[0] = s[0];
+        voodoo_filter_pass(1, &a[1], &t[1], &t[0], column - 1, cap);
+        b[0] = t[0];
+        voodoo_filter_pass(1, &b[1], &a[1], &a[0], column - 1, cap);
+        voodoo_filter_pass(1, &a[1], &b[1], &b[0], column - 1, cap);
+        voodoo_filter_pass(1, out[c], &a[0], &a[1], column - 1, cap);
+        out[c][column - 1] = b[column - 1];
+    }
+}
+
+/*voodoo_filterline_v2() with planar channels. Its single loop writes
+  ahead into fil3 and behind into fil; unrolled, every element goes
+  through the same four steps against the unfiltered source:
+    A[i] = f(S[i], S[i - 3])
+    B[i] = f(A[i], S[i - 2])
+    C[i] = f(B[i], S[i - 1])
+    out[i] = f(C[i], S[i + 1])
+  with the ends taken from S where the loop never reaches, and the last
+  four pixels from the tail handling after it. Like the original, this
+  reads src[column].*/
+static void
+voodoo_filterline_v2_fast(voodoo_t *voodoo, uint8_t out[3][4096], int column, const uint16_t *src)
+{
+    uint8_t s[4096 + 1];
+    uint8_t a[4096];
+    uint8_t b[4096];
+
+    for (int c = 0; c < 3; c++) {
+        int cap = voodoo->filter_caps[2 - c];
+        int end;
+
+        voodoo_filter_expand(s, src, column + 1, c);
+        end = s[column];
+
+        memcpy(a, s, 4);
+        voodoo_filter_pass(2, &a[4], &s[4], &s[1], column - 4, cap);
+        memcpy(b, s, 3);
+        voodoo_filter_pass(2, &b[3], &a[3], &s[1], column - 4, cap);
+        voodoo_filter_pass(2, &a[2], &b[2], &s[1], column - 4, cap);
+        a[0] = s[0];
+        a[1] = s[1];
+        voodoo_filter_pass(2, out[c], a, &s[1], column - 4, cap);
+
+        out[c][column - 4] = b[column - 4];
+        out[c][column - 3] = b[column - 3];
+        out[c][column - 2] = voodoo_filter_v2_px(voodoo_filter_v2_px(s[column - 2], end, cap), end, cap);
+        out[c][column - 1] = voodoo_filter_v2_px(voodoo_filter_v2_px(s[column - 1], end, cap), end, cap);
+    }
+}
+
+/*RGB565 to XRGB8888 through the CLUT. On NEON this looks up eight pixels at
+  a time in the three per-component tables with TBL; elsewhere the 256 KB
+  video_16to32[] lookup is still the quickest.*/
+static void
+voodoo_scanout_16to32(const voodoo_t *voodoo, uint32_t *p, const uint16_t *src, int w)
+{
+    int x = 0;
+
+#if defined VOODOO_DISP_NEON
+    uint8x16x2_t lut_b;
+    uint8x16x4_t lut_g;
+    uint8x16x2_t lut_r;
+
+    for (int c = 0; c < 4; c++) {
+        lut_g.val[c] = vld1q_u8(&voodoo->video_565_g[c * 16]);
+        if (c < 2) {
+            lut_b.val[c] = vld1q_u8(&voodoo->video_565_b[c * 16]);
+            lut_r.val[c] = vld1q_u8(&voodoo->video_565_r[c * 16]);
+        }
+    }
+
+    for (; (x + 8) <= w; x += 8) {
+        uint16x8_t  v = vld1q_u16(&src[x]);
+        uint8x8x4_t out;
+
+        out.val[0] = vqtbl2_u8(lut_b, vmovn_u16(vandq_u16(v, vdupq_n_u16(0x1f))));
+        out.val[1] = vqtbl4_u8(lut_g, vmovn_u16(vandq_u16(vshrq_n_u16(v, 5), vdupq_n_u16(0x3f))));
+        out.val[2] = vqtbl2_u8(lut_r, vmovn_u16(vshrq_n_u16(v, 11)));
+        out.val[3] = vdup_n_u8(0);
+        vst4_u8((uint8_t *) &p[x], out);
+    }
+#endif
+    for (; x < w; x++)
+        p[x] = voodoo->video_16to32[src[x]];
+}
+
+/*Convert one front buffer line to the target buffer, through the screen
+  filter if it is on*/
+static void
+voodoo_scanout_line(voodoo_t *voodoo, const voodoo_t *draw_voodoo, uint32_t *p, const uint16_t *src, int line)
+{
+    if (voodoo->scrfilter && voodoo->scrfilterEnabled) {
+        int filter = (voodoo->type == VOODOO_2) ? 2 : 1;
+
+        assert(voodoo->h_disp <= 4096);
+        if (voodoo->filter_type == filter && voodoo->h_disp >= 8) {
+            uint8_t out[3][4096];
+
+            if (filter == 2)
+                voodoo_filterline_v2_fast(voodoo, out, voodoo->h_disp, src);
+            else
+                voodoo_filterline_v1_fast(voodoo, out, voodoo->h_disp, src, line);
+
+            for (int x = 0; x < voodoo->h_disp; x++)
+                p[x] = (voodoo->clutData256[out[0][x]].b << 0 | voodoo->clutData256[out[1][x]].g << 8 | voodoo->clutData256[out[2][x]].r << 16);
+        } else {
+            uint8_t fil[4096 * 3]; /* interleaved 24-bit RGB */
+
+            if (filter == 2)
+                voodoo_filterline_v2(voodoo, fil, voodoo->h_disp, (uint16_t *) src, line);
+            else
+                voodoo_filterline_v1(voodoo, fil, voodoo->h_disp, (uint16_t *) src, line);
+
+            for (int x = 0; x < voodoo->h_disp; x++)
+                p[x] = (voodoo->clutData256[fil[x * 3]].b << 0 | voodoo->clutData256[fil[x * 3 + 1]].g << 8 | voodoo->clutData256[fil[x * 3 + 2]].r << 16);
+        }
+    } else
+        voodoo_scanout_16to32(draw_voodoo, p, src, voodoo->h_disp);
+}
+
+static void
+voodoo_scanout_thread(void *param)
+{
+    voodoo_t *voodoo = (voodoo_t *) param;
+
+    while (voodoo->scanout_thread_run) {
+        thread_wait_event(voodoo->scanout_wake_event, -1);
+        thread_reset_event(voodoo->scanout_wake_event);
+
+        while (ATOMIC_LOAD(voodoo->scanout_read_idx) != ATOMIC_LOAD(voodoo->scanout_write_idx)) {
+            const voodoo_scanout_job_t *job = &voodoo->scanout_jobs[voodoo->scanout_read_idx & VOODOO_SCANOUT_MASK];
+
+            voodoo_scanout_line(voodoo, job->draw_voodoo, job->dst, job->src, job->line);
+            ATOMIC_INC(voodoo->scanout_read_idx);
+        }
+        thread_set_event(voodoo->scanout_idle_event);
+    }
+}
+
+/*Wait for the worker to finish every queued line*/
+static void
+voodoo_scanout_wait(voodoo_t *voodoo)
+{
+    if (!voodoo->scanout_thread)
+        return;
+
+    if (ATOMIC_LOAD(voodoo->scanout_read_idx) != ATOMIC_LOAD(voodoo->scanout_write_idx))
+        voodoo->scanout_waits++;
+    while (ATOMIC_LOAD(voodoo->scanout_read_idx) != ATOMIC_LOAD(voodoo->scanout_write_idx)) {
+        thread_reset_event(voodoo->scanout_idle_event);
+        thread_set_event(voodoo->scanout_wake_event);
+        if (ATOMIC_LOAD(voodoo->scanout_read_idx) != ATOMIC_LOAD(voodoo->scanout_write_idx))
+            thread_wait_event(voodoo->scanout_idle_event, 1);
+    }
+}
+
+/*Hand a line to the worker, or convert it here if there is none or its
+  queue is full. The worker is kicked every few lines rather than every
+  line, to keep the wakeups off the timer callback.*/
+static void
+voodoo_scanout_queue(voodoo_t *voodoo, voodoo_t *draw_voodoo, uint32_t *p, const uint16_t *src, int line)
+{
+    int idx = ATOMIC_LOAD(voodoo->scanout_write_idx);
+
+    if (!voodoo->scanout_thread || (idx - ATOMIC_LOAD(voodoo->scanout_read_idx)) >= VOODOO_SCANOUT_JOBS) {
+        voodoo_scanout_line(voodoo, draw_voodoo, p, src, line);
+        return;
+    }
+
+    voodoo->scanout_jobs[idx & VOODOO_SCANOUT_MASK].draw_voodoo = draw_voodoo;
+    voodoo->scanout_jobs[idx & VOODOO_SCANOUT_MASK].dst         = p;
+    voodoo->scanout_jobs[idx & VOODOO_SCANOUT_MASK].src         = src;
+    voodoo->scanout_jobs[idx & VOODOO_SCANOUT_MASK].line        = line;
+    ATOMIC_STORE(voodoo->scanout_write_idx, idx + 1);
+    voodoo->scanout_lines++;
+
+    if (!((idx + 1) & 15))
+        thread_set_event(voodoo->scanout_wake_event);
+}
+
+void
+voodoo_scanout_init(voodoo_t *voodoo)
+{
+    if (!voodoo->scanout_thread_enabled)
+        return;
+
+    voodoo->scanout_wake_event = thread_create_event();
+    voodoo->scanout_idle_event = thread_create_event();
+    voodoo->scanout_thread_run = 1;
+    voodoo->scanout_thread     = thread_create(voodoo_scanout_thread, voodoo);
+}
+
+void
+voodoo_scanout_close(voodoo_t *voodoo)
+{
+    if (!voodoo->scanout_thread)
+        return;
+
+    voodoo_scanout_wait(voodoo);
+    voodoo->scanout_thread_run = 0;
+    thread_set_event(voodoo->scanout_wake_event);
+    thread_wait(voodoo->scanout_thread);
+    voodoo->scanout_thread = NULL;
+    thread_destroy_event(voodoo->scanout_wake_event);
+    thread_destroy_event(voodoo->scanout_idle_event);
+}
+
 void
 voodoo_callback(void *priv)
 {
@@ -551,23 +945,7 @@ voodoo_callback(void *priv)
                 for (x = 0; x < v_x_add; x++)
                     monitor->target_buffer->line[voodoo->line + v_y_add][x] = 0x00000000;
 
-                if (voodoo->scrfilter && voodoo->scrfilterEnabled) {
-                    uint8_t fil[4096 * 3]; /* interleaved 24-bit RGB */
-
-                    assert(voodoo->h_disp <= 4096);
-                    if (voodoo->type == VOODOO_2)
-                        voodoo_filterline_v2(voodoo, fil, voodoo->h_disp, src, voodoo->line);
-                    else
-                        voodoo_filterline_v1(voodoo, fil, voodoo->h_disp, src, voodoo->line);
-
-                    for (x = 0; x < voodoo->h_disp; x++) {
-                        p[x] = (voodoo->clutData256[fil[x * 3]].b << 0 | voodoo->clutData256[fil[x * 3 + 1]].g << 8 | voodoo->clutData256[fil[x * 3 + 2]].r << 16);
-                    }
-                } else {
-                    for (x = 0; x < voodoo->h_disp; x++) {
-                        p[x] = draw_voodoo->video_16to32[src[x]];
-                    }
-                }
+                voodoo_scanout_queue(voodoo, draw_voodoo, p, src, voodoo->line);
 
                 /* Draw right overscan. */
                 for (x = 0; x < v_x_add; x++)
@@ -628,6 +1006,9 @@ skip_draw:
             } else
                 thread_release_mutex(voodoo->swap_mutex);
         }
+        /*An SLI slave's swap is counted by its master and picked up here on
+          the slave's own retrace*/
+        voodoo_metrics_frame(voodoo);
         voodoo->v_retrace = 1;
     }
     voodoo->line++;
@@ -643,6 +1024,7 @@ skip_draw:
             }
             thread_release_mutex(voodoo->force_blit_mutex);
 
+            voodoo_scanout_wait(voodoo);
             if (voodoo->dirty_line_high > voodoo->dirty_line_low || force_blit)
                 svga_doblit(voodoo->h_disp, voodoo->v_disp - 1, voodoo->svga);
             else if (voodoo->svga->override)
@@ -165,6 +165,20 @@ do_dither(voodoo_params_t *params, rgba8_t col, int x, int y)
     return b | (g << 5) | (r << 11);
 }
 
+/*Wait for the queued triangles this LFB write depends on: those in the same
+  band of the colour and/or aux surface it touches. Through the pixel
+  pipeline both may be read and written.*/
+static void
+voodoo_fb_wait_for_row(voodoo_t *voodoo, int y, int write_mask)
+{
+    int pipeline = voodoo->lfbMode & 0x100;
+
+    if (pipeline || (write_mask & (LFB_WRITE_COLOUR | LFB_WRITE_BOTH)))
+        voodoo_wait_for_render_band(voodoo, voodoo->fb_write_offset, y);
+    if (pipeline ? (voodoo->params.fbzMode & (FBZ_DEPTH_ENABLE | FBZ_DEPTH_WMASK | FBZ_ALPHA_ENABLE)) : (write_mask & (LFB_WRITE_DEPTH | LFB_WRITE_BOTH)))
+        voodoo_wait_for_render_band(voodoo, voodoo->params.aux_offset, y);
+}
+
 void
 voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
 {
@@ -232,6 +246,8 @@ voodoo_fb_writew(uint32_t addr, uint16_t val, void *priv)
         y >>= 1;
     }
 
+    voodoo_fb_wait_for_row(voodoo, y, write_mask);
+
     if (voodoo->fb_write_offset == voodoo->params.front_offset && y < 2048)
         voodoo->dirty_line[y] = 1;
 
@@ -438,6 +454,8 @@ voodoo_fb_writel(uint32_t addr, uint32_t val, void *priv)
         y >>= 1;
     }
 
+    voodoo_fb_wait_for_row(voodoo, y, write_mask);
+
     if (voodoo->fb_write_offset == voodoo->params.front_offset && y < 2048)
         voodoo->dirty_line[y] = 1;
 
@@ -20,6 +20,11 @@
 #include <stddef.h>
 #include <wchar.h>
 #include <math.h>
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#    include <emmintrin.h>
+#endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
@@ -40,6 +45,7 @@
 #include <86box/vid_voodoo_reg.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
+#include <86box/vid_voodoo_setup.h>
 #include <86box/vid_voodoo_texture.h>
 
 #ifdef ENABLE_VOODOO_FIFO_LOG
@@ -65,6 +71,13 @@ voodoo_fifo_log(const char *fmt, ...)
 /* Per-card wake delay: keep all Voodoo cards at the default */
 #define WAKE_DELAY_OF(v) (WAKE_DELAY_DEFAULT)
 
+/* FIFO batching: the FIFO thread polls this many times before it parks, with
+   1, 2, 4 ... 512 pause instructions ahead of each poll */
+#define FIFO_SPIN_ROUNDS 10
+/* A parked FIFO thread is woken at once, rather than by the wake timer, when
+   this many entries are waiting */
+#define FIFO_WAKE_WATERMARK 0x1000
+
 static __inline uint8_t
 voodoo_queue_color_buf_tag(const voodoo_t *voodoo, int buf)
 {
@@ -153,15 +166,98 @@ voodoo_cmdfifo_reg_writel(voodoo_t *voodoo, uint32_t addr, uint32_t val)
     voodoo_reg_writel(addr, val, voodoo);
     voodoo_queue_apply_reg(voodoo, addr, val);
 }
+static __inline void
+voodoo_fifo_pause(void)
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+#    ifdef _MSC_VER
+    __yield();
+#    else
+    __asm__ volatile("yield");
+#    endif
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#endif
+}
+
+/*Anything for the FIFO thread to do: queued writes or CMDFIFO data*/
+static __inline int
+voodoo_fifo_has_work(voodoo_t *voodoo)
+{
+    return !FIFO_EMPTY ||
+           (voodoo->cmdfifo_enabled && (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr || voodoo->cmdfifo_in_sub)) ||
+           (voodoo->cmdfifo_enabled_2 && (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2 || voodoo->cmdfifo_in_sub_2));
+}
+
+/*What the FIFO thread is waiting on: 0 for any work, 1 or 2 for more words
+  in that CMDFIFO*/
+static __inline int
+voodoo_fifo_wait_done(voodoo_t *voodoo, int cmdfifo)
+{
+    if (!voodoo->fifo_thread_run)
+        return 1;
+    if (cmdfifo == 1)
+        return voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr;
+    if (cmdfifo == 2)
+        return voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2;
+    return voodoo_fifo_has_work(voodoo);
+}
+
+/*Called on the FIFO thread when it has run out of work. With batching it
+  polls with exponential backoff first, as a guest streaming registers
+  usually writes again within microseconds; only if nothing turns up does it
+  park, and only then do writers signal it. The flag is raised before the
+  last check, so a writer either sees it or its write is seen.*/
+static void
+voodoo_fifo_thread_wait(voodoo_t *voodoo, int cmdfifo)
+{
+    if (!voodoo->fifo_batch_enabled) {
+        thread_wait_event(voodoo->wake_fifo_thread, -1);
+        thread_reset_event(voodoo->wake_fifo_thread);
+        voodoo->fifo_wakeups++;
+        return;
+    }
+
+    for (int round = 0; round < FIFO_SPIN_ROUNDS; round++) {
+        for (int c = 0; c < (1 << round); c++)
+            voodoo_fifo_pause();
+        if (voodoo_fifo_wait_done(voodoo, cmdfifo)) {
+            voodoo->fifo_spin_hits++;
+            return;
+        }
+    }
+
+    ATOMIC_STORE(voodoo->fifo_thread_parked, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!voodoo_fifo_wait_done(voodoo, cmdfifo)) {
+        thread_wait_event(voodoo->wake_fifo_thread, -1);
+        voodoo->fifo_wakeups++;
+    }
+    thread_reset_event(voodoo->wake_fifo_thread);
+    ATOMIC_STORE(voodoo->fifo_thread_parked, 0);
+}
+
+/*With batching, a FIFO thread that is running or spinning will find new work
+  itself, and one with nothing to do has no reason to wake*/
+static __inline int
+voodoo_fifo_thread_needs_wake(voodoo_t *voodoo)
+{
+    if (!voodoo->fifo_batch_enabled)
+        return 1;
+    atomic_thread_fence(memory_order_seq_cst);
+    return ATOMIC_LOAD(voodoo->fifo_thread_parked) && voodoo_fifo_has_work(voodoo);
+}
+
 void
 voodoo_wake_fifo_thread(voodoo_t *voodoo)
 {
-    if (!timer_is_enabled(&voodoo->wake_timer)) {
+    if (!timer_is_enabled(&voodoo->wake_timer) && voodoo_fifo_thread_needs_wake(voodoo)) {
         /*Don't wake FIFO thread immediately - if we do that it will probably
           process one word and go back to sleep, requiring it to be woken on
           almost every write. Instead, wait a short while so that the CPU
           emulation writes more data so we have more batched-up work.*/
         timer_set_delay_u64(&voodoo->wake_timer, WAKE_DELAY_OF(voodoo));
+        voodoo->fifo_wake_signals++;
     }
 }
 
@@ -169,6 +265,7 @@ void
 voodoo_wake_fifo_thread_now(voodoo_t *voodoo)
 {
     thread_set_event(voodoo->wake_fifo_thread); /*Wake up FIFO thread if moving from idle*/
+    voodoo->fifo_wake_signals++;
 }
 
 void
@@ -240,7 +337,16 @@ voodoo_queue_command(voodoo_t *voodoo, uint32_t addr_type, uint32_t val)
     voodoo->fifo_write_idx++;
     voodoo->cmd_status &= ~(1 << 24);
 
-    if (FIFO_ENTRIES > 0xe000)
+    if (voodoo->fifo_batch_enabled) {
+        /*Signal only a parked thread: the first write after it parks arms the
+          wake timer, and crossing the watermark wakes it at once*/
+        if (voodoo_fifo_thread_needs_wake(voodoo)) {
+            if (FIFO_ENTRIES == FIFO_WAKE_WATERMARK)
+                voodoo_wake_fifo_thread_now(voodoo);
+            else
+                voodoo_wake_fifo_thread(voodoo);
+        }
+    } else if (FIFO_ENTRIES > 0xe000)
         voodoo_wake_fifo_thread(voodoo);
 }
 
@@ -297,10 +403,8 @@ cmdfifo_get(voodoo_t *voodoo)
     uint32_t val;
 
     if (!voodoo->cmdfifo_in_sub) {
-        while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd == voodoo->cmdfifo_depth_wr)) {
-            thread_wait_event(voodoo->wake_fifo_thread, -1);
-            thread_reset_event(voodoo->wake_fifo_thread);
-        }
+        while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd == voodoo->cmdfifo_depth_wr))
+            voodoo_fifo_thread_wait(voodoo, 1);
     }
 
     if (voodoo->cmdfifo_in_agp)
@@ -316,28 +420,14 @@ cmdfifo_get(voodoo_t *voodoo)
     return val;
 }
 
-static inline float
-cmdfifo_get_f(voodoo_t *voodoo)
-{
-    union {
-        uint32_t i;
-        float    f;
-    } tempif;
-
-    tempif.i = cmdfifo_get(voodoo);
-    return tempif.f;
-}
-
 static uint32_t
 cmdfifo_get_2(voodoo_t *voodoo)
 {
     uint32_t val;
 
     if (!voodoo->cmdfifo_in_sub_2) {
-        while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd_2 == voodoo->cmdfifo_depth_wr_2)) {
-            thread_wait_event(voodoo->wake_fifo_thread, -1);
-            thread_reset_event(voodoo->wake_fifo_thread);
-        }
+        while (voodoo->fifo_thread_run && (voodoo->cmdfifo_depth_rd_2 == voodoo->cmdfifo_depth_wr_2))
+            voodoo_fifo_thread_wait(voodoo, 2);
     }
 
     if (voodoo->cmdfifo_in_agp_2)
@@ -353,16 +443,47 @@ cmdfifo_get_2(voodoo_t *voodoo)
     return val;
 }
 
-static inline float
-cmdfifo_get_f_2(voodoo_t *voodoo)
+/*Read n words of the CMDFIFO into dst. When the whole run is already in
+  the FIFO and contiguous in local memory it is copied with one depth check
+  and one bounds check; otherwise (AGP, a run that wraps the end of memory,
+  or words the guest hasn't written yet) it falls back to cmdfifo_get(),
+  which waits for the guest a word at a time.*/
+static void
+cmdfifo_get_block(voodoo_t *voodoo, uint32_t *dst, int n)
 {
-    union {
-        uint32_t i;
-        float    f;
-    } tempif;
+    uint32_t offset = voodoo->cmdfifo_rp & voodoo->fb_mask;
+
+    if (!voodoo->cmdfifo_in_agp && (offset + (n << 2)) <= (voodoo->fb_mask + 1)
+        && (voodoo->cmdfifo_in_sub || (voodoo->cmdfifo_depth_wr - voodoo->cmdfifo_depth_rd) >= n)) {
+        memcpy(dst, &voodoo->fb_mem[offset], n << 2);
+        if (!voodoo->cmdfifo_in_sub)
+            voodoo->cmdfifo_depth_rd += n;
+        voodoo->cmdfifo_rp += n << 2;
+        voodoo->cmdfifo_block_reads++;
+    } else {
+        for (int c = 0; c < n; c++)
+            dst[c] = cmdfifo_get(voodoo);
+        voodoo->cmdfifo_block_fallbacks++;
+    }
+}
 
-    tempif.i = cmdfifo_get_2(voodoo);
-    return tempif.f;
+static void
+cmdfifo_get_block_2(voodoo_t *voodoo, uint32_t *dst, int n)
+{
+    uint32_t offset = voodoo->cmdfifo_rp_2 & voodoo->fb_mask;
+
+    if (!voodoo->cmdfifo_in_agp_2 && (offset + (n << 2)) <= (voodoo->fb_mask + 1)
+        && (voodoo->cmdfifo_in_sub_2 || (voodoo->cmdfifo_depth_wr_2 - voodoo->cmdfifo_depth_rd_2) >= n)) {
+        memcpy(dst, &voodoo->fb_mem[offset], n << 2);
+        if (!voodoo->cmdfifo_in_sub_2)
+            voodoo->cmdfifo_depth_rd_2 += n;
+        voodoo->cmdfifo_rp_2 += n << 2;
+        voodoo->cmdfifo_block_reads++;
+    } else {
+        for (int c = 0; c < n; c++)
+            dst[c] = cmdfifo_get_2(voodoo);
+        voodoo->cmdfifo_block_fallbacks++;
+    }
 }
 
 enum {
@@ -378,6 +499,110 @@ enum {
     CMDFIFO3_PC = (1 << 28)
 };
 
+/*Packets 1 and 5 are read in runs of up to this many words. A packet 3 is
+  at most 15 vertices of 14 words plus 7 of padding, so always fits in one.*/
+#define CMDFIFO_BLOCK_WORDS 256
+
+static inline float
+cmdfifo_word_f(uint32_t val)
+{
+    union {
+        uint32_t i;
+        float    f;
+    } tempif;
+
+    tempif.i = val;
+    return tempif.f;
+}
+
+/*Number of words in a packet 3, from its header*/
+static int
+cmdfifo_packet3_words(uint32_t header)
+{
+    int words = 2;
+
+    if (header & CMDFIFO3_PC_MASK_RGB)
+        words += (header & CMDFIFO3_PC) ? 1 : 3;
+    if ((header & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
+        words++;
+    if (header & CMDFIFO3_PC_MASK_Z)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_Wb)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_W0)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_S0_T0)
+        words += 2;
+    if (header & CMDFIFO3_PC_MASK_W1)
+        words++;
+    if (header & CMDFIFO3_PC_MASK_S1_T1)
+        words += 2;
+
+    return (((header >> 6) & 0xf) * words) + ((header >> 29) & 7);
+}
+
+/*Packet 3, already read into words[]. Each vertex is decoded straight into
+  the setup vertex and handed to triangle setup, rather than going through
+  voodoo_reg_writel() for every component and command.*/
+static void
+cmdfifo_packet3(voodoo_t *voodoo, uint32_t header, const uint32_t *words)
+{
+    vert_t *vert          = &voodoo->verts[3];
+    int     num_verticies = (header >> 6) & 0xf;
+    int     type          = (header >> 3) & 7;
+    int     v_num         = (type == 2) ? 1 : 0;
+
+#if 0
+    voodoo_fifo_log("CMDFIFO3: verts=%i mask=%02x type=%i\n", num_verticies, (header >> 10) & 0xff, type);
+#endif
+    voodoo->sSetupMode = ((header >> 10) & 0xff) | (((header >> 22) & 0xf) << 16);
+
+    while (num_verticies--) {
+        vert->sVx = cmdfifo_word_f(*words++);
+        vert->sVy = cmdfifo_word_f(*words++);
+        if (header & CMDFIFO3_PC_MASK_RGB) {
+            if (header & CMDFIFO3_PC) {
+                uint32_t val = *words++;
+
+                vert->sBlue  = (float) (val & 0xff);
+                vert->sGreen = (float) ((val >> 8) & 0xff);
+                vert->sRed   = (float) ((val >> 16) & 0xff);
+                vert->sAlpha = (float) ((val >> 24) & 0xff);
+            } else {
+                vert->sRed   = cmdfifo_word_f(*words++);
+                vert->sGreen = cmdfifo_word_f(*words++);
+                vert->sBlue  = cmdfifo_word_f(*words++);
+            }
+        }
+        if ((header & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
+            vert->sAlpha = cmdfifo_word_f(*words++);
+        if (header & CMDFIFO3_PC_MASK_Z)
+            vert->sVz = cmdfifo_word_f(*words++);
+        if (header & CMDFIFO3_PC_MASK_Wb)
+            vert->sWb = cmdfifo_word_f(*words++);
+        if (header & CMDFIFO3_PC_MASK_W0)
+            vert->sW0 = cmdfifo_word_f(*words++);
+        if (header & CMDFIFO3_PC_MASK_S0_T0) {
+            vert->sS0 = cmdfifo_word_f(*words++);
+            vert->sT0 = cmdfifo_word_f(*words++);
+        }
+        if (header & CMDFIFO3_PC_MASK_W1)
+            vert->sW1 = cmdfifo_word_f(*words++);
+        if (header & CMDFIFO3_PC_MASK_S1_T1) {
+            vert->sS1 = cmdfifo_word_f(*words++);
+            vert->sT1 = cmdfifo_word_f(*words++);
+        }
+
+        if (v_num)
+            voodoo_setup_draw_tri(voodoo);
+        else
+            voodoo_setup_begin_tri(voodoo);
+        v_num++;
+        if (v_num == 3 && type == 0)
+            v_num = 0;
+    }
+}
+
 void
 voodoo_fifo_thread(void *param)
 {
@@ -385,8 +610,7 @@ voodoo_fifo_thread(void *param)
 
     while (voodoo->fifo_thread_run) {
         thread_set_event(voodoo->fifo_not_full_event);
-        thread_wait_event(voodoo->wake_fifo_thread, -1);
-        thread_reset_event(voodoo->wake_fifo_thread);
+        voodoo_fifo_thread_wait(voodoo, 0);
         voodoo->voodoo_busy = 1;
         while (!FIFO_EMPTY) {
             uint64_t      start_time = plat_timer_read();
@@ -411,7 +635,9 @@ voodoo_fifo_thread(void *param)
                     }
                     break;
                 case FIFO_WRITEW_FB:
-                    voodoo_wait_for_render_thread_idle(voodoo);
+                    /*Each write waits only for the triangles sharing its band*/
+                    if (!voodoo->lfb_hazard_enabled)
+                        voodoo_wait_for_render_thread_idle(voodoo);
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEW_FB) {
                         uint8_t target_buf = fifo->target_buf;
 
@@ -427,7 +653,9 @@ voodoo_fifo_thread(void *param)
                     }
                     break;
                 case FIFO_WRITEL_FB:
-                    voodoo_wait_for_render_thread_idle(voodoo);
+                    /*Each write waits only for the triangles sharing its band*/
+                    if (!voodoo->lfb_hazard_enabled)
+                        voodoo_wait_for_render_thread_idle(voodoo);
                     while ((fifo->addr_type & FIFO_TYPE) == FIFO_WRITEL_FB) {
                         uint8_t target_buf = fifo->target_buf;
 
@@ -484,12 +712,11 @@ voodoo_fifo_thread(void *param)
             uint64_t start_time = plat_timer_read();
             uint64_t end_time;
             uint32_t header = cmdfifo_get(voodoo);
+            uint32_t words[CMDFIFO_BLOCK_WORDS];
             uint32_t addr;
             uint32_t mask;
-            int      smode;
             int      num;
-            int      num_verticies;
-            int      v_num;
+            int      pos;
 
 #if 0
             voodoo_fifo_log(" CMDFIFO header %08x at %08x\n", header, voodoo->cmdfifo_rp);
@@ -553,29 +780,35 @@ voodoo_fifo_thread(void *param)
 #if 0
                     voodoo_fifo_log("CMDFIFO1 addr=%08x\n",addr);
 #endif
-                    while (num--) {
-                        uint32_t val = cmdfifo_get(voodoo);
-                        if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
+                    while (num) {
+                        int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                        cmdfifo_get_block(voodoo, words, block);
+                        num -= block;
+                        for (int c = 0; c < block; c++) {
+                            uint32_t val = words[c];
+                            if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
 #if 0
-                            if (voodoo->type != VOODOO_BANSHEE)
-                                fatal("CMDFIFO1: Not Banshee\n");
+                                if (voodoo->type != VOODOO_BANSHEE)
+                                    fatal("CMDFIFO1: Not Banshee\n");
 #endif
 
 #if 0
-                            voodoo_fifo_log("CMDFIFO1: write %08x %08x\n", addr, val);
+                                voodoo_fifo_log("CMDFIFO1: write %08x %08x\n", addr, val);
 #endif
-                            voodoo_2d_reg_writel(voodoo, addr, val);
-                        } else {
-                            if ((addr & 0x3ff) == SST_triangleCMD || (addr & 0x3ff) == SST_ftriangleCMD || (addr & 0x3ff) == SST_fastfillCMD || (addr & 0x3ff) == SST_nopCMD)
-                                voodoo->cmd_written_fifo++;
+                                voodoo_2d_reg_writel(voodoo, addr, val);
+                            } else {
+                                if ((addr & 0x3ff) == SST_triangleCMD || (addr & 0x3ff) == SST_ftriangleCMD || (addr & 0x3ff) == SST_fastfillCMD || (addr & 0x3ff) == SST_nopCMD)
+                                    voodoo->cmd_written_fifo++;
 
-                            if (voodoo->type >= VOODOO_BANSHEE && (addr & 0x3ff) == SST_swapbufferCMD)
-                                voodoo->cmd_written_fifo++;
-                            voodoo_cmdfifo_reg_writel(voodoo, addr, val);
-                        }
+                                if (voodoo->type >= VOODOO_BANSHEE && (addr & 0x3ff) == SST_swapbufferCMD)
+                                    voodoo->cmd_written_fifo++;
+                                voodoo_cmdfifo_reg_writel(voodoo, addr, val);
+                            }
 
-                        if (header & (1 << 15))
-                            addr += 4;
+                            if (header & (1 << 15))
+                                addr += 4;
+                        }
                     }
                     break;
 
@@ -597,63 +830,8 @@ voodoo_fifo_thread(void *param)
                     break;
 
                 case 3:
-                    num   = (header >> 29) & 7;
-                    mask  = header; //(header >> 10) & 0xff;
-                    smode = (header >> 22) & 0xf;
-                    voodoo_cmdfifo_reg_writel(voodoo, SST_sSetupMode, ((header >> 10) & 0xff) | (smode << 16));
-                    num_verticies = (header >> 6) & 0xf;
-                    v_num         = 0;
-                    if (((header >> 3) & 7) == 2)
-                        v_num = 1;
-#if 0
-                    voodoo_fifo_log("CMDFIFO3: num=%i verts=%i mask=%02x\n", num, num_verticies, (header >> 10) & 0xff);
-                    voodoo_fifo_log("CMDFIFO3 %02x %i\n", (header >> 10), (header >> 3) & 7);
-#endif
-
-                    while (num_verticies--) {
-                        voodoo->verts[3].sVx = cmdfifo_get_f(voodoo);
-                        voodoo->verts[3].sVy = cmdfifo_get_f(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_RGB) {
-                            if (header & CMDFIFO3_PC) {
-                                uint32_t val            = cmdfifo_get(voodoo);
-                                voodoo->verts[3].sBlue  = (float) (val & 0xff);
-                                voodoo->verts[3].sGreen = (float) ((val >> 8) & 0xff);
-                                voodoo->verts[3].sRed   = (float) ((val >> 16) & 0xff);
-                                voodoo->verts[3].sAlpha = (float) ((val >> 24) & 0xff);
-                            } else {
-                                voodoo->verts[3].sRed   = cmdfifo_get_f(voodoo);
-                                voodoo->verts[3].sGreen = cmdfifo_get_f(voodoo);
-                                voodoo->verts[3].sBlue  = cmdfifo_get_f(voodoo);
-                            }
-                        }
-                        if ((mask & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
-                            voodoo->verts[3].sAlpha = cmdfifo_get_f(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_Z)
-                            voodoo->verts[3].sVz = cmdfifo_get_f(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_Wb)
-                            voodoo->verts[3].sWb = cmdfifo_get_f(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_W0)
-                            voodoo->verts[3].sW0 = cmdfifo_get_f(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_S0_T0) {
-                            voodoo->verts[3].sS0 = cmdfifo_get_f(voodoo);
-                            voodoo->verts[3].sT0 = cmdfifo_get_f(voodoo);
-                        }
-                        if (mask & CMDFIFO3_PC_MASK_W1)
-                            voodoo->verts[3].sW1 = cmdfifo_get_f(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_S1_T1) {
-                            voodoo->verts[3].sS1 = cmdfifo_get_f(voodoo);
-                            voodoo->verts[3].sT1 = cmdfifo_get_f(voodoo);
-                        }
-                        if (v_num)
-                            voodoo_cmdfifo_reg_writel(voodoo, SST_sDrawTriCMD, 0);
-                        else
-                            voodoo_cmdfifo_reg_writel(voodoo, SST_sBeginTriCMD, 0);
-                        v_num++;
-                        if (v_num == 3 && ((header >> 3) & 7) == 0)
-                            v_num = 0;
-                    }
-                    while (num--)
-                        cmdfifo_get(voodoo);
+                    cmdfifo_get_block(voodoo, words, cmdfifo_packet3_words(header));
+                    cmdfifo_packet3(voodoo, header, words);
                     break;
 
                 case 4:
@@ -663,9 +841,15 @@ voodoo_fifo_thread(void *param)
 #if 0
                     voodoo_fifo_log("CMDFIFO4 addr=%08x\n",addr);
 #endif
+                    /*The registers written, then the padding*/
+                    pos = 0;
+                    for (uint32_t m = mask; m; m >>= 1)
+                        pos += m & 1;
+                    cmdfifo_get_block(voodoo, words, pos + num);
+                    pos = 0;
                     while (mask) {
                         if (mask & 1) {
-                            uint32_t val = cmdfifo_get(voodoo);
+                            uint32_t val = words[pos++];
 
                             if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
                                 if (voodoo->type < VOODOO_BANSHEE)
@@ -688,8 +872,6 @@ voodoo_fifo_thread(void *param)
                         addr += 4;
                         mask >>= 1;
                     }
-                    while (num--)
-                        cmdfifo_get(voodoo);
                     break;
 
                 case 5:
@@ -719,25 +901,43 @@ voodoo_fifo_thread(void *param)
 #endif
                                 flush_texture_cache(voodoo, addr & voodoo->texture_mask, 1);
                             }
-                            while (num--) {
-                                uint32_t val = cmdfifo_get(voodoo);
-                                if (addr <= voodoo->fb_mask)
-                                    *(uint32_t *) &voodoo->fb_mem[addr] = val;
-                                addr += 4;
+                            while (num) {
+                                int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                                cmdfifo_get_block(voodoo, words, block);
+                                num -= block;
+                                for (int c = 0; c < block; c++) {
+                                    uint32_t val = words[c];
+                                    if (addr <= voodoo->fb_mask)
+                                        *(uint32_t *) &voodoo->fb_mem[addr] = val;
+                                    addr += 4;
+                                }
                             }
                             break;
                         case 2: /*Framebuffer*/
-                            while (num--) {
-                                uint32_t val = cmdfifo_get(voodoo);
-                                voodoo_fb_writel(addr, val, voodoo);
-                                addr += 4;
+                            while (num) {
+                                int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                                cmdfifo_get_block(voodoo, words, block);
+                                num -= block;
+                                for (int c = 0; c < block; c++) {
+                                    uint32_t val = words[c];
+                                    voodoo_fb_writel(addr, val, voodoo);
+                                    addr += 4;
+                                }
                             }
                             break;
                         case 3: /*Texture*/
-                            while (num--) {
-                                uint32_t val = cmdfifo_get(voodoo);
-                                voodoo_tex_writel(addr, val, voodoo);
-                                addr += 4;
+                            while (num) {
+                                int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                                cmdfifo_get_block(voodoo, words, block);
+                                num -= block;
+                                for (int c = 0; c < block; c++) {
+                                    uint32_t val = words[c];
+                                    voodoo_tex_writel(addr, val, voodoo);
+                                    addr += 4;
+                                }
                             }
                             break;
 
@@ -775,12 +975,11 @@ voodoo_fifo_thread(void *param)
             uint64_t start_time = plat_timer_read();
             uint64_t end_time;
             uint32_t header = cmdfifo_get_2(voodoo);
+            uint32_t words[CMDFIFO_BLOCK_WORDS];
             uint32_t addr;
             uint32_t mask;
-            int      smode;
             int      num;
-            int      num_verticies;
-            int      v_num;
+            int      pos;
 
 #if 0
             voodoo_fifo_log(" CMDFIFO header %08x at %08x\n", header, voodoo->cmdfifo_rp);
@@ -844,29 +1043,35 @@ voodoo_fifo_thread(void *param)
 #if 0
                     voodoo_fifo_log("CMDFIFO1 addr=%08x\n",addr);
 #endif
-                    while (num--) {
-                        uint32_t val = cmdfifo_get_2(voodoo);
-                        if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
+                    while (num) {
+                        int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                        cmdfifo_get_block_2(voodoo, words, block);
+                        num -= block;
+                        for (int c = 0; c < block; c++) {
+                            uint32_t val = words[c];
+                            if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
 #if 0
-                            if (voodoo->type != VOODOO_BANSHEE)
-                                fatal("CMDFIFO1: Not Banshee\n");
+                                if (voodoo->type != VOODOO_BANSHEE)
+                                    fatal("CMDFIFO1: Not Banshee\n");
 #endif
 
 #if 0
-                            voodoo_fifo_log("CMDFIFO1: write %08x %08x\n", addr, val);
+                                voodoo_fifo_log("CMDFIFO1: write %08x %08x\n", addr, val);
 #endif
-                            voodoo_2d_reg_writel(voodoo, addr, val);
-                        } else {
-                            if ((addr & 0x3ff) == SST_triangleCMD || (addr & 0x3ff) == SST_ftriangleCMD || (addr & 0x3ff) == SST_fastfillCMD || (addr & 0x3ff) == SST_nopCMD)
-                                voodoo->cmd_written_fifo_2++;
+                                voodoo_2d_reg_writel(voodoo, addr, val);
+                            } else {
+                                if ((addr & 0x3ff) == SST_triangleCMD || (addr & 0x3ff) == SST_ftriangleCMD || (addr & 0x3ff) == SST_fastfillCMD || (addr & 0x3ff) == SST_nopCMD)
+                                    voodoo->cmd_written_fifo_2++;
 
-                            if (voodoo->type >= VOODOO_BANSHEE && (addr & 0x3ff) == SST_swapbufferCMD)
-                                voodoo->cmd_written_fifo_2++;
-                            voodoo_cmdfifo_reg_writel(voodoo, addr, val);
-                        }
+                                if (voodoo->type >= VOODOO_BANSHEE && (addr & 0x3ff) == SST_swapbufferCMD)
+                                    voodoo->cmd_written_fifo_2++;
+                                voodoo_cmdfifo_reg_writel(voodoo, addr, val);
+                            }
 
-                        if (header & (1 << 15))
-                            addr += 4;
+                            if (header & (1 << 15))
+                                addr += 4;
+                        }
                     }
                     break;
 
@@ -888,63 +1093,8 @@ voodoo_fifo_thread(void *param)
                     break;
 
                 case 3:
-                    num   = (header >> 29) & 7;
-                    mask  = header; //(header >> 10) & 0xff;
-                    smode = (header >> 22) & 0xf;
-                    voodoo_cmdfifo_reg_writel(voodoo, SST_sSetupMode, ((header >> 10) & 0xff) | (smode << 16));
-                    num_verticies = (header >> 6) & 0xf;
-                    v_num         = 0;
-                    if (((header >> 3) & 7) == 2)
-                        v_num = 1;
-#if 0
-                    voodoo_fifo_log("CMDFIFO3: num=%i verts=%i mask=%02x\n", num, num_verticies, (header >> 10) & 0xff);
-                    voodoo_fifo_log("CMDFIFO3 %02x %i\n", (header >> 10), (header >> 3) & 7);
-#endif
-
-                    while (num_verticies--) {
-                        voodoo->verts[3].sVx = cmdfifo_get_f_2(voodoo);
-                        voodoo->verts[3].sVy = cmdfifo_get_f_2(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_RGB) {
-                            if (header & CMDFIFO3_PC) {
-                                uint32_t val            = cmdfifo_get_2(voodoo);
-                                voodoo->verts[3].sBlue  = (float) (val & 0xff);
-                                voodoo->verts[3].sGreen = (float) ((val >> 8) & 0xff);
-                                voodoo->verts[3].sRed   = (float) ((val >> 16) & 0xff);
-                                voodoo->verts[3].sAlpha = (float) ((val >> 24) & 0xff);
-                            } else {
-                                voodoo->verts[3].sRed   = cmdfifo_get_f_2(voodoo);
-                                voodoo->verts[3].sGreen = cmdfifo_get_f_2(voodoo);
-                                voodoo->verts[3].sBlue  = cmdfifo_get_f_2(voodoo);
-                            }
-                        }
-                        if ((mask & CMDFIFO3_PC_MASK_ALPHA) && !(header & CMDFIFO3_PC))
-                            voodoo->verts[3].sAlpha = cmdfifo_get_f_2(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_Z)
-                            voodoo->verts[3].sVz = cmdfifo_get_f_2(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_Wb)
-                            voodoo->verts[3].sWb = cmdfifo_get_f_2(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_W0)
-                            voodoo->verts[3].sW0 = cmdfifo_get_f_2(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_S0_T0) {
-                            voodoo->verts[3].sS0 = cmdfifo_get_f_2(voodoo);
-                            voodoo->verts[3].sT0 = cmdfifo_get_f_2(voodoo);
-                        }
-                        if (mask & CMDFIFO3_PC_MASK_W1)
-                            voodoo->verts[3].sW1 = cmdfifo_get_f_2(voodoo);
-                        if (mask & CMDFIFO3_PC_MASK_S1_T1) {
-                            voodoo->verts[3].sS1 = cmdfifo_get_f_2(voodoo);
-                            voodoo->verts[3].sT1 = cmdfifo_get_f_2(voodoo);
-                        }
-                        if (v_num)
-                            voodoo_cmdfifo_reg_writel(voodoo, SST_sDrawTriCMD, 0);
-                        else
-                            voodoo_cmdfifo_reg_writel(voodoo, SST_sBeginTriCMD, 0);
-                        v_num++;
-                        if (v_num == 3 && ((header >> 3) & 7) == 0)
-                            v_num = 0;
-                    }
-                    while (num--)
-                        cmdfifo_get_2(voodoo);
+                    cmdfifo_get_block_2(voodoo, words, cmdfifo_packet3_words(header));
+                    cmdfifo_packet3(voodoo, header, words);
                     break;
 
                 case 4:
@@ -954,9 +1104,15 @@ voodoo_fifo_thread(void *param)
 #if 0
                     voodoo_fifo_log("CMDFIFO4 addr=%08x\n",addr);
 #endif
+                    /*The registers written, then the padding*/
+                    pos = 0;
+                    for (uint32_t m = mask; m; m >>= 1)
+                        pos += m & 1;
+                    cmdfifo_get_block_2(voodoo, words, pos + num);
+                    pos = 0;
                     while (mask) {
                         if (mask & 1) {
-                            uint32_t val = cmdfifo_get_2(voodoo);
+                            uint32_t val = words[pos++];
 
                             if ((addr & (1 << 13)) && voodoo->type >= VOODOO_BANSHEE) {
                                 if (voodoo->type < VOODOO_BANSHEE)
@@ -979,8 +1135,6 @@ voodoo_fifo_thread(void *param)
                         addr += 4;
                         mask >>= 1;
                     }
-                    while (num--)
-                        cmdfifo_get_2(voodoo);
                     break;
 
                 case 5:
@@ -1010,25 +1164,43 @@ voodoo_fifo_thread(void *param)
 #endif
                                 flush_texture_cache(voodoo, addr & voodoo->texture_mask, 1);
                             }
-                            while (num--) {
-                                uint32_t val = cmdfifo_get_2(voodoo);
-                                if (addr <= voodoo->fb_mask)
-                                    *(uint32_t *) &voodoo->fb_mem[addr] = val;
-                                addr += 4;
+                            while (num) {
+                                int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                                cmdfifo_get_block_2(voodoo, words, block);
+                                num -= block;
+                                for (int c = 0; c < block; c++) {
+                                    uint32_t val = words[c];
+                                    if (addr <= voodoo->fb_mask)
+                                        *(uint32_t *) &voodoo->fb_mem[addr] = val;
+                                    addr += 4;
+                                }
                             }
                             break;
                         case 2: /*Framebuffer*/
-                            while (num--) {
-                                uint32_t val = cmdfifo_get_2(voodoo);
-                                voodoo_fb_writel(addr, val, voodoo);
-                                addr += 4;
+                            while (num) {
+                                int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                                cmdfifo_get_block_2(voodoo, words, block);
+                                num -= block;
+                                for (int c = 0; c < block; c++) {
+                                    uint32_t val = words[c];
+                                    voodoo_fb_writel(addr, val, voodoo);
+                                    addr += 4;
+                                }
                             }
                             break;
                         case 3: /*Texture*/
-                            while (num--) {
-                                uint32_t val = cmdfifo_get_2(voodoo);
-                                voodoo_tex_writel(addr, val, voodoo);
-                                addr += 4;
+                            while (num) {
+                                int block = MIN(num, CMDFIFO_BLOCK_WORDS);
+
+                                cmdfifo_get_block_2(voodoo, words, block);
+                                num -= block;
+                                for (int c = 0; c < block; c++) {
+                                    uint32_t val = words[c];
+                                    voodoo_tex_writel(addr, val, voodoo);
+                                    addr += 4;
+                                }
                             }
                             break;
 
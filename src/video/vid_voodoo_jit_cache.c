@@ -0,0 +1,372 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Persistent on-disk cache of Voodoo JIT pixel pipeline blocks.
+ *
+ *          The cache file lives in the VM's NVR directory and holds the
+ *          compiled code of every render state seen so far, keyed by the
+ *          same render-state tuple voodoo_get_block() uses. It is tagged
+ *          with the host architecture, the code generator revision and a
+ *          fingerprint of the static table layout the code points into, so
+ *          a file from another build or host is ignored and rewritten.
+ *          Absolute pointers in the code are recorded as relocations and
+ *          re-emitted by the code generator when a block is installed.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/nvr.h>
+#include <86box/plat.h>
+#include <86box/vid_voodoo_jit_cache.h>
+
+#define VOODOO_JIT_CACHE_MAGIC       "86BVJIT"
+#define VOODOO_JIT_CACHE_VERSION     1
+#define VOODOO_JIT_CACHE_MAX_ENTRIES 4096
+#define VOODOO_JIT_CACHE_HASH_SIZE   (VOODOO_JIT_CACHE_MAX_ENTRIES * 2) /*keeps the load factor at or under 1/2*/
+#define VOODOO_JIT_CACHE_MAX_OPEN    8
+
+typedef struct voodoo_jit_cache_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t arch;
+    uint32_t revision;
+    uint32_t block_size;
+    uint64_t fingerprint;
+    uint32_t nr_entries;
+    uint32_t checksum; /*FNV-1a over everything after the header*/
+} voodoo_jit_cache_header_t;
+
+typedef struct voodoo_jit_cache_record_t {
+    voodoo_jit_cache_key_t key;
+    uint32_t               code_size;
+    uint32_t               reloc_count;
+} voodoo_jit_cache_record_t;
+
+/*Caches currently open, so two instances of a card get separate files.
+  Cards are created and destroyed on the emulation thread only.*/
+static voodoo_jit_cache_t *open_caches[VOODOO_JIT_CACHE_MAX_OPEN];
+
+#ifdef ENABLE_VOODOO_JIT_CACHE_LOG
+int voodoo_jit_cache_do_log = ENABLE_VOODOO_JIT_CACHE_LOG;
+
+static void
+voodoo_jit_cache_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (voodoo_jit_cache_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define voodoo_jit_cache_log(fmt, ...)
+#endif
+
+static uint32_t
+voodoo_jit_cache_checksum(const uint8_t *data, size_t size)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    for (size_t c = 0; c < size; c++) {
+        hash ^= data[c];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/*Index slot holding key, or the empty slot it would go in*/
+static int
+voodoo_jit_cache_slot(voodoo_jit_cache_t *cache, const voodoo_jit_cache_key_t *key)
+{
+    int slot = voodoo_jit_cache_checksum((const uint8_t *) key, sizeof(voodoo_jit_cache_key_t)) & (VOODOO_JIT_CACHE_HASH_SIZE - 1);
+
+    while (cache->hash[slot] >= 0) {
+        if (!memcmp(&cache->entries[cache->hash[slot]].key, key, sizeof(voodoo_jit_cache_key_t)))
+            break;
+        slot = (slot + 1) & (VOODOO_JIT_CACHE_HASH_SIZE - 1);
+    }
+
+    return slot;
+}
+
+static size_t
+voodoo_jit_cache_record_size(uint32_t code_size, uint32_t reloc_count)
+{
+    size_t size = sizeof(voodoo_jit_cache_record_t) + reloc_count * sizeof(voodoo_jit_cache_reloc_t) + code_size;
+
+    return (size + 3) & ~3;
+}
+
+static void
+voodoo_jit_cache_load(voodoo_jit_cache_t *cache)
+{
+    voodoo_jit_cache_header_t header;
+    FILE                     *fp;
+    long                      size;
+    size_t                    offset = 0;
+    uint8_t                  *image;
+
+    fp = plat_fopen(cache->path, "rb");
+    if (!fp)
+        return;
+
+    if (fread(&header, 1, sizeof(header), fp) != sizeof(header)
+        || memcmp(header.magic, VOODOO_JIT_CACHE_MAGIC, sizeof(header.magic))
+        || header.version != VOODOO_JIT_CACHE_VERSION
+        || header.arch != cache->arch
+        || header.revision != cache->revision
+        || header.block_size != cache->block_size
+        || header.fingerprint != cache->fingerprint
+        || header.nr_entries > VOODOO_JIT_CACHE_MAX_ENTRIES) {
+        voodoo_jit_cache_log("Voodoo JIT cache: %s is stale or foreign, ignoring\n", cache->path);
+        fclose(fp);
+        return;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp) - (long) sizeof(header);
+    fseek(fp, sizeof(header), SEEK_SET);
+    if (size <= 0) {
+        fclose(fp);
+        return;
+    }
+
+    image = malloc(size);
+    if (fread(image, 1, size, fp) != (size_t) size || voodoo_jit_cache_checksum(image, size) != header.checksum) {
+        voodoo_jit_cache_log("Voodoo JIT cache: %s is truncated or corrupt, ignoring\n", cache->path);
+        free(image);
+        fclose(fp);
+        return;
+    }
+    fclose(fp);
+
+    cache->entries     = calloc(header.nr_entries, sizeof(voodoo_jit_cache_entry_t));
+    cache->max_entries = header.nr_entries;
+
+    for (uint32_t c = 0; c < header.nr_entries; c++) {
+        voodoo_jit_cache_record_t record;
+        voodoo_jit_cache_entry_t *entry = &cache->entries[cache->nr_entries];
+        size_t                    start = offset;
+        int                       slot;
+
+        if (offset + sizeof(record) > (size_t) size)
+            break;
+        memcpy(&record, &image[offset], sizeof(record));
+        if (record.reloc_count > VOODOO_JIT_CACHE_MAX_RELOCS || !record.code_size || record.code_size > cache->block_size
+            || offset + voodoo_jit_cache_record_size(record.code_size, record.reloc_count) > (size_t) size)
+            break;
+        offset += voodoo_jit_cache_record_size(record.code_size, record.reloc_count);
+
+        slot = voodoo_jit_cache_slot(cache, &record.key);
+        if (cache->hash[slot] >= 0)
+            continue;
+
+        entry->key         = record.key;
+        entry->code_size   = record.code_size;
+        entry->reloc_count = record.reloc_count;
+        memcpy(entry->relocs, &image[start + sizeof(record)], record.reloc_count * sizeof(voodoo_jit_cache_reloc_t));
+        entry->code       = &image[start + sizeof(record) + record.reloc_count * sizeof(voodoo_jit_cache_reloc_t)];
+        entry->code_owned = 0;
+
+        cache->hash[slot] = cache->nr_entries++;
+    }
+
+    cache->image          = image;
+    cache->loaded_entries = cache->nr_entries;
+}
+
+static void
+voodoo_jit_cache_save(voodoo_jit_cache_t *cache)
+{
+    voodoo_jit_cache_header_t header;
+    FILE                     *fp;
+    size_t                    size = 0;
+    size_t                    offset = 0;
+    uint8_t                  *payload;
+
+    for (int c = 0; c < cache->nr_entries; c++)
+        size += voodoo_jit_cache_record_size(cache->entries[c].code_size, cache->entries[c].reloc_count);
+
+    payload = calloc(1, size ? size : 1);
+    for (int c = 0; c < cache->nr_entries; c++) {
+        const voodoo_jit_cache_entry_t *entry = &cache->entries[c];
+        voodoo_jit_cache_record_t       record;
+
+        memset(&record, 0, sizeof(record));
+        record.key         = entry->key;
+        record.code_size   = entry->code_size;
+        record.reloc_count = entry->reloc_count;
+        memcpy(&payload[offset], &record, sizeof(record));
+        memcpy(&payload[offset + sizeof(record)], entry->relocs, entry->reloc_count * sizeof(voodoo_jit_cache_reloc_t));
+        memcpy(&payload[offset + sizeof(record) + entry->reloc_count * sizeof(voodoo_jit_cache_reloc_t)], entry->code, entry->code_size);
+        offset += voodoo_jit_cache_record_size(entry->code_size, entry->reloc_count);
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VOODOO_JIT_CACHE_MAGIC, sizeof(header.magic));
+    header.version     = VOODOO_JIT_CACHE_VERSION;
+    header.arch        = cache->arch;
+    header.revision    = cache->revision;
+    header.block_size  = cache->block_size;
+    header.fingerprint = cache->fingerprint;
+    header.nr_entries  = cache->nr_entries;
+    header.checksum    = voodoo_jit_cache_checksum(payload, size);
+
+    fp = plat_fopen(cache->path, "wb");
+    if (fp) {
+        if (fwrite(&header, 1, sizeof(header), fp) != sizeof(header) || fwrite(payload, 1, size, fp) != size)
+            pclog("Voodoo JIT cache: failed to write %s\n", cache->path);
+        fclose(fp);
+    }
+
+    free(payload);
+}
+
+/*The file is named after the code generator and the card type, with the
+  lowest instance number not already open, so an SLI pair keeps one file per
+  board instead of both loading and rewriting the same one*/
+voodoo_jit_cache_t *
+voodoo_jit_cache_open(const char *name, int type, uint32_t arch, uint32_t revision, uint32_t block_size, uint64_t fingerprint)
+{
+    voodoo_jit_cache_t *cache = calloc(1, sizeof(voodoo_jit_cache_t));
+    uint64_t            start = plat_timer_read();
+    int                 open_slot = -1;
+    char                fn[256];
+
+    for (int c = 0; c < VOODOO_JIT_CACHE_MAX_OPEN; c++) {
+        if (!open_caches[c]) {
+            if (open_slot < 0)
+                open_slot = c;
+            continue;
+        }
+        if (!strcmp(open_caches[c]->name, name) && (open_caches[c]->type == type) && (open_caches[c]->instance == cache->instance)) {
+            /*Taken, start over with the next instance number*/
+            cache->instance++;
+            c = -1;
+        }
+    }
+    if (open_slot < 0) {
+        free(cache);
+        return NULL;
+    }
+    open_caches[open_slot] = cache;
+
+    snprintf(cache->name, sizeof(cache->name), "%s", name);
+    cache->type = type;
+    snprintf(fn, sizeof(fn), "%s_%i_%i.bin", name, type, cache->instance);
+    snprintf(cache->path, sizeof(cache->path), "%s", nvr_path(fn));
+    cache->arch        = arch;
+    cache->revision    = revision;
+    cache->block_size  = block_size;
+    cache->fingerprint = fingerprint;
+
+    cache->hash = malloc(VOODOO_JIT_CACHE_HASH_SIZE * sizeof(int));
+    for (int c = 0; c < VOODOO_JIT_CACHE_HASH_SIZE; c++)
+        cache->hash[c] = -1;
+
+    voodoo_jit_cache_load(cache);
+
+    cache->load_ticks = plat_timer_read() - start;
+    voodoo_jit_cache_log("Voodoo JIT cache: loaded %i blocks from %s\n", cache->loaded_entries, cache->path);
+
+    return cache;
+}
+
+void
+voodoo_jit_cache_close(voodoo_jit_cache_t *cache)
+{
+    if (!cache)
+        return;
+
+    if (cache->dirty)
+        voodoo_jit_cache_save(cache);
+
+    voodoo_jit_cache_log("Voodoo JIT cache: lookups=%" PRIu64 " hits=%" PRIu64 " rejects=%" PRIu64 " stores=%" PRIu64 " loaded=%i load_ticks=%" PRIu64 "\n",
+                         cache->lookups, cache->hits, cache->rejects, cache->stores, cache->loaded_entries, cache->load_ticks);
+
+    for (int c = 0; c < VOODOO_JIT_CACHE_MAX_OPEN; c++) {
+        if (open_caches[c] == cache)
+            open_caches[c] = NULL;
+    }
+
+    for (int c = 0; c < cache->nr_entries; c++) {
+        if (cache->entries[c].code_owned)
+            free(cache->entries[c].code);
+    }
+    free(cache->entries);
+    free(cache->image);
+    free(cache->hash);
+    free(cache);
+}
+
+const voodoo_jit_cache_entry_t *
+voodoo_jit_cache_find(voodoo_jit_cache_t *cache, const voodoo_jit_cache_key_t *key)
+{
+    int slot;
+
+    cache->lookups++;
+
+    slot = voodoo_jit_cache_slot(cache, key);
+    if (cache->hash[slot] < 0)
+        return NULL;
+
+    return &cache->entries[cache->hash[slot]];
+}
+
+void
+voodoo_jit_cache_store(voodoo_jit_cache_t *cache, const voodoo_jit_cache_key_t *key, const uint8_t *code, uint32_t code_size,
+                       const voodoo_jit_cache_reloc_t *relocs, uint32_t reloc_count)
+{
+    voodoo_jit_cache_entry_t *entry = NULL;
+    int                       slot;
+
+    if (reloc_count > VOODOO_JIT_CACHE_MAX_RELOCS || !code_size || code_size > cache->block_size)
+        return;
+
+    /*A stored block that failed to relocate is replaced by the fresh compile*/
+    slot = voodoo_jit_cache_slot(cache, key);
+    if (cache->hash[slot] >= 0) {
+        entry = &cache->entries[cache->hash[slot]];
+        if (entry->code_owned)
+            free(entry->code);
+    } else {
+        if (cache->nr_entries >= VOODOO_JIT_CACHE_MAX_ENTRIES)
+            return;
+        if (cache->nr_entries == cache->max_entries) {
+            cache->max_entries = cache->max_entries ? (cache->max_entries * 2) : 64;
+            cache->entries     = realloc(cache->entries, cache->max_entries * sizeof(voodoo_jit_cache_entry_t));
+        }
+        cache->hash[slot] = cache->nr_entries;
+        entry             = &cache->entries[cache->nr_entries++];
+    }
+
+    memset(entry, 0, sizeof(voodoo_jit_cache_entry_t));
+    entry->key         = *key;
+    entry->code_size   = code_size;
+    entry->reloc_count = reloc_count;
+    memcpy(entry->relocs, relocs, reloc_count * sizeof(voodoo_jit_cache_reloc_t));
+    entry->code       = malloc(code_size);
+    entry->code_owned = 1;
+    memcpy(entry->code, code, code_size);
+
+    cache->stores++;
+    cache->dirty = 1;
+}
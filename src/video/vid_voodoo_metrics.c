@@ -0,0 +1,231 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Per-frame Voodoo pipeline metrics.
+ *
+ *          The render, FIFO and JIT paths keep running totals in voodoo_t.
+ *          At each retrace that follows a buffer swap the totals are
+ *          snapshotted and the difference to the previous snapshot is
+ *          published as the card's last frame, for the status bar and the
+ *          VM manager to read. Setting VOODOO_METRICS_CSV to a file name
+ *          also appends every frame of every card to that file as CSV.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_metrics.h>
+
+typedef struct voodoo_metrics_slot_t {
+    voodoo_t        *voodoo; /*NULL if the slot is free*/
+    int              frame_count;
+    voodoo_metrics_t totals; /*running totals at the end of the last frame*/
+    voodoo_metrics_t last;   /*last complete frame, under metrics_mutex*/
+    int              valid;
+} voodoo_metrics_slot_t;
+
+static voodoo_metrics_slot_t metrics_slots[VOODOO_METRICS_CARDS];
+static mutex_t              *metrics_mutex;
+static FILE                 *metrics_csv;
+static int                   metrics_cards;
+
+static void
+voodoo_metrics_totals(voodoo_t *voodoo, voodoo_metrics_t *m)
+{
+    memset(m, 0, sizeof(voodoo_metrics_t));
+
+    m->triangles = (uint32_t) voodoo->tri_count;
+    for (int c = 0; c < 4; c++) {
+        /*Per-thread ints that wrap; frame deltas are taken modulo 2^32*/
+        m->pixels += (uint32_t) voodoo->pixel_count[c];
+        m->texels += (uint32_t) voodoo->texel_count[c];
+        m->jit_hits += voodoo->jit_hits[c];
+    }
+    m->jit_misses        = voodoo->jit_misses;
+    m->jit_compiles      = voodoo->jit_compiles;
+    m->jit_compile_ticks = voodoo->jit_compile_ticks;
+    m->tex_hits          = voodoo->texture_cache_hits;
+    m->tex_misses        = voodoo->texture_cache_misses;
+    m->tex_evictions     = voodoo->texture_cache_evictions;
+    m->fifo_stalls       = voodoo->fifo_full_waits;
+    m->fifo_stall_ticks  = voodoo->fifo_full_wait_ticks;
+    m->fifo_wakeups      = voodoo->fifo_wakeups;
+    m->lfb_syncs         = voodoo->readl_fb_sync_count;
+}
+
+static void
+voodoo_metrics_csv_row(int card, const voodoo_metrics_t *m)
+{
+    fprintf(metrics_csv, "%i,%" PRIu64 ",%u,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                         ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+            card, m->frame, m->time_ms, m->frame_ms, m->triangles, m->pixels, m->texels,
+            m->jit_hits, m->jit_misses, m->jit_compiles, m->jit_compile_ticks,
+            m->tex_hits, m->tex_misses, m->tex_evictions,
+            m->fifo_stalls, m->fifo_stall_ticks, m->fifo_wakeups, m->lfb_syncs);
+}
+
+void
+voodoo_metrics_init(voodoo_t *voodoo)
+{
+    const char *csv_env = getenv("VOODOO_METRICS_CSV");
+
+    voodoo->metrics_slot = -1;
+    if (!voodoo->metrics_enabled)
+        return;
+
+    /*Cards are created and destroyed on the emulation thread, so only the
+      readers need the mutex*/
+    if (!metrics_mutex)
+        metrics_mutex = thread_create_mutex();
+
+    for (int c = 0; c < VOODOO_METRICS_CARDS; c++) {
+        voodoo_metrics_slot_t *slot = &metrics_slots[c];
+
+        if (slot->voodoo)
+            continue;
+
+        thread_wait_mutex(metrics_mutex);
+        memset(slot, 0, sizeof(voodoo_metrics_slot_t));
+        slot->voodoo      = voodoo;
+        slot->frame_count = voodoo->frame_count;
+        voodoo_metrics_totals(voodoo, &slot->totals);
+        slot->totals.time_ms = plat_get_ticks();
+        thread_release_mutex(metrics_mutex);
+
+        voodoo->metrics_slot = c;
+        break;
+    }
+    if (voodoo->metrics_slot < 0)
+        return;
+
+    if (!metrics_cards++ && csv_env && *csv_env) {
+        metrics_csv = plat_fopen(csv_env, "w");
+        if (metrics_csv)
+            fprintf(metrics_csv, "card,frame,time_ms,frame_ms,triangles,pixels,texels,"
+                                 "jit_hits,jit_misses,jit_compiles,jit_compile_ticks,"
+                                 "tex_hits,tex_misses,tex_evictions,"
+                                 "fifo_stalls,fifo_stall_ticks,fifo_wakeups,lfb_syncs\n");
+        else
+            pclog("Voodoo metrics: can't open %s\n", csv_env);
+    }
+}
+
+void
+voodoo_metrics_close(voodoo_t *voodoo)
+{
+    if (voodoo->metrics_slot < 0)
+        return;
+
+    thread_wait_mutex(metrics_mutex);
+    metrics_slots[voodoo->metrics_slot].voodoo = NULL;
+    metrics_slots[voodoo->metrics_slot].valid  = 0;
+    thread_release_mutex(metrics_mutex);
+    voodoo->metrics_slot = -1;
+
+    if (!--metrics_cards && metrics_csv) {
+        fclose(metrics_csv);
+        metrics_csv = NULL;
+    }
+}
+
+/*Called at every retrace; closes a frame when the card has swapped since the
+  last one*/
+void
+voodoo_metrics_frame(voodoo_t *voodoo)
+{
+    voodoo_metrics_slot_t *slot;
+    voodoo_metrics_t       totals;
+    voodoo_metrics_t       m;
+
+    if (voodoo->metrics_slot < 0)
+        return;
+    slot = &metrics_slots[voodoo->metrics_slot];
+    if (voodoo->frame_count == slot->frame_count)
+        return;
+
+    voodoo_metrics_totals(voodoo, &totals);
+    totals.time_ms = plat_get_ticks();
+
+    m.frame             = slot->last.frame + (uint32_t) (voodoo->frame_count - slot->frame_count);
+    m.time_ms           = totals.time_ms;
+    m.frame_ms          = totals.time_ms - slot->totals.time_ms;
+    m.triangles         = (uint32_t) (totals.triangles - slot->totals.triangles);
+    m.pixels            = (uint32_t) (totals.pixels - slot->totals.pixels);
+    m.texels            = (uint32_t) (totals.texels - slot->totals.texels);
+    m.jit_hits          = totals.jit_hits - slot->totals.jit_hits;
+    m.jit_misses        = totals.jit_misses - slot->totals.jit_misses;
+    m.jit_compiles      = totals.jit_compiles - slot->totals.jit_compiles;
+    m.jit_compile_ticks = totals.jit_compile_ticks - slot->totals.jit_compile_ticks;
+    m.tex_hits          = totals.tex_hits - slot->totals.tex_hits;
+    m.tex_misses        = totals.tex_misses - slot->totals.tex_misses;
+    m.tex_evictions     = totals.tex_evictions - slot->totals.tex_evictions;
+    m.fifo_stalls       = totals.fifo_stalls - slot->totals.fifo_stalls;
+    m.fifo_stall_ticks  = totals.fifo_stall_ticks - slot->totals.fifo_stall_ticks;
+    m.fifo_wakeups      = totals.fifo_wakeups - slot->totals.fifo_wakeups;
+    m.lfb_syncs         = totals.lfb_syncs - slot->totals.lfb_syncs;
+
+    slot->frame_count = voodoo->frame_count;
+    slot->totals      = totals;
+
+    thread_wait_mutex(metrics_mutex);
+    slot->last  = m;
+    slot->valid = 1;
+    if (metrics_csv)
+        voodoo_metrics_csv_row(voodoo->metrics_slot, &m);
+    thread_release_mutex(metrics_mutex);
+}
+
+int
+voodoo_metrics_get(int card, voodoo_metrics_t *out)
+{
+    int ret = 0;
+
+    if (!metrics_mutex || card < 0 || card >= VOODOO_METRICS_CARDS)
+        return 0;
+
+    thread_wait_mutex(metrics_mutex);
+    if (metrics_slots[card].voodoo && metrics_slots[card].valid) {
+        *out = metrics_slots[card].last;
+        ret  = 1;
+    }
+    thread_release_mutex(metrics_mutex);
+
+    return ret;
+}
+
+/*One-line summary for the status bar*/
+int
+voodoo_metrics_format(const voodoo_metrics_t *m, char *buf, int len)
+{
+    uint64_t jit_lookups = m->jit_hits + m->jit_misses;
+    uint64_t tex_lookups = m->tex_hits + m->tex_misses;
+
+    return snprintf(buf, len,
+                    "Voodoo frame %" PRIu64 ": %u ms, %" PRIu64 " tris, %" PRIu64 " px, %" PRIu64 " texels, "
+                    "JIT %" PRIu64 "%% hit (%" PRIu64 " compiled), tex cache %" PRIu64 "%% hit (%" PRIu64 " evicted), "
+                    "%" PRIu64 " FIFO stalls, %" PRIu64 " FIFO wakeups, %" PRIu64 " LFB syncs",
+                    m->frame, m->frame_ms, m->triangles, m->pixels, m->texels,
+                    jit_lookups ? (m->jit_hits * 100) / jit_lookups : 100, m->jit_compiles,
+                    tex_lookups ? (m->tex_hits * 100) / tex_lookups : 100, m->tex_evictions,
+                    m->fifo_stalls, m->fifo_wakeups, m->lfb_syncs);
+}
@@ -96,6 +96,7 @@ voodoo_reg_writel(uint32_t addr, uint32_t val, void *priv)
         addr |= 0x400;
     switch (addr) {
         case SST_swapbufferCMD:
+            voodoo->swapbuffer_count++;
             if (voodoo->type >= VOODOO_BANSHEE) {
 #if 0
                 voodoo_reg_log("swapbufferCMD %08x %08x\n", val, voodoo->leftOverlayBuf);
@@ -588,8 +589,12 @@ voodoo_reg_writel(uint32_t addr, uint32_t val, void *priv)
             voodoo->fbiPixelsOut  = 0;
             break;
         case SST_fastfillCMD:
-            voodoo_wait_for_render_thread_idle(voodoo);
-            voodoo_fastfill(voodoo, &voodoo->params);
+            if (voodoo->fastfill_bands_enabled)
+                voodoo_queue_fastfill(voodoo, &voodoo->params);
+            else {
+                voodoo_wait_for_render_thread_idle(voodoo);
+                voodoo_fastfill(voodoo, &voodoo->params);
+            }
             voodoo->cmd_read++;
             break;
 
@@ -812,66 +817,13 @@ voodoo_reg_writel(uint32_t addr, uint32_t val, void *priv)
 #if 0
             voodoo_reg_log("sBeginTriCMD %i %f\n", voodoo->vertex_num, voodoo->verts[4].sVx);
 #endif
-            voodoo->verts[0]        = voodoo->verts[3];
-            voodoo->verts[1]        = voodoo->verts[3];
-            voodoo->verts[2]        = voodoo->verts[3];
-            voodoo->vertex_next_age = 0;
-            voodoo->vertex_ages[0]  = voodoo->vertex_next_age++;
-
-            voodoo->num_verticies = 1;
-            voodoo->cull_pingpong = 0;
+            voodoo_setup_begin_tri(voodoo);
             break;
         case SST_sDrawTriCMD:
 #if 0
             voodoo_reg_log("sDrawTriCMD %i %i\n", voodoo->num_verticies, voodoo->sSetupMode & SETUPMODE_STRIP_MODE);
 #endif
-            /*I'm not sure this is the vertex selection algorithm actually used in the 3dfx
-              chips, but this works with a number of games that switch between strip and fan
-              mode in the middle of a run (eg Black & White, Viper Racing)*/
-            if (voodoo->vertex_next_age < 3) {
-                /*Fewer than three vertices already written, store in next slot*/
-                int vertex_nr = voodoo->vertex_next_age;
-
-                voodoo->verts[vertex_nr]       = voodoo->verts[3];
-                voodoo->vertex_ages[vertex_nr] = voodoo->vertex_next_age++;
-            } else {
-                int vertex_nr = 0;
-
-                if (!(voodoo->sSetupMode & SETUPMODE_STRIP_MODE)) {
-                    /*Strip - find oldest vertex*/
-                    if ((voodoo->vertex_ages[0] < voodoo->vertex_ages[1]) && (voodoo->vertex_ages[0] < voodoo->vertex_ages[2]))
-                        vertex_nr = 0;
-                    else if ((voodoo->vertex_ages[1] < voodoo->vertex_ages[0]) && (voodoo->vertex_ages[1] < voodoo->vertex_ages[2]))
-                        vertex_nr = 1;
-                    else
-                        vertex_nr = 2;
-                } else {
-                    /*Fan - find second oldest vertex (ie pivot around oldest)*/
-                    if ((voodoo->vertex_ages[1] < voodoo->vertex_ages[0]) && (voodoo->vertex_ages[0] < voodoo->vertex_ages[2]))
-                        vertex_nr = 0;
-                    else if ((voodoo->vertex_ages[2] < voodoo->vertex_ages[0]) && (voodoo->vertex_ages[0] < voodoo->vertex_ages[1]))
-                        vertex_nr = 0;
-                    else if ((voodoo->vertex_ages[0] < voodoo->vertex_ages[1]) && (voodoo->vertex_ages[1] < voodoo->vertex_ages[2]))
-                        vertex_nr = 1;
-                    else if ((voodoo->vertex_ages[2] < voodoo->vertex_ages[1]) && (voodoo->vertex_ages[1] < voodoo->vertex_ages[0]))
-                        vertex_nr = 1;
-                    else
-                        vertex_nr = 2;
-                }
-                voodoo->verts[vertex_nr]       = voodoo->verts[3];
-                voodoo->vertex_ages[vertex_nr] = voodoo->vertex_next_age++;
-            }
-
-            voodoo->num_verticies++;
-            if (voodoo->num_verticies == 3) {
-#if 0
-                voodoo_reg_log("triangle_setup\n");
-#endif
-                voodoo_triangle_setup(voodoo);
-                voodoo->cull_pingpong = !voodoo->cull_pingpong;
-
-                voodoo->num_verticies = 2;
-            }
+            voodoo_setup_draw_tri(voodoo);
             break;
 
         case SST_bltSrcBaseAddr:
@@ -36,9 +36,11 @@
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_blitter.h>
 #include <86box/vid_voodoo_dither.h>
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
+#include <86box/vid_voodoo_simd.h>
 #include <86box/vid_voodoo_texture.h>
 
 
@@ -667,6 +669,778 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 int voodoo_recomp = 0;
 #endif
 
+/*Step the per-line interpolants and edges down by dy lines*/
+static inline void
+voodoo_advance_lines(voodoo_params_t *params, voodoo_state_t *state, int dy)
+{
+    state->base_r += params->dRdY * dy;
+    state->base_g += params->dGdY * dy;
+    state->base_b += params->dBdY * dy;
+    state->base_a += params->dAdY * dy;
+    state->base_z += params->dZdY * dy;
+    state->tmu[0].base_s += params->tmu[0].dSdY * dy;
+    state->tmu[0].base_t += params->tmu[0].dTdY * dy;
+    state->tmu[0].base_w += params->tmu[0].dWdY * dy;
+    state->tmu[1].base_s += params->tmu[1].dSdY * dy;
+    state->tmu[1].base_t += params->tmu[1].dTdY * dy;
+    state->tmu[1].base_w += params->tmu[1].dWdY * dy;
+    state->base_w += params->dWdY * dy;
+    state->xstart += state->dx1 * dy;
+    state->xend += state->dx2 * dy;
+}
+
+#ifndef NO_CODEGEN
+/*Differential JIT verifier (VOODOO_JIT_VERIFY=n).
+
+  Every nth span a render thread would hand to the JIT is drawn by the JIT,
+  its output copied aside, and the span's pixels and the whole of
+  voodoo_state_t put back. The scalar interpreter then draws the span for
+  real and the two results are compared pixel by pixel. Restoring all of the
+  state, rather than the iterators alone, means any difference is the JIT's;
+  and because the framebuffer keeps the interpreter's output, one bad pixel
+  is reported once instead of leaking into the spans blended over it.*/
+#    define VOODOO_VERIFY_MAX_SPAN 4096
+#    define VOODOO_VERIFY_MAX_LOG  64
+
+typedef uint8_t (*voodoo_draw_func_t)(voodoo_state_t *state, voodoo_params_t *params, int x, int real_y);
+
+static inline int
+voodoo_verify_offset(int x, int tiled)
+{
+    return tiled ? ((x & 63) | ((x >> 6) * 128 * 32 / 2)) : x;
+}
+
+/*Run the JIT over the span and keep its output. Returns 0, having drawn
+  nothing, if the span can't be verified. The per-thread buffer holds the
+  original colour and aux pixels, then the JIT's.*/
+static int
+voodoo_verify_jit_span(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, voodoo_draw_func_t voodoo_draw,
+                       int odd_even, int x, int x2, int real_y)
+{
+    voodoo_state_t saved;
+    uint16_t      *buf = voodoo->jit_verify_buf[odd_even];
+    int            x0  = (x < x2) ? x : x2;
+    int            n   = ((x < x2) ? (x2 - x) : (x - x2)) + 1;
+
+    if (x0 < 0 || n > VOODOO_VERIFY_MAX_SPAN)
+        return 0;
+    if (!buf) {
+        buf = malloc(4 * VOODOO_VERIFY_MAX_SPAN * sizeof(uint16_t));
+        voodoo->jit_verify_buf[odd_even] = buf;
+    }
+
+    for (int c = 0; c < n; c++) {
+        buf[c]                          = state->fb_mem[voodoo_verify_offset(x0 + c, params->col_tiled)];
+        buf[VOODOO_VERIFY_MAX_SPAN + c] = state->aux_mem[voodoo_verify_offset(x0 + c, params->aux_tiled)];
+    }
+    saved = *state;
+
+    voodoo_draw(state, params, x, real_y);
+
+    for (int c = 0; c < n; c++) {
+        uint16_t *fb  = &state->fb_mem[voodoo_verify_offset(x0 + c, params->col_tiled)];
+        uint16_t *aux = &state->aux_mem[voodoo_verify_offset(x0 + c, params->aux_tiled)];
+
+        buf[2 * VOODOO_VERIFY_MAX_SPAN + c] = *fb;
+        buf[3 * VOODOO_VERIFY_MAX_SPAN + c] = *aux;
+        *fb                                 = buf[c];
+        *aux                                = buf[VOODOO_VERIFY_MAX_SPAN + c];
+    }
+    *state = saved;
+
+    return 1;
+}
+
+/*Compare the interpreter's output for the span with the JIT's*/
+static void
+voodoo_verify_jit_compare(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even, int x, int x2, int real_y)
+{
+    const uint16_t *buf   = voodoo->jit_verify_buf[odd_even];
+    int             x0    = (x < x2) ? x : x2;
+    int             n     = ((x < x2) ? (x2 - x) : (x - x2)) + 1;
+    int             first = -1;
+    int             diffs = 0;
+
+    for (int c = 0; c < n; c++) {
+        if (state->fb_mem[voodoo_verify_offset(x0 + c, params->col_tiled)] != buf[2 * VOODOO_VERIFY_MAX_SPAN + c]
+            || state->aux_mem[voodoo_verify_offset(x0 + c, params->aux_tiled)] != buf[3 * VOODOO_VERIFY_MAX_SPAN + c]) {
+            if (first < 0)
+                first = c;
+            diffs++;
+        }
+    }
+
+    voodoo->jit_verify_spans[odd_even]++;
+    if (!diffs)
+        return;
+    voodoo->jit_verify_mismatches[odd_even]++;
+
+    /*Racy between render threads, it only bounds the log*/
+    if (voodoo->jit_verify_logged >= VOODOO_VERIFY_MAX_LOG)
+        return;
+    if (++voodoo->jit_verify_logged == VOODOO_VERIFY_MAX_LOG)
+        pclog("Voodoo JIT verify: further mismatches are counted but not logged\n");
+
+    pclog("Voodoo JIT verify: y=%i x=%i..%i, %i of %i pixels differ, first at x=%i:"
+          " colour JIT %04x C %04x, %s JIT %04x C %04x\n",
+          real_y, x, x2, diffs, n, x0 + first,
+          buf[2 * VOODOO_VERIFY_MAX_SPAN + first], state->fb_mem[voodoo_verify_offset(x0 + first, params->col_tiled)],
+          (params->fbzMode & FBZ_ALPHA_ENABLE) ? "alpha" : "depth",
+          buf[3 * VOODOO_VERIFY_MAX_SPAN + first], state->aux_mem[voodoo_verify_offset(x0 + first, params->aux_tiled)]);
+    pclog("  key: xdir=%i fbzMode=%08x fbzColorPath=%08x alphaMode=%08x fogMode=%08x"
+          " textureMode=%08x/%08x tLOD=%08x/%08x trexInit1=%x tiled=%i\n",
+          state->xdir, params->fbzMode, params->fbzColorPath, params->alphaMode, params->fogMode,
+          params->textureMode[0], params->textureMode[1], params->tLOD[0] & LOD_MASK, params->tLOD[1] & LOD_MASK,
+          (voodoo->trexInit1[0] >> 18) & 1, (params->col_tiled || params->aux_tiled) ? 1 : 0);
+}
+#endif
+
+/*Vectorised interpreter span.
+
+  Runs the pixel pipeline four pixels at a time on voodoo_v4i_t lanes:
+  depth test, colour/alpha combine, fog, alpha test and alpha blend are
+  done on all lanes at once, while the parts that are inherently per
+  pixel - 64-bit W/S/T iteration, texture fetch, fog table lookup and the
+  dither tables - stay in small scalar loops around them. Results and
+  statistics match the scalar loop in voodoo_half_triangle() exactly.
+
+  States the vector path doesn't model (stipple, chroma key, alpha mask,
+  LFB colour select, per-pixel local select override, the TMU config
+  readback and the encodings the scalar path treats as fatal) are
+  rejected per triangle by voodoo_simd_span_ok() and use the scalar loop.*/
+static int
+voodoo_simd_span_ok(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    if (!voodoo->simd_span_enabled)
+        return 0;
+    if (params->fbzMode & (FBZ_STIPPLE | FBZ_CHROMAKEY | FBZ_ALPHA_MASK))
+        return 0;
+    if (cc_localselect_override || _rgb_sel == CC_LOCALSELECT_LFB)
+        return 0;
+    if (voodoo->trexInit1[0] & (1 << 18))
+        return 0;
+    if (cca_localselect > CCA_LOCALSELECT_ITER_Z || a_sel > A_SEL_COLOR1 || cc_mselect > CC_MSELECT_TEXRGB
+        || cca_mselect > CCA_MSELECT_TEX || cc_add == 3)
+        return 0;
+
+    return 1;
+}
+
+/*Lane mask of `a <op> b` for the shared DEPTHOP_x / AFUNC_x encoding*/
+static inline voodoo_v4i_t
+voodoo_simd_compare(int op, voodoo_v4i_t a, voodoo_v4i_t b)
+{
+    const voodoo_v4i_t ones = voodoo_v4i_set1(-1);
+
+    switch (op) {
+        case DEPTHOP_NEVER:
+            return voodoo_v4i_set1(0);
+        case DEPTHOP_LESSTHAN:
+            return voodoo_v4i_cmpgt(b, a);
+        case DEPTHOP_EQUAL:
+            return voodoo_v4i_cmpeq(a, b);
+        case DEPTHOP_LESSTHANEQUAL:
+            return voodoo_v4i_xor(voodoo_v4i_cmpgt(a, b), ones);
+        case DEPTHOP_GREATERTHAN:
+            return voodoo_v4i_cmpgt(a, b);
+        case DEPTHOP_NOTEQUAL:
+            return voodoo_v4i_xor(voodoo_v4i_cmpeq(a, b), ones);
+        case DEPTHOP_GREATERTHANEQUAL:
+            return voodoo_v4i_xor(voodoo_v4i_cmpgt(b, a), ones);
+        default:
+            return ones;
+    }
+}
+
+static const uint8_t voodoo_simd_popcount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+/*Colour factor of an alpha blend function. `dest_a` and `src_a` are the
+  alpha values, `col` the opposing colour channel, `fog` the colour before
+  fog. Returns -1 in every lane for AFUNC_AONE (no scaling).*/
+static inline voodoo_v4i_t
+voodoo_simd_blend_factor(int afunc, voodoo_v4i_t src_a, voodoo_v4i_t dest_a, voodoo_v4i_t col, voodoo_v4i_t fog)
+{
+    const voodoo_v4i_t c255 = voodoo_v4i_set1(0xff);
+
+    switch (afunc) {
+        case AFUNC_ASRC_ALPHA:
+            return src_a;
+        case AFUNC_A_COLOR:
+            return col;
+        case AFUNC_ADST_ALPHA:
+            return dest_a;
+        case AFUNC_AONE:
+            return voodoo_v4i_set1(-1);
+        case AFUNC_AOMSRC_ALPHA:
+            return voodoo_v4i_sub(c255, src_a);
+        case AFUNC_AOM_COLOR:
+            return voodoo_v4i_sub(c255, col);
+        case AFUNC_AOMDST_ALPHA:
+            return voodoo_v4i_sub(c255, dest_a);
+        case AFUNC_ACOLORBEFOREFOG:
+            return fog;
+        default:
+            return voodoo_v4i_set1(0);
+    }
+}
+
+static inline voodoo_v4i_t
+voodoo_simd_blend_scale(voodoo_v4i_t c, voodoo_v4i_t factor, int afunc)
+{
+    if (afunc == AFUNC_AONE)
+        return c;
+    return voodoo_v4i_div255(voodoo_v4i_mul(c, factor));
+}
+
+static void
+voodoo_simd_span(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int x, int x2, int real_y,
+                 uint16_t *fb_mem, uint16_t *aux_mem, int odd_even, int texels)
+{
+    static const int32_t lane_index[VOODOO_SIMD_LANES] = { 0, 1, 2, 3 };
+    const voodoo_v4i_t   c255                          = voodoo_v4i_set1(0xff);
+    const int            xdir                          = state->xdir;
+    int                  left                          = ((x2 - x) * xdir) + 1;
+    const int            tex_fetch                     = params->fbzColorPath & FBZCP_TEXTURE_ENABLED;
+    const int            fog_table                     = (params->fogMode & (FOG_ENABLE | FOG_CONSTANT)) == FOG_ENABLE;
+    const int            blend                         = params->alphaMode & (1 << 4);
+    const int            blend_dithersub               = blend && dithersub && voodoo->dithersub_enabled;
+    const int            need_w_depth                  = (params->fbzMode & FBZ_W_BUFFER) || (fog_table && !(params->fogMode & (FOG_Z | FOG_ALPHA)));
+    const voodoo_v4i_t   lanes                         = voodoo_v4i_load(lane_index);
+    const voodoo_v4i_t   step_r                        = voodoo_v4i_mul(lanes, voodoo_v4i_set1(params->dRdX * xdir));
+    const voodoo_v4i_t   step_g                        = voodoo_v4i_mul(lanes, voodoo_v4i_set1(params->dGdX * xdir));
+    const voodoo_v4i_t   step_b                        = voodoo_v4i_mul(lanes, voodoo_v4i_set1(params->dBdX * xdir));
+    const voodoo_v4i_t   step_a                        = voodoo_v4i_mul(lanes, voodoo_v4i_set1(params->dAdX * xdir));
+    const voodoo_v4i_t   step_z                        = voodoo_v4i_mul(lanes, voodoo_v4i_set1(params->dZdX * xdir));
+
+    while (left) {
+        const int n = (left < VOODOO_SIMD_LANES) ? left : VOODOO_SIMD_LANES;
+        int32_t   lx[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_z[VOODOO_SIMD_LANES], l_ia[VOODOO_SIMD_LANES];
+        int32_t   l_w_depth[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_old_depth[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_dat[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_dest_a[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_tex_r[VOODOO_SIMD_LANES] = { 0 }, l_tex_g[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_tex_b[VOODOO_SIMD_LANES] = { 0 }, l_tex_a[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_fog_a[VOODOO_SIMD_LANES] = { 0 };
+        int32_t   l_r[VOODOO_SIMD_LANES], l_g[VOODOO_SIMD_LANES], l_b[VOODOO_SIMD_LANES], l_a[VOODOO_SIMD_LANES];
+        int32_t   l_dest_r[VOODOO_SIMD_LANES], l_dest_g[VOODOO_SIMD_LANES], l_dest_b[VOODOO_SIMD_LANES];
+        int32_t   l_new_depth[VOODOO_SIMD_LANES];
+        int64_t   start_tmu0_s = state->tmu0_s, start_tmu0_t = state->tmu0_t, start_tmu0_w = state->tmu0_w;
+        int64_t   start_tmu1_s = state->tmu1_s, start_tmu1_t = state->tmu1_t, start_tmu1_w = state->tmu1_w;
+        int64_t   start_w = state->w;
+        voodoo_v4i_t ir, ig, ib, ia, z;
+        voodoo_v4i_t live;
+        voodoo_v4i_t new_depth;
+        voodoo_v4i_t dest_r, dest_g, dest_b, dest_a;
+        voodoo_v4i_t clocal_r, clocal_g, clocal_b, alocal;
+        voodoo_v4i_t cother_r, cother_g, cother_b, aother;
+        voodoo_v4i_t tex_r, tex_g, tex_b, tex_a;
+        voodoo_v4i_t iter_r, iter_g, iter_b, iter_a;
+        voodoo_v4i_t src_r, src_g, src_b, src_a;
+        voodoo_v4i_t msel_r, msel_g, msel_b, msel_a;
+        voodoo_v4i_t colbfog_r, colbfog_g, colbfog_b;
+        int          live_bits;
+
+        /*The 32-bit iterators step in vector form*/
+        ir = voodoo_v4i_add(voodoo_v4i_set1(state->ir), step_r);
+        ig = voodoo_v4i_add(voodoo_v4i_set1(state->ig), step_g);
+        ib = voodoo_v4i_add(voodoo_v4i_set1(state->ib), step_b);
+        ia = voodoo_v4i_add(voodoo_v4i_set1(state->ia), step_a);
+        z  = voodoo_v4i_add(voodoo_v4i_set1(state->z), step_z);
+
+        /*Gather: W depth and framebuffer reads*/
+        for (int l = 0; l < n; l++) {
+            int x_tiled = (x & 63) | ((x >> 6) * 128 * 32 / 2);
+
+            lx[l] = x;
+
+            if (need_w_depth) {
+                int64_t w = start_w + params->dWdX * xdir * l;
+
+                if (w & 0xffff00000000)
+                    l_w_depth[l] = 0;
+                else if (!(w & 0xffff0000))
+                    l_w_depth[l] = 0xf001;
+                else {
+                    int exp      = voodoo_fls((uint16_t) ((uint32_t) w >> 16));
+                    int mant     = (~(uint32_t) w >> (19 - exp)) & 0xfff;
+                    l_w_depth[l] = (exp << 12) + mant + 1;
+                    if (l_w_depth[l] > 0xffff)
+                        l_w_depth[l] = 0xffff;
+                }
+            }
+
+            if (params->fbzMode & FBZ_DEPTH_ENABLE)
+                l_old_depth[l] = voodoo->params.aux_tiled ? aux_mem[x_tiled] : aux_mem[x];
+            if (blend) {
+                l_dat[l] = voodoo->params.col_tiled ? fb_mem[x_tiled] : fb_mem[x];
+                if (params->fbzMode & FBZ_ALPHA_ENABLE)
+                    l_dest_a[l] = (voodoo->params.aux_tiled ? aux_mem[x_tiled] : aux_mem[x]) & 0xff;
+                else
+                    l_dest_a[l] = 0xff;
+            }
+
+            x += xdir;
+        }
+
+        state->ir += params->dRdX * xdir * n;
+        state->ig += params->dGdX * xdir * n;
+        state->ib += params->dBdX * xdir * n;
+        state->ia += params->dAdX * xdir * n;
+        state->z += params->dZdX * xdir * n;
+        state->tmu0_s += params->tmu[0].dSdX * xdir * n;
+        state->tmu0_t += params->tmu[0].dTdX * xdir * n;
+        state->tmu0_w += params->tmu[0].dWdX * xdir * n;
+        state->tmu1_s += params->tmu[1].dSdX * xdir * n;
+        state->tmu1_t += params->tmu[1].dTdX * xdir * n;
+        state->tmu1_w += params->tmu[1].dWdX * xdir * n;
+        state->w += params->dWdX * xdir * n;
+
+        voodoo->pixel_count[odd_even] += n;
+        voodoo->texel_count[odd_even] += n * texels;
+        voodoo->fbiPixelsIn += n;
+        voodoo->simd_span_pixels[odd_even] += n;
+
+        live = voodoo_v4i_cmpgt(voodoo_v4i_set1(n), lanes);
+
+        /*Depth test*/
+        if (params->fbzMode & FBZ_W_BUFFER)
+            new_depth = voodoo_v4i_load(l_w_depth);
+        else
+            new_depth = voodoo_v4i_clamp16(voodoo_v4i_srai(z, 12));
+        if (params->fbzMode & FBZ_DEPTH_BIAS)
+            new_depth = voodoo_v4i_clamp16(voodoo_v4i_add(new_depth, voodoo_v4i_set1((int16_t) params->zaColor)));
+
+        if (params->fbzMode & FBZ_DEPTH_ENABLE) {
+            voodoo_v4i_t comp_depth = (params->fbzMode & FBZ_DEPTH_SOURCE) ? voodoo_v4i_set1(params->zaColor & 0xffff) : new_depth;
+            voodoo_v4i_t pass       = voodoo_simd_compare(depth_op, comp_depth, voodoo_v4i_load(l_old_depth));
+
+            voodoo->fbiZFuncFail += voodoo_simd_popcount[voodoo_v4i_movemask(voodoo_v4i_andnot(live, pass))];
+            live = voodoo_v4i_and(live, pass);
+        }
+        live_bits = voodoo_v4i_movemask(live);
+        if (!live_bits) {
+            left -= n;
+            continue;
+        }
+
+        /*Texture fetch and fog table lookups for the surviving lanes. The
+          fetch reads the TMU iterators from state, so park the lane values
+          there and restore the end-of-group values afterwards.*/
+        if (tex_fetch || fog_table) {
+            int64_t end_tmu0_s = state->tmu0_s, end_tmu0_t = state->tmu0_t, end_tmu0_w = state->tmu0_w;
+            int64_t end_tmu1_s = state->tmu1_s, end_tmu1_t = state->tmu1_t, end_tmu1_w = state->tmu1_w;
+
+            if (fog_table) {
+                voodoo_v4i_store(l_z, z);
+                voodoo_v4i_store(l_ia, ia);
+            }
+
+            for (int l = 0; l < n; l++) {
+                if (!(live_bits & (1 << l)))
+                    continue;
+
+                if (tex_fetch) {
+                    state->x      = lx[l];
+                    state->tmu0_s = start_tmu0_s + params->tmu[0].dSdX * xdir * l;
+                    state->tmu0_t = start_tmu0_t + params->tmu[0].dTdX * xdir * l;
+                    state->tmu0_w = start_tmu0_w + params->tmu[0].dWdX * xdir * l;
+                    state->tmu1_s = start_tmu1_s + params->tmu[1].dSdX * xdir * l;
+                    state->tmu1_t = start_tmu1_t + params->tmu[1].dTdX * xdir * l;
+                    state->tmu1_w = start_tmu1_w + params->tmu[1].dWdX * xdir * l;
+
+                    if ((params->textureMode[0] & TEXTUREMODE_LOCAL_MASK) == TEXTUREMODE_LOCAL || !voodoo->dual_tmus) {
+                        voodoo_tmu_fetch(voodoo, params, state, 0, lx[l]);
+                    } else if ((params->textureMode[0] & TEXTUREMODE_MASK) == TEXTUREMODE_PASSTHROUGH) {
+                        voodoo_tmu_fetch(voodoo, params, state, 1, lx[l]);
+
+                        state->tex_r[0] = state->tex_r[1];
+                        state->tex_g[0] = state->tex_g[1];
+                        state->tex_b[0] = state->tex_b[1];
+                        state->tex_a[0] = state->tex_a[1];
+                    } else {
+                        voodoo_tmu_fetch_and_blend(voodoo, params, state, lx[l]);
+                    }
+                }
+
+                if (fog_table) {
+                    switch (params->fogMode & (FOG_Z | FOG_ALPHA)) {
+                        case 0:
+                            {
+                                int fog_idx = (l_w_depth[l] >> 10) & 0x3f;
+
+                                l_fog_a[l] = params->fogTable[fog_idx].fog;
+                                l_fog_a[l] += (params->fogTable[fog_idx].dfog * ((l_w_depth[l] >> 2) & 0xff)) >> 10;
+                            }
+                            break;
+                        case FOG_Z:
+                            l_fog_a[l] = (l_z[l] >> 20) & 0xff;
+                            break;
+                        case FOG_ALPHA:
+                            l_fog_a[l] = CLAMP(l_ia[l] >> 12);
+                            break;
+                        case FOG_W:
+                            l_fog_a[l] = CLAMP(((start_w + params->dWdX * xdir * l) >> 32) & 0xff);
+                            break;
+                    }
+                }
+
+                l_tex_r[l] = state->tex_r[0];
+                l_tex_g[l] = state->tex_g[0];
+                l_tex_b[l] = state->tex_b[0];
+                l_tex_a[l] = state->tex_a[0];
+            }
+
+            state->tmu0_s = end_tmu0_s;
+            state->tmu0_t = end_tmu0_t;
+            state->tmu0_w = end_tmu0_w;
+            state->tmu1_s = end_tmu1_s;
+            state->tmu1_t = end_tmu1_t;
+            state->tmu1_w = end_tmu1_w;
+        }
+        state->x = lx[n - 1];
+
+        if (tex_fetch) {
+            tex_r = voodoo_v4i_load(l_tex_r);
+            tex_g = voodoo_v4i_load(l_tex_g);
+            tex_b = voodoo_v4i_load(l_tex_b);
+            tex_a = voodoo_v4i_load(l_tex_a);
+        } else {
+            /*As in the scalar loop, an untextured triangle sees whatever the
+              last fetch left behind*/
+            tex_r = voodoo_v4i_set1(state->tex_r[0]);
+            tex_g = voodoo_v4i_set1(state->tex_g[0]);
+            tex_b = voodoo_v4i_set1(state->tex_b[0]);
+            tex_a = voodoo_v4i_set1(state->tex_a[0]);
+        }
+
+        /*Colour and alpha combine*/
+        iter_r = voodoo_v4i_clamp8(voodoo_v4i_srai(ir, 12));
+        iter_g = voodoo_v4i_clamp8(voodoo_v4i_srai(ig, 12));
+        iter_b = voodoo_v4i_clamp8(voodoo_v4i_srai(ib, 12));
+        iter_a = voodoo_v4i_clamp8(voodoo_v4i_srai(ia, 12));
+
+        if (cc_localselect) {
+            clocal_r = voodoo_v4i_set1((params->color0 >> 16) & 0xff);
+            clocal_g = voodoo_v4i_set1((params->color0 >> 8) & 0xff);
+            clocal_b = voodoo_v4i_set1(params->color0 & 0xff);
+        } else {
+            clocal_r = iter_r;
+            clocal_g = iter_g;
+            clocal_b = iter_b;
+        }
+
+        switch (_rgb_sel) {
+            case CC_LOCALSELECT_TEX:
+                cother_r = tex_r;
+                cother_g = tex_g;
+                cother_b = tex_b;
+                break;
+            case CC_LOCALSELECT_COLOR1:
+                cother_r = voodoo_v4i_set1((params->color1 >> 16) & 0xff);
+                cother_g = voodoo_v4i_set1((params->color1 >> 8) & 0xff);
+                cother_b = voodoo_v4i_set1(params->color1 & 0xff);
+                break;
+            default:
+                cother_r = iter_r;
+                cother_g = iter_g;
+                cother_b = iter_b;
+                break;
+        }
+
+        switch (cca_localselect) {
+            case CCA_LOCALSELECT_COLOR0:
+                alocal = voodoo_v4i_set1((params->color0 >> 24) & 0xff);
+                break;
+            case CCA_LOCALSELECT_ITER_Z:
+                alocal = voodoo_v4i_clamp8(voodoo_v4i_srai(z, 20));
+                break;
+            default:
+                alocal = iter_a;
+                break;
+        }
+
+        switch (a_sel) {
+            case A_SEL_TEX:
+                aother = tex_a;
+                break;
+            case A_SEL_COLOR1:
+                aother = voodoo_v4i_set1((params->color1 >> 24) & 0xff);
+                break;
+            default:
+                aother = iter_a;
+                break;
+        }
+
+        src_r = cc_zero_other ? voodoo_v4i_set1(0) : cother_r;
+        src_g = cc_zero_other ? voodoo_v4i_set1(0) : cother_g;
+        src_b = cc_zero_other ? voodoo_v4i_set1(0) : cother_b;
+        src_a = cca_zero_other ? voodoo_v4i_set1(0) : aother;
+
+        if (cc_sub_clocal) {
+            src_r = voodoo_v4i_sub(src_r, clocal_r);
+            src_g = voodoo_v4i_sub(src_g, clocal_g);
+            src_b = voodoo_v4i_sub(src_b, clocal_b);
+        }
+        if (cca_sub_clocal)
+            src_a = voodoo_v4i_sub(src_a, alocal);
+
+        switch (cc_mselect) {
+            case CC_MSELECT_CLOCAL:
+                msel_r = clocal_r;
+                msel_g = clocal_g;
+                msel_b = clocal_b;
+                break;
+            case CC_MSELECT_AOTHER:
+                msel_r = msel_g = msel_b = aother;
+                break;
+            case CC_MSELECT_ALOCAL:
+                msel_r = msel_g = msel_b = alocal;
+                break;
+            case CC_MSELECT_TEX:
+                msel_r = msel_g = msel_b = tex_a;
+                break;
+            case CC_MSELECT_TEXRGB:
+                msel_r = tex_r;
+                msel_g = tex_g;
+                msel_b = tex_b;
+                break;
+            default:
+                msel_r = msel_g = msel_b = voodoo_v4i_set1(0);
+                break;
+        }
+
+        switch (cca_mselect) {
+            case CCA_MSELECT_ALOCAL:
+            case CCA_MSELECT_ALOCAL2:
+                msel_a = alocal;
+                break;
+            case CCA_MSELECT_AOTHER:
+                msel_a = aother;
+                break;
+            case CCA_MSELECT_TEX:
+                msel_a = tex_a;
+                break;
+            default:
+                msel_a = voodoo_v4i_set1(0);
+                break;
+        }
+
+        if (!cc_reverse_blend) {
+            msel_r = voodoo_v4i_xor(msel_r, c255);
+            msel_g = voodoo_v4i_xor(msel_g, c255);
+            msel_b = voodoo_v4i_xor(msel_b, c255);
+        }
+        if (!cca_reverse_blend)
+            msel_a = voodoo_v4i_xor(msel_a, c255);
+
+        src_r = voodoo_v4i_srai(voodoo_v4i_mul(src_r, voodoo_v4i_add(msel_r, voodoo_v4i_set1(1))), 8);
+        src_g = voodoo_v4i_srai(voodoo_v4i_mul(src_g, voodoo_v4i_add(msel_g, voodoo_v4i_set1(1))), 8);
+        src_b = voodoo_v4i_srai(voodoo_v4i_mul(src_b, voodoo_v4i_add(msel_b, voodoo_v4i_set1(1))), 8);
+        src_a = voodoo_v4i_srai(voodoo_v4i_mul(src_a, voodoo_v4i_add(msel_a, voodoo_v4i_set1(1))), 8);
+
+        if (cc_add == CC_ADD_CLOCAL) {
+            src_r = voodoo_v4i_add(src_r, clocal_r);
+            src_g = voodoo_v4i_add(src_g, clocal_g);
+            src_b = voodoo_v4i_add(src_b, clocal_b);
+        } else if (cc_add == CC_ADD_ALOCAL) {
+            src_r = voodoo_v4i_add(src_r, alocal);
+            src_g = voodoo_v4i_add(src_g, alocal);
+            src_b = voodoo_v4i_add(src_b, alocal);
+        }
+        if (cca_add)
+            src_a = voodoo_v4i_add(src_a, alocal);
+
+        src_r = voodoo_v4i_clamp8(src_r);
+        src_g = voodoo_v4i_clamp8(src_g);
+        src_b = voodoo_v4i_clamp8(src_b);
+        src_a = voodoo_v4i_clamp8(src_a);
+
+        if (cc_invert_output) {
+            src_r = voodoo_v4i_xor(src_r, c255);
+            src_g = voodoo_v4i_xor(src_g, c255);
+            src_b = voodoo_v4i_xor(src_b, c255);
+        }
+        if (cca_invert_output)
+            src_a = voodoo_v4i_xor(src_a, c255);
+
+        colbfog_r = src_r;
+        colbfog_g = src_g;
+        colbfog_b = src_b;
+
+        /*Fog*/
+        if (params->fogMode & FOG_ENABLE) {
+            if (params->fogMode & FOG_CONSTANT) {
+                src_r = voodoo_v4i_add(src_r, voodoo_v4i_set1(params->fogColor.r));
+                src_g = voodoo_v4i_add(src_g, voodoo_v4i_set1(params->fogColor.g));
+                src_b = voodoo_v4i_add(src_b, voodoo_v4i_set1(params->fogColor.b));
+            } else {
+                voodoo_v4i_t fog_a = voodoo_v4i_add(voodoo_v4i_load(l_fog_a), voodoo_v4i_set1(1));
+                voodoo_v4i_t fog_r = voodoo_v4i_set1((params->fogMode & FOG_ADD) ? 0 : params->fogColor.r);
+                voodoo_v4i_t fog_g = voodoo_v4i_set1((params->fogMode & FOG_ADD) ? 0 : params->fogColor.g);
+                voodoo_v4i_t fog_b = voodoo_v4i_set1((params->fogMode & FOG_ADD) ? 0 : params->fogColor.b);
+
+                if (!(params->fogMode & FOG_MULT)) {
+                    fog_r = voodoo_v4i_sub(fog_r, src_r);
+                    fog_g = voodoo_v4i_sub(fog_g, src_g);
+                    fog_b = voodoo_v4i_sub(fog_b, src_b);
+                }
+
+                fog_r = voodoo_v4i_srai(voodoo_v4i_mul(fog_r, fog_a), 8);
+                fog_g = voodoo_v4i_srai(voodoo_v4i_mul(fog_g, fog_a), 8);
+                fog_b = voodoo_v4i_srai(voodoo_v4i_mul(fog_b, fog_a), 8);
+
+                if (params->fogMode & FOG_MULT) {
+                    src_r = fog_r;
+                    src_g = fog_g;
+                    src_b = fog_b;
+                } else {
+                    src_r = voodoo_v4i_add(src_r, fog_r);
+                    src_g = voodoo_v4i_add(src_g, fog_g);
+                    src_b = voodoo_v4i_add(src_b, fog_b);
+                }
+            }
+
+            src_r = voodoo_v4i_clamp8(src_r);
+            src_g = voodoo_v4i_clamp8(src_g);
+            src_b = voodoo_v4i_clamp8(src_b);
+        }
+
+        /*Alpha test*/
+        if (params->alphaMode & 1) {
+            voodoo_v4i_t pass = voodoo_simd_compare(alpha_func, src_a, voodoo_v4i_set1(a_ref));
+
+            voodoo->fbiAFuncFail += voodoo_simd_popcount[voodoo_v4i_movemask(voodoo_v4i_andnot(live, pass))];
+            live      = voodoo_v4i_and(live, pass);
+            live_bits = voodoo_v4i_movemask(live);
+            if (!live_bits) {
+                left -= n;
+                continue;
+            }
+        }
+
+        /*Alpha blend*/
+        if (blend) {
+            voodoo_v4i_t dat = voodoo_v4i_load(l_dat);
+            voodoo_v4i_t newdest_r, newdest_g, newdest_b;
+            voodoo_v4i_t factor;
+
+            dest_r = voodoo_v4i_and(voodoo_v4i_srli(dat, 8), voodoo_v4i_set1(0xf8));
+            dest_g = voodoo_v4i_and(voodoo_v4i_srli(dat, 3), voodoo_v4i_set1(0xfc));
+            dest_b = voodoo_v4i_and(voodoo_v4i_slli(dat, 3), voodoo_v4i_set1(0xf8));
+            dest_r = voodoo_v4i_or(dest_r, voodoo_v4i_srli(dest_r, 5));
+            dest_g = voodoo_v4i_or(dest_g, voodoo_v4i_srli(dest_g, 6));
+            dest_b = voodoo_v4i_or(dest_b, voodoo_v4i_srli(dest_b, 5));
+            dest_a = voodoo_v4i_load(l_dest_a);
+
+            if (blend_dithersub) {
+                voodoo_v4i_store(l_dest_r, dest_r);
+                voodoo_v4i_store(l_dest_g, dest_g);
+                voodoo_v4i_store(l_dest_b, dest_b);
+                for (int l = 0; l < n; l++) {
+                    if (dither2x2) {
+                        l_dest_r[l] = dithersub_rb2x2[l_dest_r[l]][real_y & 1][lx[l] & 1];
+                        l_dest_g[l] = dithersub_g2x2[l_dest_g[l]][real_y & 1][lx[l] & 1];
+                        l_dest_b[l] = dithersub_rb2x2[l_dest_b[l]][real_y & 1][lx[l] & 1];
+                    } else {
+                        l_dest_r[l] = dithersub_rb[l_dest_r[l]][real_y & 3][lx[l] & 3];
+                        l_dest_g[l] = dithersub_g[l_dest_g[l]][real_y & 3][lx[l] & 3];
+                        l_dest_b[l] = dithersub_rb[l_dest_b[l]][real_y & 3][lx[l] & 3];
+                    }
+                }
+                dest_r = voodoo_v4i_load(l_dest_r);
+                dest_g = voodoo_v4i_load(l_dest_g);
+                dest_b = voodoo_v4i_load(l_dest_b);
+            }
+
+            factor    = voodoo_simd_blend_factor(dest_afunc, src_a, dest_a, src_r, colbfog_r);
+            newdest_r = voodoo_simd_blend_scale(dest_r, factor, dest_afunc);
+            factor    = voodoo_simd_blend_factor(dest_afunc, src_a, dest_a, src_g, colbfog_g);
+            newdest_g = voodoo_simd_blend_scale(dest_g, factor, dest_afunc);
+            factor    = voodoo_simd_blend_factor(dest_afunc, src_a, dest_a, src_b, colbfog_b);
+            newdest_b = voodoo_simd_blend_scale(dest_b, factor, dest_afunc);
+
+            if (src_afunc == AFUNC_ASATURATE) {
+                factor = voodoo_v4i_min(src_a, voodoo_v4i_sub(c255, dest_a));
+                src_r  = voodoo_v4i_div255(voodoo_v4i_mul(dest_r, factor));
+                src_g  = voodoo_v4i_div255(voodoo_v4i_mul(dest_g, factor));
+                src_b  = voodoo_v4i_div255(voodoo_v4i_mul(dest_b, factor));
+            } else if (src_afunc <= AFUNC_AOMDST_ALPHA) {
+                voodoo_v4i_t sr = src_r, sg = src_g, sb = src_b;
+
+                factor = voodoo_simd_blend_factor(src_afunc, src_a, dest_a, dest_r, voodoo_v4i_set1(0));
+                src_r  = voodoo_simd_blend_scale(sr, factor, src_afunc);
+                factor = voodoo_simd_blend_factor(src_afunc, src_a, dest_a, dest_g, voodoo_v4i_set1(0));
+                src_g  = voodoo_simd_blend_scale(sg, factor, src_afunc);
+                factor = voodoo_simd_blend_factor(src_afunc, src_a, dest_a, dest_b, voodoo_v4i_set1(0));
+                src_b  = voodoo_simd_blend_scale(sb, factor, src_afunc);
+            }
+
+            src_r = voodoo_v4i_clamp8(voodoo_v4i_add(src_r, newdest_r));
+            src_g = voodoo_v4i_clamp8(voodoo_v4i_add(src_g, newdest_g));
+            src_b = voodoo_v4i_clamp8(voodoo_v4i_add(src_b, newdest_b));
+
+            // TODO: Implement proper alpha blending support here for alpha values.
+            src_a = voodoo_v4i_add((dest_aafunc == 4) ? dest_a : voodoo_v4i_set1(0),
+                                   (src_aafunc == 4) ? src_a : voodoo_v4i_set1(0));
+        }
+
+        /*Scatter: dither and write back the surviving lanes*/
+        voodoo_v4i_store(l_r, src_r);
+        voodoo_v4i_store(l_g, src_g);
+        voodoo_v4i_store(l_b, src_b);
+        voodoo_v4i_store(l_a, src_a);
+        voodoo_v4i_store(l_new_depth, new_depth);
+
+        for (int l = 0; l < n; l++) {
+            int x_tiled;
+            int r, g, b;
+
+            if (!(live_bits & (1 << l)))
+                continue;
+
+            x_tiled = (lx[l] & 63) | ((lx[l] >> 6) * 128 * 32 / 2);
+            if (dither) {
+                if (dither2x2) {
+                    r = dither_rb2x2[l_r[l]][real_y & 1][lx[l] & 1];
+                    g = dither_g2x2[l_g[l]][real_y & 1][lx[l] & 1];
+                    b = dither_rb2x2[l_b[l]][real_y & 1][lx[l] & 1];
+                } else {
+                    r = dither_rb[l_r[l]][real_y & 3][lx[l] & 3];
+                    g = dither_g[l_g[l]][real_y & 3][lx[l] & 3];
+                    b = dither_rb[l_b[l]][real_y & 3][lx[l] & 3];
+                }
+            } else {
+                r = l_r[l] >> 3;
+                g = l_g[l] >> 2;
+                b = l_b[l] >> 3;
+            }
+
+            if (params->fbzMode & FBZ_RGB_WMASK) {
+                if (voodoo->params.col_tiled)
+                    fb_mem[x_tiled] = b | (g << 5) | (r << 11);
+                else
+                    fb_mem[lx[l]] = b | (g << 5) | (r << 11);
+            }
+            if ((params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_ALPHA_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_ALPHA_ENABLE)) {
+                if (voodoo->params.aux_tiled)
+                    aux_mem[x_tiled] = l_a[l];
+                else
+                    aux_mem[lx[l]] = l_a[l];
+            } else if ((params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) {
+                if (voodoo->params.aux_tiled)
+                    aux_mem[x_tiled] = l_new_depth[l];
+                else
+                    aux_mem[lx[l]] = l_new_depth[l];
+            }
+            voodoo->fbiPixelsOut++;
+        }
+
+        left -= n;
+    }
+}
+
 static void
 voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
@@ -700,8 +1474,9 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
 #ifndef NO_CODEGEN
     uint8_t (*voodoo_draw)(voodoo_state_t * state, voodoo_params_t * params, int x, int real_y);
 #endif
-    int y_diff   = SLI_ENABLED ? 2 : 1;
-    int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
+    int y_diff    = SLI_ENABLED ? 2 : 1;
+    int y_origin  = params->y_origin;
+    int simd_span = voodoo_simd_span_ok(voodoo, params);
 
     if ((params->textureMode[0] & TEXTUREMODE_MASK) == TEXTUREMODE_PASSTHROUGH || (params->textureMode[0] & TEXTUREMODE_LOCAL_MASK) == TEXTUREMODE_LOCAL)
         texels = 1;
@@ -732,22 +1507,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
     state->tex_lod[1]    = params->tex_lod[1];
 
     if ((params->fbzMode & 1) && (ystart < params->clipLowY)) {
-        int dy = params->clipLowY - ystart;
-
-        state->base_r += params->dRdY * dy;
-        state->base_g += params->dGdY * dy;
-        state->base_b += params->dBdY * dy;
-        state->base_a += params->dAdY * dy;
-        state->base_z += params->dZdY * dy;
-        state->tmu[0].base_s += params->tmu[0].dSdY * dy;
-        state->tmu[0].base_t += params->tmu[0].dTdY * dy;
-        state->tmu[0].base_w += params->tmu[0].dWdY * dy;
-        state->tmu[1].base_s += params->tmu[1].dSdY * dy;
-        state->tmu[1].base_t += params->tmu[1].dTdY * dy;
-        state->tmu[1].base_w += params->tmu[1].dWdY * dy;
-        state->base_w += params->dWdY * dy;
-        state->xstart += state->dx1 * dy;
-        state->xend += state->dx2 * dy;
+        voodoo_advance_lines(params, state, params->clipLowY - ystart);
 
         ystart = params->clipLowY;
     }
@@ -805,8 +1565,31 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         int       real_y = (state->y << 4) + 8;
         int       start_x;
         int       dx;
+        int       row;
+        int       band;
         uint16_t *fb_mem;
         uint16_t *aux_mem;
+        int       verify_span = 0;
+
+        /*Skip straight past bands owned by other render threads, so only
+          the owner pays for per-line setup*/
+        row = (params->fbzMode & (1 << 17)) ? (y_origin - state->y) : state->y;
+        if (SLI_ENABLED)
+            row >>= 1;
+        band = (row >> VOODOO_BAND_SHIFT) & VOODOO_BAND_MASK;
+        if (voodoo->render_band_owner[band] != odd_even) {
+            int lines;
+
+            if (params->fbzMode & (1 << 17))
+                lines = (row & ((1 << VOODOO_BAND_SHIFT) - 1)) + 1;
+            else
+                lines = (1 << VOODOO_BAND_SHIFT) - (row & ((1 << VOODOO_BAND_SHIFT) - 1));
+
+            /*next_line steps the final line*/
+            voodoo_advance_lines(params, state, (lines - 1) * y_diff);
+            state->y += (lines - 1) * y_diff;
+            goto next_line;
+        }
 
         state->ir     = state->base_r;
         state->ig     = state->base_g;
@@ -833,14 +1616,6 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         else
             real_y >>= 4;
 
-        if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        }
-
         start_x = x;
 
         if (state->xdir > 0)
@@ -919,6 +1694,8 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         if (x2 > x && state->xdir < 0)
             goto next_line;
 
+        voodoo->render_band_work[odd_even][band] += ((x2 - x) * state->xdir) + 1;
+
         if (SLI_ENABLED) {
             state->fb_mem = fb_mem = (uint16_t *) &voodoo->fb_mem[params->draw_offset + ((real_y >> 1) * params->row_width)];
             state->aux_mem = aux_mem = (uint16_t *) &voodoo->fb_mem[(params->aux_offset + ((real_y >> 1) * params->row_width)) & voodoo->fb_mask];
@@ -942,10 +1719,21 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
 
 #ifndef NO_CODEGEN
         {
-            if (voodoo->use_recompiler && voodoo_draw) {
+            int verify_x = x;
+
+            if (voodoo->use_recompiler && voodoo_draw && voodoo->jit_verify
+                && ++voodoo->jit_verify_count[odd_even] >= (uint32_t) voodoo->jit_verify) {
+                voodoo->jit_verify_count[odd_even] = 0;
+                verify_span = voodoo_verify_jit_span(voodoo, params, state, voodoo_draw, odd_even, x, x2, real_y);
+            }
+
+            if (voodoo->use_recompiler && voodoo_draw && !verify_span) {
                 voodoo_draw(state, params, x, real_y);
             } else
 #endif
+            if (simd_span && !verify_span)
+                voodoo_simd_span(voodoo, params, state, x, x2, real_y, fb_mem, aux_mem, odd_even, texels);
+            else
             do {
                 int x_tiled = (x & 63) | ((x >> 6) * 128 * 32 / 2);
                 start_x     = x;
@@ -1394,6 +2182,8 @@ skip_pixel:
             } while (start_x != x2);
 
 #ifndef NO_CODEGEN
+            if (verify_span)
+                voodoo_verify_jit_compare(voodoo, params, state, odd_even, verify_x, x2, real_y);
         }
 #endif
 
@@ -1438,9 +2228,6 @@ next_line:
         state->xstart += state->dx1;
         state->xend += state->dx2;
     }
-
-    voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
-    voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
 }
 
 void
@@ -1460,8 +2247,6 @@ voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
 
     state.dx1 = state.dx2 = 0;
 
-    voodoo->tri_count++;
-
     dx = 8 - (params->vertexAx & 0xf);
     if ((params->vertexAx & 0xf) > 8)
         dx += 16;
@@ -1599,6 +2384,7 @@ static void
 render_thread(void *param, int odd_even)
 {
     voodoo_t *voodoo = (voodoo_t *) param;
+    int       bit    = 1 << odd_even;
 
     while (voodoo->render_thread_run[odd_even]) {
         thread_set_event(voodoo->render_not_full_event[odd_even]);
@@ -1610,16 +2396,53 @@ render_thread(void *param, int odd_even)
         RENDER_VOODOO_BUSY(voodoo, odd_even) = 1;
 
         while (!PARAM_EMPTY(odd_even)) {
-            uint64_t         start_time = plat_timer_read();
-            uint64_t         end_time;
-            voodoo_params_t *params = &voodoo->params_buffer[PARAMS_READ_IDX(voodoo, odd_even) & PARAM_MASK];
-
-            voodoo_triangle(voodoo, params, odd_even);
+            uint64_t start_time = plat_timer_read();
+            uint64_t end_time;
+            int      end = PARAMS_WRITE_IDX(voodoo);
+
+            /*Drain everything queued so far in one pass, stepping over
+              triangles that fall entirely in other threads' bands*/
+            for (int idx = PARAMS_READ_IDX(voodoo, odd_even); idx != end; idx++) {
+                int              slot   = idx & PARAM_MASK;
+                voodoo_params_t *params = &voodoo->params_buffer[slot];
+                int              tex_entry[2];
+                int              fastfill;
+                int              mask;
+
+                /*A slot we don't take part in may already be rewritten for a
+                  later triangle; the sequence check catches that*/
+                if (atomic_load(&voodoo->params_seq[slot]) != idx)
+                    continue;
+                mask = voodoo->params_mask[slot];
+                if (atomic_load(&voodoo->params_seq[slot]) != idx || !(mask & bit))
+                    continue;
+
+                if (params->fastfill)
+                    voodoo_fastfill_band(voodoo, params, odd_even);
+                else
+                    voodoo_triangle(voodoo, params, odd_even);
+
+                /*Publish progress per triangle, so an LFB write waiting on
+                  one of our bands can go as soon as we are past it*/
+                PARAMS_READ_IDX(voodoo, odd_even) = idx + 1;
+
+                /*The slot may be reused as soon as the count drops, so take
+                  what is needed from it first*/
+                fastfill     = params->fastfill;
+                tex_entry[0] = params->tex_entry[0];
+                tex_entry[1] = params->tex_entry[1];
+                if (atomic_fetch_sub(&voodoo->params_refs[slot], 1) == 1) {
+                    if (!fastfill) {
+                        voodoo->texture_cache[0][tex_entry[0]].refcount_r[odd_even]++;
+                        voodoo->texture_cache[1][tex_entry[1]].refcount_r[odd_even]++;
+                    }
 
-            PARAMS_READ_IDX(voodoo, odd_even)++;
+                    if ((PARAMS_WRITE_IDX(voodoo) - idx) > (PARAM_SIZE - 10))
+                        thread_set_event(voodoo->render_slot_free_event);
+                }
+            }
 
-            if (PARAM_ENTRIES(odd_even) > (PARAM_SIZE - 10))
-                thread_set_event(voodoo->render_not_full_event[odd_even]);
+            PARAMS_READ_IDX(voodoo, odd_even) = end;
 
             end_time = plat_timer_read();
             voodoo->render_time[odd_even] += end_time - start_time;
@@ -1663,37 +2486,349 @@ voodoo_render_thread_4(void *param)
     render_thread(param, 3);
 }
 
+void (*const voodoo_render_thread_funcs[4])(void *param) = {
+    voodoo_render_thread_1,
+    voodoo_render_thread_2,
+    voodoo_render_thread_3,
+    voodoo_render_thread_4
+};
+
+/*Deal the bands out round-robin, so each thread starts with an even share of
+  every part of the screen*/
 void
-voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
+voodoo_render_init_bands(voodoo_t *voodoo)
+{
+    for (int c = 0; c < VOODOO_BANDS; c++)
+        voodoo->render_band_owner[c] = c % voodoo->render_threads;
+    memset(voodoo->render_band_work, 0, sizeof(voodoo->render_band_work));
+    voodoo->render_band_tris  = 0;
+    voodoo->render_band_moves = 0;
+}
+
+/*Let the least loaded thread steal bands from the most loaded one, based on
+  the pixels drawn per band since the last call. Each row must always be
+  drawn by a single thread so that triangles land in submission order, so
+  ownership only changes here, while every queued triangle has been retired
+  and no thread is inside voodoo_triangle().*/
+static void
+voodoo_render_rebalance(voodoo_t *voodoo)
+{
+    uint32_t work[VOODOO_BANDS];
+    uint64_t load[4] = { 0 };
+    uint64_t total   = 0;
+
+    for (int c = 0; c < VOODOO_BANDS; c++) {
+        work[c] = 0;
+        for (int t = 0; t < voodoo->render_threads; t++)
+            work[c] += voodoo->render_band_work[t][c];
+        load[voodoo->render_band_owner[c]] += work[c];
+        total += work[c];
+    }
+    memset(voodoo->render_band_work, 0, sizeof(voodoo->render_band_work));
+
+    /*Too little to go on*/
+    if (total < VOODOO_BANDS * 64)
+        return;
+
+    for (int moves = 0; moves < VOODOO_BANDS; moves++) {
+        int      busy = 0;
+        int      idle = 0;
+        int      best = -1;
+        uint64_t gap;
+
+        for (int t = 1; t < voodoo->render_threads; t++) {
+            if (load[t] > load[busy])
+                busy = t;
+            if (load[t] < load[idle])
+                idle = t;
+        }
+        gap = load[busy] - load[idle];
+
+        /*Largest band that still narrows the gap*/
+        for (int c = 0; c < VOODOO_BANDS; c++) {
+            if (voodoo->render_band_owner[c] == busy && work[c] && (work[c] * 2) <= gap && (best < 0 || work[c] > work[best]))
+                best = c;
+        }
+        if (best < 0)
+            break;
+
+        voodoo->render_band_owner[best] = idle;
+        load[busy] -= work[best];
+        load[idle] += work[best];
+        voodoo->render_band_moves++;
+    }
+}
+
+/*Framebuffer rows the triangle can touch, as band-space rows (after the Y
+  origin flip and the SLI line split). This mirrors the row range
+  voodoo_triangle() walks, but ignores the SLI line skip and empty spans, so
+  it may be wider than what ends up drawn. Returns 0 if nothing is drawn.*/
+static int
+voodoo_triangle_rows(voodoo_params_t *params, int sli, int *row_a, int *row_b)
+{
+    int vertexAy = params->vertexAy & 0xffff;
+    int vertexCy = params->vertexCy & 0xffff;
+    int ystart;
+    int yend;
+
+    if (vertexAy & 0x8000)
+        vertexAy |= 0xffff0000;
+    if (vertexCy & 0x8000)
+        vertexCy |= 0xffff0000;
+    ystart = (vertexAy + 7) >> 4;
+    yend   = (vertexCy + 7) >> 4;
+
+    if ((params->fbzMode & 1) && (ystart < params->clipLowY))
+        ystart = params->clipLowY;
+    if ((params->fbzMode & 1) && (yend >= params->clipHighY))
+        yend = params->clipHighY;
+
+    if (ystart >= yend)
+        return 0;
+
+    if (params->fbzMode & (1 << 17)) {
+        *row_a = params->y_origin - (yend - 1);
+        *row_b = params->y_origin - ystart;
+    } else {
+        *row_a = ystart;
+        *row_b = yend - 1;
+    }
+    if (sli) {
+        *row_a >>= 1;
+        *row_b >>= 1;
+    }
+
+    return 1;
+}
+
+/*Threads owning a band in rows row_a..row_b*/
+static int
+voodoo_triangle_thread_mask(voodoo_t *voodoo, int row_a, int row_b)
+{
+    int mask = 0;
+
+    if (voodoo->render_threads == 1)
+        return 1;
+
+    row_a >>= VOODOO_BAND_SHIFT;
+    row_b >>= VOODOO_BAND_SHIFT;
+
+    if ((row_b - row_a) >= VOODOO_BANDS)
+        return (1 << voodoo->render_threads) - 1;
+
+    for (int band = row_a; band <= row_b; band++)
+        mask |= 1 << voodoo->render_band_owner[band & VOODOO_BAND_MASK];
+
+    return mask;
+}
+
+static int
+voodoo_lfb_hazard_surface(voodoo_t *voodoo, uint32_t offset)
+{
+    for (int c = 0; c < voodoo->lfb_hazard_surfaces; c++) {
+        if (voodoo->lfb_hazard_offset[c] == offset)
+            return c;
+    }
+
+    return -1;
+}
+
+/*Record triangle idx as the last one touching rows row_a..row_b of the
+  surface at offset*/
+static void
+voodoo_lfb_hazard_mark(voodoo_t *voodoo, uint32_t offset, int row_a, int row_b, int idx)
+{
+    int surface = voodoo_lfb_hazard_surface(voodoo, offset);
+
+    if (surface < 0) {
+        if (voodoo->lfb_hazard_surfaces == VOODOO_LFB_HAZARD_SURFACES) {
+            voodoo->lfb_hazard_overflow = 1;
+            return;
+        }
+        surface                            = voodoo->lfb_hazard_surfaces++;
+        voodoo->lfb_hazard_offset[surface] = offset;
+        memset(voodoo->lfb_hazard_live[surface], 0, sizeof(voodoo->lfb_hazard_live[surface]));
+    }
+
+    row_a >>= VOODOO_BAND_SHIFT;
+    row_b >>= VOODOO_BAND_SHIFT;
+    if ((row_b - row_a) >= VOODOO_BANDS) {
+        row_a = 0;
+        row_b = VOODOO_BANDS - 1;
+    }
+
+    for (int band = row_a; band <= row_b; band++) {
+        voodoo->lfb_hazard_idx[surface][band & VOODOO_BAND_MASK]  = idx;
+        voodoo->lfb_hazard_live[surface][band & VOODOO_BAND_MASK] = 1;
+    }
+}
+
+/*Wait until the render threads have drawn every queued triangle that
+  touches row's band of the surface at offset. Called from the FIFO thread
+  before an LFB write lands, in place of draining every render thread.
+  Rows within a band are only ever drawn by the band's owner, in ring
+  order, so it is enough for that one thread to get past the last such
+  triangle.*/
+void
+voodoo_wait_for_render_band(voodoo_t *voodoo, uint32_t offset, int row)
+{
+    int band = (row >> VOODOO_BAND_SHIFT) & VOODOO_BAND_MASK;
+    int surface;
+    int owner;
+    int idx;
+
+    if (voodoo->lfb_hazard_overflow) {
+        voodoo->lfb_hazard_drains++;
+        voodoo_wait_for_render_thread_idle(voodoo);
+        voodoo->lfb_hazard_surfaces = 0;
+        voodoo->lfb_hazard_overflow = 0;
+        return;
+    }
+
+    surface = voodoo_lfb_hazard_surface(voodoo, offset);
+    if (surface < 0 || !voodoo->lfb_hazard_live[surface][band])
+        return;
+
+    idx   = voodoo->lfb_hazard_idx[surface][band];
+    owner = voodoo->render_band_owner[band];
+    if ((int) (PARAMS_READ_IDX(voodoo, owner) - idx) <= 0) {
+        voodoo->lfb_hazard_waits++;
+        do {
+            thread_set_event(voodoo->wake_render_thread[owner]);
+            thread_wait_event(voodoo->render_not_full_event[owner], 1);
+        } while ((int) (PARAMS_READ_IDX(voodoo, owner) - idx) <= 0);
+    }
+
+    voodoo->lfb_hazard_live[surface][band] = 0;
+}
+
+/*Wait for the slot the next triangle goes in to be retired by every thread
+  that drew from it. Slots usually retire in order, so this only blocks when
+  the whole ring is outstanding.*/
+static void
+voodoo_wait_for_render_slot(voodoo_t *voodoo)
 {
-    voodoo_params_t *params_new = &voodoo->params_buffer[PARAMS_WRITE_IDX(voodoo) & PARAM_MASK];
-
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
+    while (voodoo->params_free_idx != PARAMS_WRITE_IDX(voodoo) && !atomic_load(&voodoo->params_refs[voodoo->params_free_idx & PARAM_MASK]))
+        voodoo->params_free_idx++;
+
+    if ((PARAMS_WRITE_IDX(voodoo) - voodoo->params_free_idx) < PARAM_SIZE)
+        return;
+
+    voodoo->render_waits++;
+    do {
+        uint64_t start_time = plat_timer_read();
+
+        thread_reset_event(voodoo->render_slot_free_event);
+        if (atomic_load(&voodoo->params_refs[voodoo->params_free_idx & PARAM_MASK])) {
+            voodoo_wake_render_thread(voodoo);
+            thread_wait_event(voodoo->render_slot_free_event, -1);
         }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
+        voodoo->render_wait_ticks += plat_timer_read() - start_time;
+
+        while (voodoo->params_free_idx != PARAMS_WRITE_IDX(voodoo) && !atomic_load(&voodoo->params_refs[voodoo->params_free_idx & PARAM_MASK]))
+            voodoo->params_free_idx++;
+    } while ((PARAMS_WRITE_IDX(voodoo) - voodoo->params_free_idx) >= PARAM_SIZE);
+}
+
+/*Rows a queued fastfill clears, as band-space rows like
+  voodoo_triangle_rows()*/
+static int
+voodoo_fastfill_band_rows(voodoo_params_t *params, int sli, int *row_a, int *row_b)
+{
+    int low_y;
+    int high_y;
+
+    voodoo_fastfill_rows(params, params->y_origin + 1, &low_y, &high_y);
+    if (low_y >= high_y || !(params->fbzMode & (FBZ_RGB_WMASK | FBZ_DEPTH_WMASK)))
+        return 0;
+
+    *row_a = sli ? (low_y >> 1) : low_y;
+    *row_b = sli ? ((high_y - 1) >> 1) : (high_y - 1);
+
+    return 1;
+}
+
+static void
+voodoo_queue_params(voodoo_t *voodoo, voodoo_params_t *params, int fastfill)
+{
+    int              idx        = PARAMS_WRITE_IDX(voodoo);
+    int              slot       = idx & PARAM_MASK;
+    voodoo_params_t *params_new = &voodoo->params_buffer[slot];
+    int              mask = 1;
+    int              refs = 0;
+    int              row_a = 0;
+    int              row_b = 0;
+    int              wake;
+
+    voodoo_wait_for_render_slot(voodoo);
+
+    /*Every queued triangle retired means no thread is inside one, and no
+      LFB write can depend on one*/
+    if (voodoo->params_free_idx == idx) {
+        voodoo->lfb_hazard_surfaces = 0;
+        voodoo->lfb_hazard_overflow = 0;
+    }
+    if (voodoo->render_threads > 1 && ++voodoo->render_band_tris >= 256 && voodoo->params_free_idx == idx) {
+        voodoo_render_rebalance(voodoo);
+        voodoo->render_band_tris = 0;
     }
 
-    voodoo_use_texture(voodoo, params, 0);
-    if (voodoo->dual_tmus)
-        voodoo_use_texture(voodoo, params, 1);
+    if (!fastfill) {
+        voodoo_use_texture(voodoo, params, 0);
+        if (voodoo->dual_tmus)
+            voodoo_use_texture(voodoo, params, 1);
+    }
+
+    params->y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
+    params->fastfill = fastfill;
+
+    /*Nothing drawn still needs one thread to retire the slot*/
+    if (fastfill ? voodoo_fastfill_band_rows(params, SLI_ENABLED, &row_a, &row_b) : voodoo_triangle_rows(params, SLI_ENABLED, &row_a, &row_b)) {
+        mask = voodoo_triangle_thread_mask(voodoo, row_a, row_b);
 
+        if (fastfill) {
+            if (params->fbzMode & FBZ_RGB_WMASK)
+                voodoo_lfb_hazard_mark(voodoo, params->draw_offset, row_a, row_b, idx);
+            if (params->fbzMode & FBZ_DEPTH_WMASK)
+                voodoo_lfb_hazard_mark(voodoo, params->aux_offset, row_a, row_b, idx);
+        } else {
+            voodoo_lfb_hazard_mark(voodoo, params->draw_offset, row_a, row_b, idx);
+            if (params->fbzMode & (FBZ_DEPTH_ENABLE | FBZ_ALPHA_ENABLE))
+                voodoo_lfb_hazard_mark(voodoo, params->aux_offset, row_a, row_b, idx);
+        }
+    }
+    for (int c = 0; c < voodoo->render_threads; c++)
+        refs += (mask >> c) & 1;
+
+    atomic_store(&voodoo->params_seq[slot], -1);
     memcpy(params_new, params, sizeof(voodoo_params_t));
+    voodoo->params_mask[slot] = mask;
+    atomic_store(&voodoo->params_refs[slot], refs);
+    atomic_store(&voodoo->params_seq[slot], idx);
 
     PARAMS_WRITE_IDX(voodoo)++;
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
+    wake = 0;
+    for (int c = 0; c < voodoo->render_threads; c++)
+        wake |= ((mask >> c) & 1) && ((PARAM_ENTRIES(c) < 4) || !RENDER_VOODOO_BUSY(voodoo, c));
+    if (wake)
         voodoo_wake_render_thread(voodoo);
 }
+
+void
+voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    /*Counted here, once, rather than by every band thread that draws it*/
+    voodoo->tri_count++;
+    voodoo_queue_params(voodoo, params, 0);
+}
+
+/*Hand fastfillCMD to the render threads like a triangle, each clearing the
+  rows of its own bands in ring order, instead of draining them and clearing
+  on the FIFO thread*/
+void
+voodoo_queue_fastfill(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    voodoo->fastfill_queued++;
+    voodoo_queue_params(voodoo, params, 1);
+}
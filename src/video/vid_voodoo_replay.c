@@ -0,0 +1,503 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Headless replay of a Voodoo command stream capture.
+ *
+ *          Builds a Voodoo Graphics / Voodoo 2 card from the capture's
+ *          configuration and feeds it the recorded writes through the card's
+ *          own MMIO and PCI handlers. The FIFO thread, triangle setup, JIT
+ *          and render threads run exactly as in the emulator. The rest of
+ *          the machine is stubbed out below. There is no display: a swap
+ *          completes as soon as the FIFO thread asks for it.
+ *
+ *          Usage: voodoo_replay [-t threads] [-i] [-n passes] [-v n] capture
+ *
+ *            -t  render threads (1-4), default from the capture
+ *            -i  use the interpreter instead of the JIT
+ *            -n  replay the capture this many times, each on a fresh card
+ *            -v  check every nth JIT span against the interpreter
+ *                (VOODOO_JIT_VERIFY); the exit status is 2 on a mismatch
+ *
+ *          Reports frames/s, busy time per pipeline stage and a checksum of
+ *          the framebuffer after the last write, which should not change
+ *          with the thread count or between the JIT and the interpreter.
+ *
+ * Authors: skiretic
+ *
+ *          Copyright 2026 skiretic.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wchar.h>
+#include <sys/mman.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/device.h>
+#include <86box/mem.h>
+#include <86box/nvr.h>
+#include <86box/pci.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_voodoo_common.h>
+#include <86box/vid_voodoo_banshee.h>
+#include <86box/vid_voodoo_capture.h>
+#include <86box/vid_voodoo_fifo.h>
+#include <86box/vid_voodoo_regs.h>
+#include <86box/vid_voodoo_render.h>
+
+/*Wake the FIFO thread every this many records, standing in for the wake
+  timer the emulator runs off the CPU clock*/
+#define REPLAY_WAKE_RECORDS 256
+
+/*vid_voodoo.c device entry points*/
+extern void *voodoo_init(const device_t *info);
+extern void  voodoo_close(void *priv);
+extern void  voodoo_pci_write(int func, int addr, int len, uint8_t val, void *priv);
+
+static voodoo_capture_header_t replay_header;
+static int                     replay_render_threads;
+static int                     replay_recompiler;
+static uint64_t                replay_mismatches;
+
+/*Machine stubs*/
+cpu_state_t cpu_state;
+double      cpuclock = 33333333.0;
+uint64_t    TIMER_USEC;
+uint64_t    tsc;
+int         pci_burst_time;
+int         pci_nonburst_time;
+monitor_t   monitors[MONITORS_NUM];
+int         monitor_index_global;
+
+int
+device_get_config_int(const char *name)
+{
+    if (!strcmp(name, "type"))
+        return replay_header.type;
+    if (!strcmp(name, "framebuffer_memory"))
+        return replay_header.fb_size;
+    if (!strcmp(name, "texture_memory"))
+        return replay_header.texture_size;
+    if (!strcmp(name, "bilinear"))
+        return replay_header.bilinear_enabled;
+    if (!strcmp(name, "dithersub"))
+        return replay_header.dithersub_enabled;
+    if (!strcmp(name, "dacfilter"))
+        return replay_header.scrfilter;
+    if (!strcmp(name, "render_threads"))
+        return replay_render_threads;
+    if (!strcmp(name, "recompiler"))
+        return replay_recompiler;
+
+    return 0;
+}
+
+void
+pclog(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+mem_mapping_add(mem_mapping_t *map, uint32_t base, uint32_t size,
+                uint8_t (*read_b)(uint32_t addr, void *priv),
+                uint16_t (*read_w)(uint32_t addr, void *priv),
+                uint32_t (*read_l)(uint32_t addr, void *priv),
+                void (*write_b)(uint32_t addr, uint8_t val, void *priv),
+                void (*write_w)(uint32_t addr, uint16_t val, void *priv),
+                void (*write_l)(uint32_t addr, uint32_t val, void *priv),
+                uint8_t *exec, uint32_t flags, void *priv)
+{
+    memset(map, 0, sizeof(mem_mapping_t));
+    map->base    = base;
+    map->size    = size;
+    map->read_b  = read_b;
+    map->read_w  = read_w;
+    map->read_l  = read_l;
+    map->write_b = write_b;
+    map->write_w = write_w;
+    map->write_l = write_l;
+    map->exec    = exec;
+    map->flags   = flags;
+    map->priv    = priv;
+}
+
+void
+mem_mapping_set_addr(mem_mapping_t *map, uint32_t base, uint32_t size)
+{
+    map->base   = base;
+    map->size   = size;
+    map->enable = 1;
+}
+
+void
+mem_mapping_disable(mem_mapping_t *map)
+{
+    map->enable = 0;
+}
+
+uint32_t
+mem_readl_phys(UNUSED(uint32_t addr))
+{
+    return 0xffffffff;
+}
+
+void
+pci_add_card(UNUSED(uint8_t add_type), UNUSED(uint8_t (*read)(int func, int addr, int len, void *priv)),
+             UNUSED(void (*write)(int func, int addr, int len, uint8_t val, void *priv)), UNUSED(void *priv), uint8_t *slot)
+{
+    *slot = 0;
+}
+
+void
+timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start_timer)
+{
+    memset(timer, 0, sizeof(pc_timer_t));
+    timer->callback = callback;
+    timer->priv     = priv;
+    if (start_timer)
+        timer->flags |= TIMER_ENABLED;
+}
+
+void
+timer_enable(pc_timer_t *timer)
+{
+    timer->flags |= TIMER_ENABLED;
+}
+
+void
+timer_disable(pc_timer_t *timer)
+{
+    timer->flags &= ~TIMER_ENABLED;
+}
+
+svga_t *
+svga_get_pri(void)
+{
+    return NULL;
+}
+
+void
+svga_set_override(UNUSED(svga_t *svga), UNUSED(int val))
+{
+}
+
+void
+svga_recalctimings(UNUSED(svga_t *svga))
+{
+}
+
+void
+svga_doblit(UNUSED(int wx), UNUSED(int wy), UNUSED(svga_t *svga))
+{
+}
+
+void
+video_wait_for_buffer_monitor(UNUSED(int monitor_index))
+{
+}
+
+void
+banshee_cmd_write(UNUSED(void *priv), UNUSED(uint32_t addr), UNUSED(uint32_t val))
+{
+}
+
+void
+banshee_set_overlay_addr(UNUSED(void *priv), UNUSED(uint32_t addr))
+{
+}
+
+void
+voodoo_generate_vb_filters(UNUSED(voodoo_t *voodoo), UNUSED(int fcr), UNUSED(int fcg))
+{
+}
+
+char *
+nvr_path(char *str)
+{
+    return str;
+}
+
+FILE *
+plat_fopen(const char *path, const char *mode)
+{
+    return fopen(path, mode);
+}
+
+void *
+plat_mmap(size_t size, uint8_t executable)
+{
+    void *ret = mmap(0, size, PROT_READ | PROT_WRITE | (executable ? PROT_EXEC : 0), MAP_ANON | MAP_PRIVATE, -1, 0);
+
+    return (ret == MAP_FAILED) ? NULL : ret;
+}
+
+void
+plat_munmap(void *ptr, size_t size)
+{
+    munmap(ptr, size);
+}
+
+/*Microseconds, so the stage times below need no conversion*/
+uint64_t
+plat_timer_read(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+uint32_t
+plat_get_ticks(void)
+{
+    return (uint32_t) (plat_timer_read() / 1000);
+}
+
+void
+plat_delay_ms(uint32_t count)
+{
+    struct timespec ts = { count / 1000, (count % 1000) * 1000000 };
+
+    nanosleep(&ts, NULL);
+}
+
+void
+plat_set_thread_name(UNUSED(void *thread), UNUSED(const char *name))
+{
+}
+
+/*Replay*/
+static void
+replay_wake(voodoo_t *voodoo)
+{
+    if (timer_is_enabled(&voodoo->wake_timer)) {
+        timer_disable(&voodoo->wake_timer);
+        voodoo_wake_timer(voodoo);
+    }
+}
+
+/*The guest polls cmdFifoDepth before refilling the CMDFIFO ring, which the
+  capture doesn't have. Stay within half a ring of the FIFO thread instead.*/
+static void
+replay_cmdfifo_wait(voodoo_t *voodoo)
+{
+    int ring = (int) (voodoo->cmdfifo_end - voodoo->cmdfifo_base) >> 2;
+
+    if (ring <= 0)
+        return;
+    while ((voodoo->cmdfifo_depth_wr - voodoo->cmdfifo_depth_rd) >= (ring >> 1)) {
+        voodoo_wake_fifo_thread_now(voodoo);
+        plat_delay_ms(0);
+    }
+}
+
+static void
+replay_drain(voodoo_t *voodoo)
+{
+    for (;;) {
+        voodoo_wake_fifo_thread_now(voodoo);
+        if (FIFO_EMPTY && (!voodoo->cmdfifo_enabled || voodoo->cmdfifo_depth_rd == voodoo->cmdfifo_depth_wr) && !voodoo->voodoo_busy)
+            break;
+        plat_delay_ms(1);
+    }
+    voodoo_wait_for_render_thread_idle(voodoo);
+}
+
+static uint64_t
+replay_checksum(const uint8_t *data, uint32_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL; /*FNV-1a*/
+
+    for (uint32_t c = 0; c < size; c++) {
+        hash ^= data[c];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static void
+replay_pass(const voodoo_capture_record_t *records, size_t nr_records, int pass)
+{
+    voodoo_set_t *set = voodoo_init(NULL);
+    voodoo_t     *voodoo = set->voodoos[0];
+    uint64_t      start_time;
+    uint64_t      end_time;
+    uint64_t      render_time = 0;
+    uint64_t      pixels      = 0;
+    double        secs;
+
+    /*No retrace: let swaps complete as soon as the FIFO thread waits on them*/
+    voodoo->flush = 1;
+
+    start_time = plat_timer_read();
+    for (size_t c = 0; c < nr_records; c++) {
+        uint32_t addr = records[c].addr & VOODOO_CAPTURE_ADDR_MASK;
+        uint32_t val  = records[c].val;
+
+        switch (VOODOO_CAPTURE_KIND(records[c].addr)) {
+            case VOODOO_CAPTURE_WRITEL:
+                if (!(addr & 0xc00000) && (addr & 0x200000) && (voodoo->fbiInit7 & FBIINIT7_CMDFIFO_ENABLE))
+                    replay_cmdfifo_wait(voodoo);
+                voodoo->mapping.write_l(addr, val, voodoo);
+                break;
+            case VOODOO_CAPTURE_WRITEW:
+                voodoo->mapping.write_w(addr, val, voodoo);
+                break;
+            case VOODOO_CAPTURE_PCI:
+                voodoo_pci_write(0, addr, 1, val, voodoo);
+                break;
+
+            default:
+                fatal("Bad capture record %08x at %zu\n", records[c].addr, c);
+        }
+
+        if (!(c % REPLAY_WAKE_RECORDS))
+            replay_wake(voodoo);
+    }
+    replay_drain(voodoo);
+    end_time = plat_timer_read();
+    secs     = (double) (end_time - start_time) / 1000000.0;
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        render_time += (uint32_t) voodoo->render_time[c];
+        pixels += (uint32_t) voodoo->pixel_count[c];
+    }
+
+    printf("pass %i: %i frames in %.3f s, %.1f frames/s\n",
+           pass, voodoo->swapbuffer_count, secs, secs ? voodoo->swapbuffer_count / secs : 0.0);
+    printf("  fifo      %8.3f s  (decode, triangle setup, LFB and texture writes)\n", voodoo->time / 1000000.0);
+    printf("  render    %8.3f s  over %i thread(s), %i triangles, %" PRIu64 " pixels\n",
+           render_time / 1000000.0, voodoo->render_threads, voodoo->tri_count, pixels);
+    printf("  jit       %8.3f s  %" PRIu64 " blocks compiled%s\n",
+           voodoo->jit_compile_ticks / 1000000.0, voodoo->jit_compiles, voodoo->use_recompiler ? "" : " (interpreter)");
+    printf("  textures  %" PRIu64 " cache hits, %" PRIu64 " misses, %" PRIu64 " evictions\n",
+           voodoo->texture_cache_hits, voodoo->texture_cache_misses, voodoo->texture_cache_evictions);
+    printf("  wakeups   %" PRIu64 " FIFO thread wakeups, %" PRIu64 " signals, %" PRIu64 " spin hits\n",
+           voodoo->fifo_wakeups, voodoo->fifo_wake_signals, voodoo->fifo_spin_hits);
+    if (voodoo->jit_verify) {
+        uint64_t spans      = 0;
+        uint64_t mismatches = 0;
+
+        for (int c = 0; c < 4; c++) {
+            spans += voodoo->jit_verify_spans[c];
+            mismatches += voodoo->jit_verify_mismatches[c];
+        }
+        printf("  verify    %" PRIu64 " JIT spans checked, %" PRIu64 " mismatched\n", spans, mismatches);
+        replay_mismatches += mismatches;
+    }
+    printf("  checksum  %016" PRIx64 "\n", replay_checksum(voodoo->fb_mem, voodoo->fb_size << 20));
+
+    voodoo_close(set);
+}
+
+int
+main(int argc, char **argv)
+{
+    voodoo_capture_record_t *records;
+    FILE                    *fp;
+    long                     size;
+    int                      passes = 1;
+    const char              *verify = NULL;
+    int                      c;
+
+    replay_render_threads = -1;
+    replay_recompiler     = -1;
+    for (c = 1; c < argc - 1; c++) {
+        if (!strcmp(argv[c], "-t") && (c + 1) < argc - 1)
+            replay_render_threads = atoi(argv[++c]);
+        else if (!strcmp(argv[c], "-i"))
+            replay_recompiler = 0;
+        else if (!strcmp(argv[c], "-n") && (c + 1) < argc - 1)
+            passes = atoi(argv[++c]);
+        else if (!strcmp(argv[c], "-v") && (c + 1) < argc - 1)
+            verify = argv[++c];
+        else
+            break;
+    }
+    if (c != argc - 1 || replay_render_threads == 0 || replay_render_threads > 4 || passes < 1) {
+        fprintf(stderr, "usage: %s [-t threads] [-i] [-n passes] [-v n] capture\n", argv[0]);
+        return 1;
+    }
+
+    fp = fopen(argv[c], "rb");
+    if (!fp) {
+        fprintf(stderr, "%s: can't open %s\n", argv[0], argv[c]);
+        return 1;
+    }
+    if (fread(&replay_header, 1, sizeof(replay_header), fp) != sizeof(replay_header)
+        || memcmp(replay_header.magic, VOODOO_CAPTURE_MAGIC, sizeof(replay_header.magic))
+        || replay_header.version != VOODOO_CAPTURE_VERSION) {
+        fprintf(stderr, "%s: %s is not a Voodoo capture\n", argv[0], argv[c]);
+        fclose(fp);
+        return 1;
+    }
+
+    /*The whole capture is read up front so the file system stays out of
+      the timings*/
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp) - (long) sizeof(replay_header);
+    fseek(fp, sizeof(replay_header), SEEK_SET);
+    records = malloc(size > 0 ? size : 1);
+    if (size < 0 || fread(records, 1, size, fp) != (size_t) size) {
+        fprintf(stderr, "%s: can't read %s\n", argv[0], argv[c]);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    if (replay_render_threads < 0)
+        replay_render_threads = replay_header.render_threads;
+    if (replay_recompiler < 0)
+        replay_recompiler = replay_header.recompiler;
+
+    /*Compile every block from scratch, and don't let the replay take
+      part in what it measures, unless asked otherwise*/
+    setenv("VOODOO_JIT_CACHE", "0", 0);
+    setenv("VOODOO_METRICS", "0", 0);
+    setenv("VOODOO_CAPTURE", "", 1);
+    if (verify)
+        setenv("VOODOO_JIT_VERIFY", verify, 1);
+
+    TIMER_USEC = (uint64_t) 1 << 32;
+    printf("%s: type %i, %u MB framebuffer, %u MB texture, %zu records\n",
+           argv[c], replay_header.type, replay_header.fb_size, replay_header.texture_size,
+           size / sizeof(voodoo_capture_record_t));
+
+    for (int pass = 0; pass < passes; pass++)
+        replay_pass(records, size / sizeof(voodoo_capture_record_t), pass);
+
+    free(records);
+
+    return replay_mismatches ? 2 : 0;
+}
@@ -238,3 +238,70 @@ voodoo_triangle_setup(voodoo_t *voodoo)
 
     voodoo_queue_triangle(voodoo, &voodoo->params);
 }
+
+/*sBeginTriCMD: start a new strip or fan at the vertex in verts[3]*/
+void
+voodoo_setup_begin_tri(voodoo_t *voodoo)
+{
+    voodoo->verts[0]        = voodoo->verts[3];
+    voodoo->verts[1]        = voodoo->verts[3];
+    voodoo->verts[2]        = voodoo->verts[3];
+    voodoo->vertex_next_age = 0;
+    voodoo->vertex_ages[0]  = voodoo->vertex_next_age++;
+
+    voodoo->num_verticies = 1;
+    voodoo->cull_pingpong = 0;
+}
+
+/*sDrawTriCMD: add the vertex in verts[3], and draw once there are three*/
+void
+voodoo_setup_draw_tri(voodoo_t *voodoo)
+{
+    /*I'm not sure this is the vertex selection algorithm actually used in the 3dfx
+      chips, but this works with a number of games that switch between strip and fan
+      mode in the middle of a run (eg Black & White, Viper Racing)*/
+    if (voodoo->vertex_next_age < 3) {
+        /*Fewer than three vertices already written, store in next slot*/
+        int vertex_nr = voodoo->vertex_next_age;
+
+        voodoo->verts[vertex_nr]       = voodoo->verts[3];
+        voodoo->vertex_ages[vertex_nr] = voodoo->vertex_next_age++;
+    } else {
+        int vertex_nr = 0;
+
+        if (!(voodoo->sSetupMode & SETUPMODE_STRIP_MODE)) {
+            /*Strip - find oldest vertex*/
+            if ((voodoo->vertex_ages[0] < voodoo->vertex_ages[1]) && (voodoo->vertex_ages[0] < voodoo->vertex_ages[2]))
+                vertex_nr = 0;
+            else if ((voodoo->vertex_ages[1] < voodoo->vertex_ages[0]) && (voodoo->vertex_ages[1] < voodoo->vertex_ages[2]))
+                vertex_nr = 1;
+            else
+                vertex_nr = 2;
+        } else {
+            /*Fan - find second oldest vertex (ie pivot around oldest)*/
+            if ((voodoo->vertex_ages[1] < voodoo->vertex_ages[0]) && (voodoo->vertex_ages[0] < voodoo->vertex_ages[2]))
+                vertex_nr = 0;
+            else if ((voodoo->vertex_ages[2] < voodoo->vertex_ages[0]) && (voodoo->vertex_ages[0] < voodoo->vertex_ages[1]))
+                vertex_nr = 0;
+            else if ((voodoo->vertex_ages[0] < voodoo->vertex_ages[1]) && (voodoo->vertex_ages[1] < voodoo->vertex_ages[2]))
+                vertex_nr = 1;
+            else if ((voodoo->vertex_ages[2] < voodoo->vertex_ages[1]) && (voodoo->vertex_ages[1] < voodoo->vertex_ages[0]))
+                vertex_nr = 1;
+            else
+                vertex_nr = 2;
+        }
+        voodoo->verts[vertex_nr]       = voodoo->verts[3];
+        voodoo->vertex_ages[vertex_nr] = voodoo->vertex_next_age++;
+    }
+
+    voodoo->num_verticies++;
+    if (voodoo->num_verticies == 3) {
+#if 0
+        voodoo_setup_log("triangle_setup\n");
+#endif
+        voodoo_triangle_setup(voodoo);
+        voodoo->cull_pingpong = !voodoo->cull_pingpong;
+
+        voodoo->num_verticies = 2;
+    }
+}
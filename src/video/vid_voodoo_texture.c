@@ -37,6 +37,13 @@
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
 #include <86box/vid_voodoo_texture.h>
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define VOODOO_TEX_SSE2
+#elif defined __aarch64__ || defined _M_ARM64
+#    include <arm_neon.h>
+#    define VOODOO_TEX_NEON
+#endif
 
 #ifdef ENABLE_VOODOO_TEXTURE_LOG
 int voodoo_texture_do_log = ENABLE_VOODOO_TEXTURE_LOG;
@@ -237,18 +244,433 @@ voodoo_recalc_tex3(voodoo_t *voodoo, int tmu)
 
 #define makergba(r, g, b, a) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
+#define TEX_CACHE_DATA_SIZE ((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4)
+
+static __inline int
+voodoo_texture_hash(voodoo_t *voodoo, uint32_t base, uint32_t tLOD, uint32_t palette_checksum)
+{
+    uint32_t hash = base * 0x9e3779b1;
+
+    hash ^= (tLOD + (hash << 6) + (hash >> 2)) * 0x85ebca6b;
+    hash ^= palette_checksum * 0xc2b2ae35;
+    hash ^= hash >> 15;
+
+    return hash & (voodoo->texture_cache_size * 2 - 1);
+}
+
+static void
+voodoo_texture_hash_insert(voodoo_t *voodoo, int tmu, int c)
+{
+    texture_t *entry = &voodoo->texture_cache[tmu][c];
+    int        hash  = voodoo_texture_hash(voodoo, entry->base, entry->tLOD, entry->palette_checksum);
+
+    entry->hash_next                = voodoo->texture_hash[tmu][hash];
+    voodoo->texture_hash[tmu][hash] = c;
+}
+
+static void
+voodoo_texture_hash_remove(voodoo_t *voodoo, int tmu, int c)
+{
+    texture_t *entry = &voodoo->texture_cache[tmu][c];
+    int       *link  = &voodoo->texture_hash[tmu][voodoo_texture_hash(voodoo, entry->base, entry->tLOD, entry->palette_checksum)];
+
+    while (*link != -1) {
+        if (*link == c) {
+            *link            = entry->hash_next;
+            entry->hash_next = -1;
+            return;
+        }
+        link = &voodoo->texture_cache[tmu][*link].hash_next;
+    }
+}
+
+/*LODs held in each of an entry's four address ranges*/
+static const uint32_t texture_range_lods[4] = { 1 << 0, 1 << 1, 1 << 2, 0x1f8 };
+
+static int
+voodoo_texture_range_covers(voodoo_t *voodoo, texture_t *entry, int d, int page)
+{
+    int first = (entry->addr_start[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+    int last  = (entry->addr_end[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+
+    if (!entry->addr_end[d])
+        return 0;
+    if (first <= last)
+        return page >= first && page <= last;
+    return page >= first || page <= last;
+}
+
+/*Rebuild an entry's bits in the page map so that exactly the pages backing
+  the LODs in `lods` are marked. Called with 0 to drop the entry.*/
+static void
+voodoo_texture_map_entry(voodoo_t *voodoo, int tmu, int c, uint32_t lods)
+{
+    texture_t *entry = &voodoo->texture_cache[tmu][c];
+    int        words = voodoo->texture_cache_size >> 5;
+    uint32_t   bit   = 1u << (c & 31);
+
+    for (int set = 0; set < 2; set++) {
+        for (uint8_t d = 0; d < 4; d++) {
+            int page;
+            int last;
+
+            if (!entry->addr_end[d] || (set && !(texture_range_lods[d] & lods)))
+                continue;
+
+            page = (entry->addr_start[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+            last = (entry->addr_end[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+            while (1) {
+                uint32_t *word = &voodoo->texture_page_map[tmu][page * words + (c >> 5)];
+
+                /*Ranges of one entry may overlap, so only count transitions*/
+                if (set && !(*word & bit)) {
+                    *word |= bit;
+                    voodoo->texture_present[tmu][page]++;
+                } else if (!set && (*word & bit)) {
+                    *word &= ~bit;
+                    voodoo->texture_present[tmu][page]--;
+                }
+
+                if (page == last)
+                    break;
+                /*Wrap where the TMU's address space does, not at the
+                  largest texture memory*/
+                page = (page + 1) & (voodoo->texture_mask >> TEX_DIRTY_SHIFT);
+            }
+        }
+    }
+}
+
+void
+voodoo_texture_cache_init(voodoo_t *voodoo)
+{
+    const char *env  = getenv("VOODOO_TEX_CACHE");
+    int         size = TEX_CACHE_MAX;
+
+    /*Round the requested entry count up to a power of two*/
+    if (env && *env) {
+        int entries = atoi(env);
+
+        while (size < entries && size < TEX_CACHE_LIMIT)
+            size <<= 1;
+    }
+    voodoo->texture_cache_size = size;
+
+    /*Both TMUs always have a table, as render threads retire tex_entry[1]
+      even on single TMU boards. Entry data is allocated on first use.*/
+    for (int tmu = 0; tmu < 2; tmu++) {
+        voodoo->texture_cache[tmu] = calloc(size, sizeof(texture_t));
+        voodoo->texture_hash[tmu]  = malloc(size * 2 * sizeof(int));
+        voodoo->texture_page_map[tmu] = calloc(TEX_PAGES * (size >> 5), sizeof(uint32_t));
+        for (int c = 0; c < size; c++) {
+            voodoo->texture_cache[tmu][c].base      = -1; /*invalid*/
+            voodoo->texture_cache[tmu][c].hash_next = -1;
+        }
+        for (int c = 0; c < size * 2; c++)
+            voodoo->texture_hash[tmu][c] = -1;
+    }
+}
+
+void
+voodoo_texture_cache_close(voodoo_t *voodoo)
+{
+    for (int tmu = 0; tmu < 2; tmu++) {
+        for (int c = 0; c < voodoo->texture_cache_size; c++)
+            free(voodoo->texture_cache[tmu][c].data);
+        free(voodoo->texture_cache[tmu]);
+        free(voodoo->texture_hash[tmu]);
+        free(voodoo->texture_page_map[tmu]);
+    }
+}
+
+/*Every triangle using the entry has been retired. Each one is counted once,
+  by whichever render thread finished it last*/
+static int
+voodoo_texture_idle(voodoo_t *voodoo, int tmu, int c)
+{
+    int retired = 0;
+
+    for (int t = 0; t < voodoo->render_threads; t++)
+        retired += voodoo->texture_cache[tmu][c].refcount_r[t];
+
+    return voodoo->texture_cache[tmu][c].refcount == retired;
+}
+
+/*Texel lookup for the 8-bit formats, and for the low byte of the 16-bit
+  formats that carry alpha in the high byte (alpha left zero here)*/
+static void
+voodoo_texture_build_lut(voodoo_t *voodoo, int tmu, int tformat, uint32_t *lut)
+{
+    const rgba_u *pal;
+
+    switch (tformat) {
+        case TEX_RGB332:
+        case TEX_ARGB8332:
+            for (int c = 0; c < 256; c++)
+                lut[c] = makergba(rgb332[c].r, rgb332[c].g, rgb332[c].b, (tformat == TEX_RGB332) ? 0xff : 0);
+            break;
+
+        case TEX_Y4I2Q2:
+        case TEX_A8Y4I2Q2:
+            pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
+            for (int c = 0; c < 256; c++)
+                lut[c] = makergba(pal[c].rgba.r, pal[c].rgba.g, pal[c].rgba.b, (tformat == TEX_Y4I2Q2) ? 0xff : 0);
+            break;
+
+        case TEX_A8:
+            for (int c = 0; c < 256; c++)
+                lut[c] = makergba(c, c, c, c);
+            break;
+
+        case TEX_I8:
+        case TEX_A8I8:
+            for (int c = 0; c < 256; c++)
+                lut[c] = makergba(c, c, c, (tformat == TEX_I8) ? 0xff : 0);
+            break;
+
+        case TEX_AI8:
+            for (int c = 0; c < 256; c++)
+                lut[c] = makergba((c & 0x0f) | ((c << 4) & 0xf0), (c & 0x0f) | ((c << 4) & 0xf0), (c & 0x0f) | ((c << 4) & 0xf0), (c & 0xf0) | ((c >> 4) & 0x0f));
+            break;
+
+        case TEX_PAL8:
+        case TEX_APAL88:
+            pal = voodoo->palette[tmu];
+            for (int c = 0; c < 256; c++)
+                lut[c] = makergba(pal[c].rgba.r, pal[c].rgba.g, pal[c].rgba.b, (tformat == TEX_PAL8) ? 0xff : 0);
+            break;
+
+        case TEX_APAL8:
+            pal = voodoo->palette[tmu];
+            for (int c = 0; c < 256; c++) {
+                int r = ((pal[c].rgba.r & 3) << 6) | ((pal[c].rgba.g & 0xf0) >> 2) | (pal[c].rgba.r & 3);
+                int g = ((pal[c].rgba.g & 0xf) << 4) | ((pal[c].rgba.b & 0xc0) >> 4) | ((pal[c].rgba.g & 0xf) >> 2);
+                int b = ((pal[c].rgba.b & 0x3f) << 2) | ((pal[c].rgba.b & 0x30) >> 4);
+                int a = (pal[c].rgba.r & 0xfc) | ((pal[c].rgba.r & 0xc0) >> 6);
+
+                lut[c] = makergba(r, g, b, a);
+            }
+            break;
+
+        case TEX_R5G6B5:
+        case TEX_ARGB1555:
+        case TEX_ARGB4444:
+            break;
+
+        default:
+            fatal("Unknown texture format %i\n", tformat);
+    }
+}
+
+/*Expand 8 RGB565/ARGB1555/ARGB4444 texels at a time. Returns the number of
+  texels converted; the tail is left to the caller.*/
+#if defined VOODOO_TEX_SSE2
+static int
+voodoo_texture_decode_16_simd(uint32_t *dst, const uint16_t *src, int w, int tformat)
+{
+    const __m128i mask4 = _mm_set1_epi16(0x0f);
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+    const __m128i mask8 = _mm_set1_epi16(0xff);
+    int           x;
+
+    for (x = 0; (x + 8) <= w; x += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &src[x]);
+        __m128i r;
+        __m128i g;
+        __m128i b;
+        __m128i a;
+        __m128i bg;
+        __m128i ra;
+
+        if (tformat == TEX_R5G6B5) {
+            r = _mm_srli_epi16(v, 11);
+            g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+            b = _mm_and_si128(v, mask5);
+            r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+            g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+            b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+            a = mask8;
+        } else if (tformat == TEX_ARGB1555) {
+            r = _mm_and_si128(_mm_srli_epi16(v, 10), mask5);
+            g = _mm_and_si128(_mm_srli_epi16(v, 5), mask5);
+            b = _mm_and_si128(v, mask5);
+            r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+            g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+            b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+            a = _mm_and_si128(_mm_srai_epi16(v, 15), mask8);
+        } else {
+            a = _mm_srli_epi16(v, 12);
+            r = _mm_and_si128(_mm_srli_epi16(v, 8), mask4);
+            g = _mm_and_si128(_mm_srli_epi16(v, 4), mask4);
+            b = _mm_and_si128(v, mask4);
+            a = _mm_or_si128(_mm_slli_epi16(a, 4), a);
+            r = _mm_or_si128(_mm_slli_epi16(r, 4), r);
+            g = _mm_or_si128(_mm_slli_epi16(g, 4), g);
+            b = _mm_or_si128(_mm_slli_epi16(b, 4), b);
+        }
+
+        bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        ra = _mm_or_si128(r, _mm_slli_epi16(a, 8));
+        _mm_storeu_si128((__m128i *) &dst[x], _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *) &dst[x + 4], _mm_unpackhi_epi16(bg, ra));
+    }
+
+    return x;
+}
+#elif defined VOODOO_TEX_NEON
+static int
+voodoo_texture_decode_16_simd(uint32_t *dst, const uint16_t *src, int w, int tformat)
+{
+    const uint16x8_t mask4 = vdupq_n_u16(0x0f);
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+    int              x;
+
+    for (x = 0; (x + 8) <= w; x += 8) {
+        uint16x8_t  v = vld1q_u16(&src[x]);
+        uint16x8_t  r;
+        uint16x8_t  g;
+        uint16x8_t  b;
+        uint8x8x4_t out;
+
+        if (tformat == TEX_R5G6B5) {
+            r = vshrq_n_u16(v, 11);
+            g = vandq_u16(vshrq_n_u16(v, 5), mask6);
+            b = vandq_u16(v, mask5);
+            r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+            g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+            b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+            out.val[3] = vdup_n_u8(0xff);
+        } else if (tformat == TEX_ARGB1555) {
+            r = vandq_u16(vshrq_n_u16(v, 10), mask5);
+            g = vandq_u16(vshrq_n_u16(v, 5), mask5);
+            b = vandq_u16(v, mask5);
+            r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+            g = vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2));
+            b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+            out.val[3] = vmovn_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v), 15)));
+        } else {
+            uint16x8_t a = vshrq_n_u16(v, 12);
+
+            r = vandq_u16(vshrq_n_u16(v, 8), mask4);
+            g = vandq_u16(vshrq_n_u16(v, 4), mask4);
+            b = vandq_u16(v, mask4);
+            r = vorrq_u16(vshlq_n_u16(r, 4), r);
+            g = vorrq_u16(vshlq_n_u16(g, 4), g);
+            b = vorrq_u16(vshlq_n_u16(b, 4), b);
+            out.val[3] = vmovn_u16(vorrq_u16(vshlq_n_u16(a, 4), a));
+        }
+
+        /*Interleaved store gives B,G,R,A bytes, i.e. makergba() order*/
+        out.val[0] = vmovn_u16(b);
+        out.val[1] = vmovn_u16(g);
+        out.val[2] = vmovn_u16(r);
+        vst4_u8((uint8_t *) &dst[x], out);
+    }
+
+    return x;
+}
+#endif
+
+static void
+voodoo_texture_decode_row(voodoo_t *voodoo, int tmu, int tformat, const uint32_t *lut, uint32_t *dst, uint32_t tex_addr, int w)
+{
+    const uint8_t *mem  = voodoo->tex_mem[tmu];
+    uint32_t       mask = voodoo->texture_mask;
+    int            x    = 0;
+
+    if (!(tformat & 8)) {
+        for (; x < w; x++)
+            dst[x] = lut[mem[(tex_addr + x) & mask]];
+        return;
+    }
+
+    switch (tformat) {
+        case TEX_R5G6B5:
+        case TEX_ARGB1555:
+        case TEX_ARGB4444:
+#if defined VOODOO_TEX_SSE2 || defined VOODOO_TEX_NEON
+            /*Rows that wrap around texture memory go through the tables*/
+            if (!(tex_addr & 1) && ((tex_addr & mask) + w * 2 - 1) <= mask)
+                x = voodoo_texture_decode_16_simd(dst, (const uint16_t *) &mem[tex_addr & mask], w, tformat);
+#endif
+            for (; x < w; x++) {
+                uint16_t dat = *(const uint16_t *) &mem[(tex_addr + x * 2) & mask];
+
+                if (tformat == TEX_R5G6B5)
+                    dst[x] = makergba(rgb565[dat].r, rgb565[dat].g, rgb565[dat].b, 0xff);
+                else if (tformat == TEX_ARGB1555)
+                    dst[x] = makergba(argb1555[dat].r, argb1555[dat].g, argb1555[dat].b, argb1555[dat].a);
+                else
+                    dst[x] = makergba(argb4444[dat].r, argb4444[dat].g, argb4444[dat].b, argb4444[dat].a);
+            }
+            break;
+
+        default:
+            for (; x < w; x++) {
+                uint16_t dat = *(const uint16_t *) &mem[(tex_addr + x * 2) & mask];
+
+                dst[x] = lut[dat & 0xff] | ((uint32_t) (dat >> 8) << 24);
+            }
+            break;
+    }
+}
+
+/*Convert the LODs in `lods` of entry c from texture memory to 32-bit BGRA,
+  and mark them decoded*/
+static void
+voodoo_texture_decode(voodoo_t *voodoo, voodoo_params_t *params, int tmu, int c, uint32_t lods)
+{
+    texture_t *entry   = &voodoo->texture_cache[tmu][c];
+    int        tformat = params->tformat[tmu];
+    uint32_t   lut[256];
+
+    if (!lods)
+        return;
+
+    voodoo_texture_build_lut(voodoo, tmu, tformat, lut);
+
+    for (int lod = 0; lod <= LOD_MAX; lod++) {
+        uint32_t *base;
+        uint32_t  tex_addr;
+        int       shift;
+        int       pitch;
+
+        if (!(lods & (1 << lod)))
+            continue;
+
+        base     = &entry->data[texture_offset[lod]];
+        tex_addr = params->tex_base[tmu][lod] & voodoo->texture_mask;
+        shift    = 8 - params->tex_lod[tmu][lod];
+        pitch    = 1 << (voodoo->params.tex_shift[tmu][lod] + ((tformat & 8) ? 1 : 0));
+#if 0
+        voodoo_texture_log("  LOD %i : %08x %i %i,%i\n", lod, tex_addr, tformat, voodoo->params.tex_w_mask[tmu][lod], voodoo->params.tex_h_mask[tmu][lod]);
+#endif
+
+        for (int y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
+            voodoo_texture_decode_row(voodoo, tmu, tformat, lut, base, tex_addr, voodoo->params.tex_w_mask[tmu][lod] + 1);
+            tex_addr += pitch;
+            base += (1 << shift);
+        }
+        entry->decoded |= 1 << lod;
+    }
+}
+
 void
 voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 {
     int      c;
     int      lod_min;
     int      lod_max;
-    uint32_t addr = 0;
-    uint32_t addr_end;
+    uint32_t addr   = 0;
+    uint32_t needed = 0;
     uint32_t palette_checksum;
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
     lod_max = (params->tLOD[tmu] >> 8) & 15;
+    for (int lod = MIN(lod_min, 8); lod <= MIN(lod_max, 8); lod++)
+        needed |= 1 << lod;
 
     if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88) {
         if (voodoo->palette_dirty[tmu]) {
@@ -270,30 +692,69 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
         addr = params->texBaseAddr[tmu];
 
     /*Try to find texture in cache*/
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
+    for (c = voodoo->texture_hash[tmu][voodoo_texture_hash(voodoo, addr, params->tLOD[tmu] & 0xf00fff, palette_checksum)]; c != -1; c = voodoo->texture_cache[tmu][c].hash_next) {
         if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
+            texture_t *entry = &voodoo->texture_cache[tmu][c];
+
+            /*Some LODs were written since they were decoded*/
+            if ((entry->decoded & needed) != needed) {
+                if (!voodoo_texture_idle(voodoo, tmu, c)) {
+                    /*Queued triangles still sample the old texels, so leave
+                      the entry to them and build the new texture elsewhere*/
+                    voodoo_texture_map_entry(voodoo, tmu, c, 0);
+                    voodoo_texture_hash_remove(voodoo, tmu, c);
+                    entry->base       = -1;
+                    entry->referenced = 0;
+                    break;
+                }
+                voodoo_texture_decode(voodoo, params, tmu, c, needed & ~entry->decoded);
+                voodoo_texture_map_entry(voodoo, tmu, c, entry->decoded);
+                voodoo->texture_lod_redecodes++;
+            }
+
             params->tex_entry[tmu] = c;
             voodoo->texture_cache[tmu][c].refcount++;
+            voodoo->texture_cache[tmu][c].referenced = 1;
+            voodoo->texture_cache_hits++;
             return;
         }
     }
+    voodoo->texture_cache_misses++;
 
-    /*Texture not found, search for unused texture*/
+    /*Texture not found. Sweep the clock for an entry that isn't used by any
+      queued triangle and hasn't been hit since the last pass; entries still
+      in flight are stepped over. Only if every entry is in flight do we
+      have to wait for the render threads.*/
     do {
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-            voodoo->texture_last_removed++;
-            voodoo->texture_last_removed &= (TEX_CACHE_MAX - 1);
-            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] && (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
-                break;
+        for (c = 0; c < voodoo->texture_cache_size * 2; c++) {
+            texture_t *entry;
+
+            voodoo->texture_last_removed = (voodoo->texture_last_removed + 1) & (voodoo->texture_cache_size - 1);
+            entry                        = &voodoo->texture_cache[tmu][voodoo->texture_last_removed];
+            if (!voodoo_texture_idle(voodoo, tmu, voodoo->texture_last_removed))
+                continue;
+            if (entry->referenced && entry->base != -1) {
+                entry->referenced = 0;
+                continue;
+            }
+            break;
         }
-        if (c == TEX_CACHE_MAX)
+        if (c == voodoo->texture_cache_size * 2) {
+            voodoo->texture_cache_stalls++;
             voodoo_wait_for_render_thread_idle(voodoo);
-    } while (c == TEX_CACHE_MAX);
-    if (c == TEX_CACHE_MAX)
-        fatal("Texture cache full!\n");
+        }
+    } while (c == voodoo->texture_cache_size * 2);
 
     c = voodoo->texture_last_removed;
 
+    if (voodoo->texture_cache[tmu][c].base != -1) {
+        voodoo_texture_hash_remove(voodoo, tmu, c);
+        voodoo->texture_cache_evictions++;
+    }
+    voodoo_texture_map_entry(voodoo, tmu, c, 0);
+    if (!voodoo->texture_cache[tmu][c].data)
+        voodoo->texture_cache[tmu][c].data = calloc(1, TEX_CACHE_DATA_SIZE);
+
     if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
         voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
     else
@@ -305,203 +766,8 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 #if 0
     voodoo_texture_log("  add new texture to %i tformat=%i %08x LOD=%i-%i tmu=%i\n", c, voodoo->params.tformat[tmu], params->texBaseAddr[tmu], lod_min, lod_max, tmu);
 #endif
-    lod_min = MIN(lod_min, 8);
-    lod_max = MIN(lod_max, 8);
-    for (int lod = lod_min; lod <= lod_max; lod++) {
-        uint32_t     *base     = &voodoo->texture_cache[tmu][c].data[texture_offset[lod]];
-        uint32_t      tex_addr = params->tex_base[tmu][lod] & voodoo->texture_mask;
-        int           x;
-        int           y;
-        int           shift = 8 - params->tex_lod[tmu][lod];
-        const rgba_u *pal;
-
-#if 0
-        voodoo_texture_log("  LOD %i : %08x - %08x %i %i,%i\n", lod, params->tex_base[tmu][lod] & voodoo->texture_mask, addr, voodoo->params.tformat[tmu], voodoo->params.tex_w_mask[tmu][lod],voodoo->params.tex_h_mask[tmu][lod]);
-#endif
-
-        switch (params->tformat[tmu]) {
-            case TEX_RGB332:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        base[x] = makergba(rgb332[dat].r, rgb332[dat].g, rgb332[dat].b, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_Y4I2Q2:
-                pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_A8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        base[x] = makergba(dat, dat, dat, dat);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_I8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        base[x] = makergba(dat, dat, dat, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_AI8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        base[x] = makergba((dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0xf0) | ((dat >> 4) & 0x0f));
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_PAL8:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_APAL8:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
-
-                        int r = ((pal[dat].rgba.r & 3) << 6) | ((pal[dat].rgba.g & 0xf0) >> 2) | (pal[dat].rgba.r & 3);
-                        int g = ((pal[dat].rgba.g & 0xf) << 4) | ((pal[dat].rgba.b & 0xc0) >> 4) | ((pal[dat].rgba.g & 0xf) >> 2);
-                        int b = ((pal[dat].rgba.b & 0x3f) << 2) | ((pal[dat].rgba.b & 0x30) >> 4);
-                        int a = (pal[dat].rgba.r & 0xfc) | ((pal[dat].rgba.r & 0xc0) >> 6);
-
-                        base[x] = makergba(r, g, b, a);
-                    }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_ARGB8332:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(rgb332[dat & 0xff].r, rgb332[dat & 0xff].g, rgb332[dat & 0xff].b, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_A8Y4I2Q2:
-                pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_R5G6B5:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(rgb565[dat].r, rgb565[dat].g, rgb565[dat].b, 0xff);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_ARGB1555:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(argb1555[dat].r, argb1555[dat].g, argb1555[dat].b, argb1555[dat].a);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_ARGB4444:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(argb4444[dat].r, argb4444[dat].g, argb4444[dat].b, argb4444[dat].a);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_A8I8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(dat & 0xff, dat & 0xff, dat & 0xff, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            case TEX_APAL88:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
-
-                        base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
-                    }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
-                    base += (1 << shift);
-                }
-                break;
-
-            default:
-                fatal("Unknown texture format %i\n", params->tformat[tmu]);
-        }
-    }
+    voodoo->texture_cache[tmu][c].decoded = 0;
+    voodoo_texture_decode(voodoo, params, tmu, c, needed);
 
     voodoo->texture_cache[tmu][c].is16 = voodoo->params.tformat[tmu] & 8;
 
@@ -534,60 +800,47 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
     } else
         voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
 
-    for (uint8_t d = 0; d < 4; d++) {
-        addr     = voodoo->texture_cache[tmu][c].addr_start[d];
-        addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
-
-        if (addr_end != 0) {
-            for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
-                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-        }
-    }
+    voodoo_texture_map_entry(voodoo, tmu, c, voodoo->texture_cache[tmu][c].decoded);
+    voodoo_texture_hash_insert(voodoo, tmu, c);
+    voodoo->texture_cache[tmu][c].referenced = 1;
 
     params->tex_entry[tmu] = c;
     voodoo->texture_cache[tmu][c].refcount++;
 }
 
+/*Mark the LODs of every entry backed by the written page as stale. Their
+  decoded copies are left alone for triangles already queued; the next
+  voodoo_use_texture() hit decodes them again, or moves the texture to a
+  fresh entry if the old one is still in flight.*/
 void
 flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
-    int wait_for_idle = 0;
+    int       words = voodoo->texture_cache_size >> 5;
+    int       page  = dirty_addr >> TEX_DIRTY_SHIFT;
+    uint32_t *map   = &voodoo->texture_page_map[tmu][page * words];
 
-    memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
 #if 0
-    voodoo_texture_log("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
+    voodoo_texture_log("Evict %08x %i\n", dirty_addr, voodoo->texture_present[tmu][page]);
 #endif
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base != -1) {
-            for (uint8_t d = 0; d < 4; d++) {
-                int addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
-                int addr_end   = voodoo->texture_cache[tmu][c].addr_end[d];
-
-                if (addr_end != 0) {
-                    int addr_start_masked = addr_start & voodoo->texture_mask & ~0x3ff;
-                    int addr_end_masked   = ((addr_end & voodoo->texture_mask) + 0x3ff) & ~0x3ff;
-
-                    if (addr_end_masked < addr_start_masked)
-                        addr_end_masked = voodoo->texture_mask + 1;
-                    if (dirty_addr >= addr_start_masked && dirty_addr < addr_end_masked) {
+    for (int w = 0; w < words; w++) {
+        while (map[w]) {
+            texture_t *entry;
+            int        c = w << 5;
+
+            while (!(map[w] & (1u << (c & 31))))
+                c++;
+            entry = &voodoo->texture_cache[tmu][c];
 #if 0
-                        voodoo_texture_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
+            voodoo_texture_log("  Evict texture %i %08x\n", c, entry->base);
 #endif
 
-                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] || (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
-                            wait_for_idle = 1;
-
-                        voodoo->texture_cache[tmu][c].base = -1;
-                    } else {
-                        for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
-                            voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-                    }
-                }
+            for (uint8_t d = 0; d < 4; d++) {
+                if (voodoo_texture_range_covers(voodoo, entry, d, page))
+                    entry->decoded &= ~texture_range_lods[d];
             }
+            voodoo_texture_map_entry(voodoo, tmu, c, entry->decoded);
         }
     }
-    if (wait_for_idle)
-        voodoo_wait_for_render_thread_idle(voodoo);
 }
 
 void